@@ -35,22 +35,48 @@ struct request {
 	struct task_struct * waiting;
 	struct buffer_head * bh;
 	struct buffer_head * bhtail;
+	unsigned long deadline;	/* jiffies by which it should have been started */
 	struct request * next;
 };
 
 /*
- * This is used in the elevator algorithm: Note that
- * reads always go before writes. This is natural: reads
- * are much more time-critical than writes.
+ * This is used in the elevator algorithm: requests are kept sorted
+ * on device and sector. Reads no longer go before all writes, the
+ * deadline scheduler keeps them from waiting behind a long sweep.
  */
 #define IN_ORDER(s1,s2) \
-((s1)->cmd < (s2)->cmd || ((s1)->cmd == (s2)->cmd && \
-((s1)->dev < (s2)->dev || (((s1)->dev == (s2)->dev && \
-(s1)->sector < (s2)->sector)))))
+((s1)->dev < (s2)->dev || ((s1)->dev == (s2)->dev && \
+(s1)->sector < (s2)->sector))
+
+struct blk_dev_struct;
+
+/*
+ * An I/O scheduler. add_request() puts a new request somewhere after
+ * the head of the queue (the head may be in the hands of the driver
+ * already); next_request() is called with interrupts off as "req" is
+ * finished, and returns the request the driver should do next.
+ */
+struct elevator {
+	char * name;
+	void (*add_request)(struct blk_dev_struct * dev, struct request * req);
+	struct request * (*next_request)(struct blk_dev_struct * dev, struct request * req);
+};
+
+struct blk_stats {
+	unsigned long reads, writes;		/* requests queued */
+	unsigned long read_sectors, write_sectors;
+	unsigned long back_merges, front_merges;
+	unsigned long seeks, seek_sectors;	/* between requests started */
+	unsigned long expired;			/* sweeps broken for a deadline */
+};
 
 struct blk_dev_struct {
 	void (*request_fn)(void);
 	struct request * current_request;
+	struct elevator * elevator;
+	struct blk_stats stats;
+	int last_dev;			/* where the last request started ended */
+	unsigned long last_sector;
 };
 
 
@@ -73,6 +99,8 @@ struct sec_size {
 extern struct sec_size * blk_sec[MAX_BLKDEV];
 extern struct blk_dev_struct blk_dev[MAX_BLKDEV];
 extern struct wait_queue * wait_for_request;
+extern struct request * blk_next_request(struct request * req);
+extern void blk_started(struct request * req);
 extern void resetup_one_dev(struct gendisk *dev, int drive);
 
 extern int * blk_size[MAX_BLKDEV];
@@ -274,10 +302,10 @@ static void end_request(int uptodate)
 		}
 	}
 	DEVICE_OFF(req->dev);
-	CURRENT = req->next;
+	CURRENT = blk_next_request(req);
 	if ((p = req->waiting) != NULL) {
 		req->waiting = NULL;
-		p->state = TASK_RUNNING;
+		wake_up_process(p);
 		if (p->counter > current->counter)
 			need_resched = 1;
 	}
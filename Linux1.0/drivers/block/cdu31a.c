@@ -1009,7 +1009,7 @@ cdu31a_request_startover:
       INIT_REQUEST;
       dev = MINOR(CURRENT->dev);
       block = CURRENT->sector;
-      nsect = CURRENT->nr_sectors;
+      nsect = CURRENT->current_nr_sectors;	/* one buffer of a merged request */
       if (dev != 0)
       {
          end_request(0);
@@ -1099,7 +1099,9 @@ try_read_again:
             nsect -= 1;
             CURRENT->buffer += 512;
          }
-               
+
+         CURRENT->sector += CURRENT->current_nr_sectors;
+         CURRENT->nr_sectors -= CURRENT->current_nr_sectors;
          end_request(1);
          break;
             
@@ -375,8 +375,14 @@ static void floppy_off(unsigned int nr)
 void request_done(int uptodate)
 {
 	timer_active &= ~(1 << FLOPPY_TIMER);
-	if (format_status != FORMAT_BUSY)
+	if (format_status != FORMAT_BUSY) {
+		/* a merged request goes on with its next block */
+		if (uptodate) {
+			CURRENT->sector += CURRENT->current_nr_sectors;
+			CURRENT->nr_sectors -= CURRENT->current_nr_sectors;
+		}
 		end_request(uptodate);
+	}
 	else {
 		format_status = uptodate ? FORMAT_OKAY : FORMAT_ERROR;
 		wake_up(&format_done);
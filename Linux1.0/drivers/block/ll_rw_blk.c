@@ -14,6 +14,7 @@
 #include <linux/string.h>
 #include <linux/config.h>
 #include <linux/locks.h>
+#include <linux/malloc.h>
 
 #include <asm/system.h>
 
@@ -144,6 +145,137 @@ void set_device_ro(int dev,int flag)
 	else ro_bits[major][minor >> 5] &= ~(1 << (minor & 31));
 }
 
+/*
+ * C-LOOK: the queue is one sweep upwards from the head, possibly
+ * followed by the start of the next sweep from the lowest sector.
+ * A new request goes into whichever of the two it fits.
+ */
+static void clook_add_request(struct blk_dev_struct * dev, struct request * req)
+{
+	struct request * tmp = dev->current_request;
+
+	for ( ; tmp->next ; tmp = tmp->next) {
+		if (IN_ORDER(tmp,req) && IN_ORDER(req,tmp->next))
+			break;
+		/* tmp->next starts the next sweep: end this one or start that */
+		if (!IN_ORDER(tmp,tmp->next) &&
+		    (IN_ORDER(tmp,req) || IN_ORDER(req,tmp->next)))
+			break;
+	}
+	req->next = tmp->next;
+	tmp->next = req;
+}
+
+static struct request * clook_next_request(struct blk_dev_struct * dev,
+	struct request * req)
+{
+	return req->next;
+}
+
+/*
+ * Deadline: C-LOOK order, but every request must be started within
+ * read_expire or write_expire ticks of being queued. Once one is late,
+ * the one that has been late longest goes right after "req".
+ */
+static int read_expire = HZ/2;
+static int write_expire = 5*HZ;
+
+static void deadline_expire(struct blk_dev_struct * dev, struct request * req)
+{
+	struct request * tmp, * prev, * late = NULL, * lateprev = NULL;
+
+	for (prev = req ; (tmp = prev->next) != NULL ; prev = tmp) {
+		if (tmp->deadline > jiffies)
+			continue;
+		if (!late || tmp->deadline < late->deadline) {
+			late = tmp;
+			lateprev = prev;
+		}
+	}
+	if (!late || lateprev == req)
+		return;
+	lateprev->next = late->next;
+	late->next = req->next;
+	req->next = late;
+	dev->stats.expired++;
+}
+
+static void deadline_add_request(struct blk_dev_struct * dev, struct request * req)
+{
+	req->deadline = jiffies + (req->cmd == READ ? read_expire : write_expire);
+	clook_add_request(dev, req);
+	deadline_expire(dev, dev->current_request);
+}
+
+static struct request * deadline_next_request(struct blk_dev_struct * dev,
+	struct request * req)
+{
+	deadline_expire(dev, req);
+	return req->next;
+}
+
+static struct elevator elevators[] = {
+	{ "deadline", deadline_add_request, deadline_next_request },
+	{ "clook", clook_add_request, clook_next_request },
+	{ NULL, NULL, NULL }
+};
+
+static struct elevator * default_elevator = elevators;
+
+/* "elevator=clook" on the command line picks the scheduler for all queues */
+void elevator_setup(char *str, int *ints)
+{
+	struct elevator * e;
+
+	for (e = elevators ; e->name ; e++)
+		if (!strcmp(str, e->name)) {
+			default_elevator = e;
+			return;
+		}
+	printk("elevator: unknown scheduler %s\n", str);
+}
+
+/*
+ * The driver is about to start on "req": count the seek, if it doesn't
+ * begin where the previous request on this queue ended.
+ */
+void blk_started(struct request * req)
+{
+	struct blk_dev_struct * dev;
+
+	if (req->dev < 0 || MAJOR(req->dev) >= MAX_BLKDEV)
+		return;
+	dev = blk_dev + MAJOR(req->dev);
+	if (req->dev != dev->last_dev || req->sector != dev->last_sector) {
+		dev->stats.seeks++;
+		if (req->dev == dev->last_dev)
+			dev->stats.seek_sectors += (req->sector > dev->last_sector) ?
+				req->sector - dev->last_sector :
+				dev->last_sector - req->sector;
+	}
+	dev->last_dev = req->dev;
+	dev->last_sector = req->sector + req->nr_sectors;
+}
+
+/*
+ * end_request() is done with "req", the head of its queue: let the
+ * scheduler pick what comes next.
+ */
+struct request * blk_next_request(struct request * req)
+{
+	struct blk_dev_struct * dev = blk_dev + MAJOR(req->dev);
+	struct request * next;
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	next = dev->elevator->next_request(dev, req);
+	if (next)
+		blk_started(next);
+	restore_flags(flags);
+	return next;
+}
+
 /*
  * add-request adds a request to the linked list.
  * It disables interrupts so that it can muck with the
@@ -151,26 +283,26 @@ void set_device_ro(int dev,int flag)
  */
 static void add_request(struct blk_dev_struct * dev, struct request * req)
 {
-	struct request * tmp;
-
 	req->next = NULL;
 	cli();
 	if (req->bh)
 		req->bh->b_dirt = 0;
-	if (!(tmp = dev->current_request)) {
+	if (req->cmd == READ) {
+		dev->stats.reads++;
+		dev->stats.read_sectors += req->nr_sectors;
+	} else {
+		dev->stats.writes++;
+		dev->stats.write_sectors += req->nr_sectors;
+	}
+	if (!dev->current_request) {
 		dev->current_request = req;
+		if (!scsi_major(MAJOR(req->dev)))
+			blk_started(req);
 		(dev->request_fn)();
 		sti();
 		return;
 	}
-	for ( ; tmp->next ; tmp = tmp->next) {
-		if ((IN_ORDER(tmp,req) ||
-		    !IN_ORDER(tmp,tmp->next)) &&
-		    IN_ORDER(req,tmp->next))
-			break;
-	}
-	req->next = tmp->next;
-	tmp->next = req;
+	dev->elevator->add_request(dev, req);
 
 /* for SCSI devices, call request_fn unconditionally */
 	if (scsi_major(MAJOR(req->dev)))
@@ -179,6 +311,14 @@ static void add_request(struct blk_dev_struct * dev, struct request * req)
 	sti();
 }
 
+static inline void merge_sectors(struct blk_stats * st, int rw, int count)
+{
+	if (rw == READ)
+		st->read_sectors += count;
+	else
+		st->write_sectors += count;
+}
+
 static void make_request(int major,int rw, struct buffer_head * bh)
 {
 	unsigned int sector, count;
@@ -226,14 +366,12 @@ repeat:
 
 /* The scsi disk drivers completely remove the request from the queue when
  * they start processing an entry.  For this reason it is safe to continue
- * to add links to the top entry for scsi devices.
+ * to add links to the top entry for scsi devices. Every other driver is
+ * working on the head of its queue, but follows the buffer chain of a
+ * request, so anything behind the head can be merged with.
  */
-	if ((major == HD_MAJOR
-	     || major == SCSI_DISK_MAJOR
-	     || major == SCSI_CDROM_MAJOR)
-	    && (req = blk_dev[major].current_request))
-	{
-	        if (major == HD_MAJOR)
+	if ((req = blk_dev[major].current_request) != NULL) {
+		if (!scsi_major(major))
 			req = req->next;
 		while (req) {
 			if (req->dev == bh->b_dev &&
@@ -246,6 +384,8 @@ repeat:
 				req->bhtail = bh;
 				req->nr_sectors += count;
 				bh->b_dirt = 0;
+				blk_dev[major].stats.back_merges++;
+				merge_sectors(&blk_dev[major].stats, rw, count);
 				sti();
 				return;
 			}
@@ -263,6 +403,8 @@ repeat:
 			    	req->sector = sector;
 			    	bh->b_dirt = 0;
 			    	req->bh = bh;
+			    	blk_dev[major].stats.front_merges++;
+			    	merge_sectors(&blk_dev[major].stats, rw, count);
 			    	sti();
 			    	return;
 			}    
@@ -336,6 +478,67 @@ void ll_rw_page(int rw, int dev, int page, char * buffer)
 	schedule();
 }
 
+/*
+ * Page "nr" pages in or out of consecutive pages of the device, starting
+ * at "page", with a single request. The buffers needn't be contiguous:
+ * each one gets a buffer head of its own, and end_request() steps through
+ * them the way it does through merged blocks. If the buffer heads can't
+ * be had it's done a page at a time.
+ */
+void ll_rw_pages(int rw, int dev, int page, char ** buffers, int nr)
+{
+	struct request * req;
+	struct buffer_head * bh;
+	unsigned int major = MAJOR(dev);
+	int i;
+
+	if (nr == 1 || nr > 254/8 ||
+	    !(bh = (struct buffer_head *) kmalloc(nr*sizeof(*bh), GFP_ATOMIC))) {
+		for (i = 0 ; i < nr ; i++)
+			ll_rw_page(rw, dev, page+i, buffers[i]);
+		return;
+	}
+	if (major >= MAX_BLKDEV || !(blk_dev[major].request_fn)) {
+		printk("Trying to read nonexistent block-device %04x (%d)\n",dev,page*8);
+		goto out;
+	}
+	if (rw!=READ && rw!=WRITE)
+		panic("Bad block dev command, must be R/W");
+	if (rw == WRITE && is_read_only(dev)) {
+		printk("Can't page to read-only device 0x%X\n",dev);
+		goto out;
+	}
+	memset(bh, 0, nr*sizeof(*bh));
+	for (i = 0 ; i < nr ; i++) {
+		bh[i].b_data = buffers[i];
+		bh[i].b_size = PAGE_SIZE;
+		bh[i].b_blocknr = page+i;
+		bh[i].b_dev = dev;
+		bh[i].b_count = 1;
+		bh[i].b_lock = 1;
+		if (i+1 < nr)
+			bh[i].b_reqnext = bh+i+1;
+	}
+	cli();
+	req = get_request_wait(NR_REQUEST, dev);
+	sti();
+	req->cmd = rw;
+	req->errors = 0;
+	req->sector = page<<3;
+	req->nr_sectors = nr<<3;
+	req->current_nr_sectors = 8;
+	req->buffer = buffers[0];
+	req->waiting = current;
+	req->bh = bh;
+	req->bhtail = bh+nr-1;
+	req->next = NULL;
+	current->state = TASK_SWAPPING;
+	add_request(major+blk_dev,req);
+	schedule();
+out:
+	kfree_s(bh, nr*sizeof(*bh));
+}
+
 /* This function can be used to request a number of buffers from a block
    device. Currently the only restriction is that all buffers must belong to
    the same device */
@@ -418,6 +621,8 @@ void ll_rw_block(int rw, int nr, struct buffer_head * bh[])
 	if (plugged) {
 		cli();
 		dev->current_request = plug.next;
+		if (plug.next && !scsi_major(major))
+			blk_started(plug.next);
 		(dev->request_fn)();
 		sti();
 	}
@@ -474,15 +679,47 @@ void ll_rw_swap_file(int rw, int dev, unsigned int *b, int nb, char *buf)
 	}
 }
 
+/*
+ * /proc/iostats: what the scheduler saw on every queue that has a driver.
+ */
+int get_iostats(char * buffer)
+{
+	struct blk_dev_struct * dev;
+	struct blk_stats * st;
+	int major, len;
+
+	len = sprintf(buffer, "scheduler: %s\n"
+		"major    reads   writes  rsectors  wsectors  bmerges  fmerges"
+		"    seeks  seeksectors  expired\n", default_elevator->name);
+	for (major = 0 ; major < MAX_BLKDEV ; major++) {
+		dev = blk_dev + major;
+		if (!dev->request_fn)
+			continue;
+		st = &dev->stats;
+		len += sprintf(buffer+len,
+			"%5d %8lu %8lu %9lu %9lu %8lu %8lu %8lu %12lu %8lu\n",
+			major, st->reads, st->writes,
+			st->read_sectors, st->write_sectors,
+			st->back_merges, st->front_merges,
+			st->seeks, st->seek_sectors, st->expired);
+	}
+	return len;
+}
+
 long blk_dev_init(long mem_start, long mem_end)
 {
 	struct request * req;
+	int i;
 
 	req = all_requests + NR_REQUEST;
 	while (--req >= all_requests) {
 		req->dev = -1;
 		req->next = NULL;
 	}
+	for (i = 0 ; i < MAX_BLKDEV ; i++) {
+		blk_dev[i].elevator = default_elevator;
+		blk_dev[i].last_dev = -1;
+	}
 	memset(ro_bits,0,sizeof(ro_bits));
 #ifdef CONFIG_BLK_DEV_HD
 	mem_start = hd_init(mem_start,mem_end);
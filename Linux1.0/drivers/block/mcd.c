@@ -495,11 +495,13 @@ mcd_transfer(void)
 {
 	long offs;
 
-	while (CURRENT -> nr_sectors > 0 && mcd_bn == CURRENT -> sector / 4)
+	/* stop at the end of the buffer: a merged request has more of them */
+	while (CURRENT -> current_nr_sectors > 0 && mcd_bn == CURRENT -> sector / 4)
 	{
 		offs = (CURRENT -> sector & 3) * 512;
 		memcpy(CURRENT -> buffer, mcd_buf + offs, 512);
 		CURRENT -> nr_sectors--;
+		CURRENT -> current_nr_sectors--;
 		CURRENT -> sector++;
 		CURRENT -> buffer += 512;
 	}
@@ -558,7 +560,7 @@ repeat:
 
 	/* if we satisfied the request from the buffer, we're done. */
 
-	if (CURRENT -> nr_sectors == 0)
+	if (CURRENT -> current_nr_sectors == 0)
 	{
 		end_request(1);
 		goto repeat;
@@ -729,7 +731,8 @@ mcd_data()
 
 	mcd_bn = CURRENT -> sector / 4;
 	mcd_transfer();
-	end_request(1);
+	if (CURRENT -> current_nr_sectors == 0)
+		end_request(1);
 	SET_TIMER(do_mcd_request, 1);
 }
 
@@ -52,6 +52,9 @@ repeat:
 			      len);
 	} else
 		panic("RAMDISK: unknown RAM disk command !\n");
+	/* a merged request goes on with its next buffer */
+	CURRENT->sector += CURRENT->current_nr_sectors;
+	CURRENT->nr_sectors -= CURRENT->current_nr_sectors;
 	end_request(1);
 	goto repeat;
 }
@@ -2257,13 +2257,15 @@ static void sbp_transfer(void)
 {
   long offs;
   
-  while ( (CURRENT->nr_sectors > 0) &&
+  /* stop at the end of the buffer: a merged request has more of them */
+  while ( (CURRENT->current_nr_sectors > 0) &&
 	  (CURRENT->sector/4 >= DS[d].sbp_first_frame) &&
 	  (CURRENT->sector/4 <= DS[d].sbp_last_frame) )
     {
       offs = (CURRENT->sector - DS[d].sbp_first_frame * 4) * 512;
       memcpy(CURRENT->buffer, DS[d].sbp_buf + offs, 512);
       CURRENT->nr_sectors--;
+      CURRENT->current_nr_sectors--;
       CURRENT->sector++;
       CURRENT->buffer += 512;
     }
@@ -2367,7 +2369,7 @@ request_loop:
 
   /* if we satisfied the request from the buffer, we're done. */
 
-  if (CURRENT->nr_sectors == 0)
+  if (CURRENT->current_nr_sectors == 0)
     {
       end_request(1);
       goto request_loop;
@@ -2397,7 +2399,8 @@ request_loop:
       sbp_sleep(0);
       if (sbp_data() != 0)
 	{
-	  end_request(1);
+	  if (CURRENT->current_nr_sectors == 0)
+	    end_request(1);
 	  goto request_loop;
 	}
     }
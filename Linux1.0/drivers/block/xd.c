@@ -184,7 +184,7 @@ static void do_xd_request (void)
 
 		if (CURRENT_DEV < xd_drives && CURRENT->sector + CURRENT->nr_sectors <= xd[MINOR(CURRENT->dev)].nr_sects) {
 			block = CURRENT->sector + xd[MINOR(CURRENT->dev)].start_sect;
-			count = CURRENT->nr_sectors;
+			count = CURRENT->current_nr_sectors;	/* one buffer at a time */
 
 			switch (CURRENT->cmd) {
 				case READ:
@@ -193,6 +193,10 @@ static void do_xd_request (void)
 						break;
 				default:	printk("do_xd_request: unknown request\n"); break;
 			}
+			if (code) {
+				CURRENT->sector += count;
+				CURRENT->nr_sectors -= count;
+			}
 		}
 		end_request(code);	/* wrap up, 0 = fail, 1 = success */
 	}
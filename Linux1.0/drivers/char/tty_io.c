@@ -322,7 +322,7 @@ void disassociate_ctty(int priv)
 			printk("disassociate_ctty: ctty is NULL?!?");
 	}
 
-	for_each_task(p)
+	for (p = sesshash[pid_hashfn(current->session)] ; p ; p = p->session_next)
 	  	if (p->session == current->session)
 			p->tty = -1;
 }
@@ -108,12 +108,15 @@ void wait_until_sent(struct tty_struct * tty, int timeout)
 	remove_wait_queue(&tty->write_q.proc_list, &wait);
 }
 
+/* ûԭNR_TASKSΪ128ʱĲʹṹֻtask[]ǰ128 */
+#define PS_INFO_TASKS	128
+
 static int do_get_ps_info(int arg)
 {
 	struct tstruct {
 		int flag;
-		int present[NR_TASKS];
-		struct task_struct tasks[NR_TASKS];
+		int present[PS_INFO_TASKS];
+		struct task_struct tasks[PS_INFO_TASKS];
 	};
 	struct tstruct *ts = (struct tstruct *)arg;
 	struct task_struct **p;
@@ -123,8 +126,8 @@ static int do_get_ps_info(int arg)
 	i = verify_area(VERIFY_WRITE, (void *)arg, sizeof(struct tstruct));
 	if (i)
 		return i;
-	for (p = &FIRST_TASK ; p <= &LAST_TASK ; p++, n++)
-		if (*p)
+	for (p = &FIRST_TASK ; n < PS_INFO_TASKS ; p++, n++)
+		if (n < nr_task_slots && *p)
 		{
 			c = (char *)(*p);
 			d = (char *)(ts->tasks+n);
@@ -486,7 +486,7 @@ static void end_scsi_request(Scsi_Cmnd * SCpnt, int uptodate, int sectors)
 	DEVICE_OFF(req->dev);
 	if ((p = req->waiting) != NULL) {
 		req->waiting = NULL;
-		p->state = TASK_RUNNING;
+		wake_up_process(p);
 		if (p->counter > current->counter)
 			need_resched = 1;
 	}
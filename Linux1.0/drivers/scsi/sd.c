@@ -371,6 +371,7 @@ static void do_sd_request (void)
     if (!SCpnt) return; /* Could not find anything to do */
     
     wake_up(&wait_for_request);
+    blk_started(&SCpnt->request);
     
     /* Queue command */
     requeue_sd_request(SCpnt);
@@ -655,7 +656,7 @@ static void sd_init_done (Scsi_Cmnd * SCpnt)
   
   if ((p = req->waiting) != NULL) {
     req->waiting = NULL;
-    p->state = TASK_RUNNING;
+    wake_up_process(p);
     if (p->counter > current->counter)
       need_resched = 1;
   }
@@ -337,6 +337,7 @@ static void do_sr_request (void)
       return; /* Could not find anything to do */
     
   wake_up(&wait_for_request);
+  blk_started(&SCpnt->request);
 
 /* Queue command */
   requeue_sr_request(SCpnt);
@@ -638,7 +639,7 @@ static void sr_init_done (Scsi_Cmnd * SCpnt)
   
   if ((p = req->waiting) != NULL) {
     req->waiting = NULL;
-    p->state = TASK_RUNNING;
+    wake_up_process(p);
     if (p->counter > current->counter)
       need_resched = 1;
   }
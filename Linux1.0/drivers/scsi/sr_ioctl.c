@@ -28,7 +28,7 @@ static void sr_ioctl_done(Scsi_Cmnd * SCpnt)
   
   if ((p = req->waiting) != NULL) {
     req->waiting = NULL;
-    p->state = TASK_RUNNING;
+    wake_up_process(p);
     if (p->counter > current->counter)
       need_resched = 1;
   }
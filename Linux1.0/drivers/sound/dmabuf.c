@@ -303,14 +303,14 @@ DMAbuf_release (int dev, int mode)
       dma_sync (dev);
     }
 
-#ifdef USE_RUNTIME_DMAMEM
-  sound_dma_free(dev);
-#endif
-
   dsp_devs[dev]->reset (dev);
 
   dsp_devs[dev]->close (dev);
 
+#ifdef USE_RUNTIME_DMAMEM
+  sound_dma_free(dev);		/* Only once the DMA has been stopped */
+#endif
+
   dma_mode[dev] = DMODE_NONE;
   dev_busy[dev] = 0;
 
@@ -148,6 +148,14 @@ If your card has nonstandard I/O address or IRQ number, change defines
 #define DSP_BUFFCOUNT		2	/* 2 is recommended. */
 #endif
 
+/* Allocate the DMA buffers when a device is opened instead of taking them
+   off the top of memory at boot. The GUS patch loader uses the buffer
+   without opening the device, so with a GUS the boot-time buffers stay. */
+
+#if defined(EXCLUDE_GUS) && !defined(USE_RUNTIME_DMAMEM)
+#define USE_RUNTIME_DMAMEM
+#endif
+
 #define DMA_AUTOINIT		0x10
 
 #define FM_MONO		0x388	/* This is the I/O address used by AdLib */
@@ -307,6 +307,7 @@ sound_mem_init (void)
 	if (sound_buffsizes[dev] < 4096)
 	  sound_buffsizes[dev] = 4096;
 
+#ifndef USE_RUNTIME_DMAMEM
 	/* Now allocate the buffers */
 
 	for (snd_raw_count[dev] = 0; snd_raw_count[dev] < sound_buffcounts[dev]; snd_raw_count[dev]++)
@@ -330,9 +331,66 @@ sound_mem_init (void)
 		mem_map[i] = MAP_PAGE_RESERVED;
 	      }
 	  }
+#endif
       }				/* for dev */
 }
 
+#ifdef USE_RUNTIME_DMAMEM
+/*
+ * Get the DMA buffers from the page allocator when the device is opened.
+ * A block of 2^order pages is aligned to its own size, so it can't cross
+ * a 64k or 128k DMA page; it still has to lie below 16M.
+ */
+static int
+dma_buf_order (int dev)
+{
+  int             order;
+
+  for (order = 0; (PAGE_SIZE << order) < sound_buffsizes[dev]; order++);
+  return order;
+}
+
+void
+sound_dma_malloc (int dev)
+{
+  int             order = dma_buf_order (dev);
+  unsigned long   start_addr;
+
+  if (snd_raw_count[dev] > 0)	/* Already have them */
+    return;
+  if (sound_buffcounts[dev] <= 0 || sound_dsp_dmachan[dev] <= 0)
+    return;
+
+  for (; snd_raw_count[dev] < sound_buffcounts[dev]; snd_raw_count[dev]++)
+    {
+      start_addr = __get_free_pages (GFP_KERNEL, order);
+      if (start_addr && start_addr + sound_buffsizes[dev] > 16 * 1024 * 1024)
+	{
+	  free_pages (start_addr, order);
+	  start_addr = 0;
+	}
+      if (!start_addr)
+	break;
+
+      snd_raw_buf[dev][snd_raw_count[dev]] = (char *) start_addr;
+      snd_raw_buf_phys[dev][snd_raw_count[dev]] = start_addr;
+    }
+}
+
+void
+sound_dma_free (int dev)
+{
+  int             order = dma_buf_order (dev);
+
+  while (snd_raw_count[dev] > 0)
+    {
+      snd_raw_count[dev]--;
+      free_pages ((unsigned long) snd_raw_buf[dev][snd_raw_count[dev]], order);
+      snd_raw_buf[dev][snd_raw_count[dev]] = NULL;
+    }
+}
+#endif
+
 #endif
 
 #else
@@ -25,9 +25,12 @@
 #include <linux/major.h>
 #include <linux/string.h>
 #include <linux/locks.h>
+#include <linux/malloc.h>
 #include <linux/errno.h>
+#include <linux/pagemap.h>
 
 #include <asm/system.h>
+#include <asm/segment.h>
 #include <asm/io.h>
 
 #ifdef CONFIG_SCSI
@@ -48,14 +51,69 @@ extern int check_mcd_media_change(int, int);
 
 static int grow_buffers(int pri, int size);
 
-/* ǽڴ飬ӳ䵽ӦĻͷͷûУ
- * ȥһҳĻͷunused_listָ򣬵Ҫͷʱ
- * unused_listȥȡȻӳõĻͷӵ
- * free_listӦ˫
+/*
+ * The buffers are kept on one lru list per block size and state: clean,
+ * locked (being written) and dirty. getblk() only has to look at the
+ * head of the clean list of the right size to find a buffer it can take
+ * over, instead of scanning every buffer in the system.
+ *
+ * Nobody tells us when a buffer gets dirtied or unlocked (drivers and
+ * filesystems just set b_dirt and b_lock), so the lists are kept up to
+ * date lazily: brelse() and getblk() refile the buffers they touch, and
+ * a buffer found on the wrong list is moved to the right one.
+ */
+#define NR_SIZES 4
+static int buffersize_index[9] = {-1,  0,  1, -1,  2, -1, -1, -1, 3};
+#define BUFSIZE_INDEX(X) (buffersize_index[(X)>>9])
+
+#define BUF_CLEAN	0
+#define BUF_LOCKED	1
+#define BUF_DIRTY	2
+#define NR_LIST		3
+
+/* ǽڴ飬ӳ䵽ӦĻͷͷbh_cachep
+ * 󻺴з䣬ȻӳõĻͷӵ
+ * lru_listӦ˫
  */
 static struct buffer_head * hash_table[NR_HASH];
-static struct buffer_head * free_list = NULL;      
-static struct buffer_head * unused_list = NULL;
+static struct buffer_head * lru_list[NR_LIST][NR_SIZES] = {{NULL, }, };
+static int nr_buffers_type[NR_LIST][NR_SIZES] = {{0, }, };
+static struct kmem_cache * bh_cachep = NULL;
+
+/* getblk() statistics, see /proc/buffers */
+static unsigned long getblk_misses = 0;
+static unsigned long getblk_scanned = 0;
+static unsigned long getblk_maxscan = 0;
+
+static void refile_buffer(struct buffer_head * bh);
+static int wakeup_bdflush(int wait);
+
+/*
+ * Tunables for the buffer flush daemon, read and set with sys_bdflush().
+ * The percentages are of nr_buffers, the times in jiffies.
+ */
+#define N_PARAM 5
+
+static union bdflush_param {
+	struct {
+		int nfract;	/* % of buffers dirty before bdflush is woken */
+		int ndirty;	/* max dirty buffers written per wakeup under pressure */
+		int nthrottle;	/* % of buffers dirty before writers wait for bdflush */
+		int interval;	/* time between periodic bdflush runs */
+		int age_buffer;	/* time a buffer may stay dirty before it is written */
+	} b_un;
+	int data[N_PARAM];
+} bdf_prm = {{40, 500, 60, 5*HZ, 30*HZ}};
+
+static int bdflush_min[N_PARAM] = {  0,   10,   0,     HZ/10,     HZ/10};
+static int bdflush_max[N_PARAM] = {100, 5000, 100, 600*HZ, 600*HZ};
+
+static struct task_struct * bdflush_tsk = NULL;
+static struct wait_queue * bdflush_wait = NULL;
+static struct wait_queue * bdflush_done = NULL;
+static unsigned long bdflush_written = 0;
+static unsigned long bdflush_throttled = 0;
+static int bdflush_want = 0;	/* sizes getblk() is waiting on, 1<<isize */
 
 /* öǵȴʹûĶУʹû޷ʱgetblk
  * ڸöеȴͷŻʱѵȴʹûĽ(brelse)
@@ -103,8 +161,8 @@ repeat:
  */
 static int sync_buffers(dev_t dev, int wait)
 {
-	int i, retry, pass = 0, err = 0;
-	struct buffer_head * bh;
+	int i, nlist, isize, retry, pass = 0, err = 0;
+	struct buffer_head * bh, * next;
 
 	/* One pass for no-wait, three for wait:
 	   0) write out all dirty, unlocked buffers;
@@ -113,8 +171,11 @@ static int sync_buffers(dev_t dev, int wait)
 	 */
 repeat:
 	retry = 0;
-	bh = free_list;
-	for (i = nr_buffers*2 ; i-- > 0 ; bh = bh->b_next_free) {
+	for (nlist = 0 ; nlist < NR_LIST ; nlist++)
+	for (isize = 0 ; isize < NR_SIZES ; isize++) {
+	bh = lru_list[nlist][isize];
+	for (i = nr_buffers_type[nlist][isize]*2 ; i-- > 0 && bh ; bh = next) {
+		next = bh->b_next_free;
 		if (dev && bh->b_dev != dev)
 			continue;
 #ifdef 0 /* Disable bad-block debugging code */
@@ -147,9 +208,11 @@ repeat:
 			continue;
 		bh->b_count++;
 		ll_rw_block(WRITE, 1, &bh);
+		refile_buffer(bh);
 		bh->b_count--;
 		retry = 1;
 	}
+	}
 	/* If we are waiting for the sync to succeed, and if any dirty
 	   blocks were written, then repeat; on the second pass, only
 	   wait for buffers being written (do not pass to write any
@@ -205,17 +268,20 @@ asmlinkage int sys_fsync(unsigned int fd)
  */
 void invalidate_buffers(dev_t dev)
 {
-	int i;
+	int i, nlist, isize;
 	struct buffer_head * bh;
 
-	bh = free_list;
-	for (i = nr_buffers*2 ; --i > 0 ; bh = bh->b_next_free) {
+	for (nlist = 0 ; nlist < NR_LIST ; nlist++)
+	for (isize = 0 ; isize < NR_SIZES ; isize++) {
+	bh = lru_list[nlist][isize];
+	for (i = nr_buffers_type[nlist][isize]*2 ; --i > 0 && bh ; bh = bh->b_next_free) {
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
 		if (bh->b_dev == dev)
 			bh->b_uptodate = bh->b_dirt = bh->b_req = 0;
 	}
+	}
 }
 
 /*
@@ -309,72 +375,116 @@ static inline void remove_from_hash_queue(struct buffer_head * bh)
 	bh->b_next = bh->b_prev = NULL;
 }
 
-/* bhfree_listƳ
+/* bhڵlruƳ
  */
-static inline void remove_from_free_list(struct buffer_head * bh)
+static inline void remove_from_lru_list(struct buffer_head * bh)
 {
+	int isize = BUFSIZE_INDEX(bh->b_size);
+
 	if (!(bh->b_prev_free) || !(bh->b_next_free))
-		panic("VFS: Free block list corrupted");
+		panic("VFS: LRU block list corrupted");
 	bh->b_prev_free->b_next_free = bh->b_next_free;
 	bh->b_next_free->b_prev_free = bh->b_prev_free;
-	if (free_list == bh)
-		free_list = bh->b_next_free;
+	if (lru_list[bh->b_list][isize] == bh)
+		lru_list[bh->b_list][isize] = bh->b_next_free;
+	if (lru_list[bh->b_list][isize] == bh)
+		lru_list[bh->b_list][isize] = NULL;
+	nr_buffers_type[bh->b_list][isize]--;
 	bh->b_next_free = bh->b_prev_free = NULL;
 }
 
-/* bhhashfree_listɾ
+/* bhb_listָlruһ
  */
-static inline void remove_from_queues(struct buffer_head * bh)
+static inline void put_last_lru(struct buffer_head * bh)
 {
-	remove_from_hash_queue(bh);
-	remove_from_free_list(bh);
+	struct buffer_head ** list = &lru_list[bh->b_list][BUFSIZE_INDEX(bh->b_size)];
+
+	if (!*list) {
+		*list = bh;
+		bh->b_prev_free = bh;
+	}
+	bh->b_next_free = *list;
+	bh->b_prev_free = (*list)->b_prev_free;
+	(*list)->b_prev_free->b_next_free = bh;
+	(*list)->b_prev_free = bh;
+	nr_buffers_type[bh->b_list][BUFSIZE_INDEX(bh->b_size)]++;
 }
-/* bhףȻfree_listָbh
-  */
-static inline void put_first_free(struct buffer_head * bh)
+
+/* ݻ鵱ǰ״̬óӦһlru */
+static inline int buffer_list(struct buffer_head * bh)
 {
-	if (!bh || (bh == free_list))
-		return;
-	remove_from_free_list(bh);
-/* add to front of free list */
-	bh->b_next_free = free_list;
-	bh->b_prev_free = free_list->b_prev_free;
-	free_list->b_prev_free->b_next_free = bh;
-	free_list->b_prev_free = bh;
-	free_list = bh;
+	if (bh->b_lock)
+		return BUF_LOCKED;
+	if (bh->b_dirt)
+		return BUF_DIRTY;
+	return BUF_CLEAN;
 }
 
-/* bhfiree_listΪ׵һ
+/*
+ * Move the buffer to the end of the lru list that matches its state.
+ * This is also how a buffer is marked as recently used. A buffer going
+ * onto the dirty list is stamped with the time it has to be written by;
+ * as we only notice dirtying here, the age counts from the first refile.
  */
-static inline void put_last_free(struct buffer_head * bh)
+static void refile_buffer(struct buffer_head * bh)
 {
-	if (!bh)
-		return;
-	if (bh == free_list) {
-		free_list = bh->b_next_free;
-		return;
+	remove_from_lru_list(bh);
+	bh->b_list = buffer_list(bh);
+	if (bh->b_list == BUF_DIRTY) {
+		if (!bh->b_flushtime)
+			bh->b_flushtime = jiffies + bdf_prm.b_un.age_buffer;
+	} else if (bh->b_list == BUF_CLEAN)
+		bh->b_flushtime = 0;
+	put_last_lru(bh);
+}
+
+/* nlist״̬ѾԵĻƵȥƶĸ */
+static int refile_misfiled(int nlist, int isize)
+{
+	struct buffer_head * bh, * next;
+	int count, refiled = 0;
+
+	next = lru_list[nlist][isize];
+	for (count = nr_buffers_type[nlist][isize] ; count-- > 0 ; ) {
+		bh = next;
+		next = bh->b_next_free;
+		if (buffer_list(bh) != nlist) {
+			refile_buffer(bh);
+			refiled++;
+		}
 	}
-	remove_from_free_list(bh);
-/* add to back of free list */
-	bh->b_next_free = free_list;
-	bh->b_prev_free = free_list->b_prev_free;
-	free_list->b_prev_free->b_next_free = bh;
-	free_list->b_prev_free = bh;
+	return refiled;
+}
+
+static inline int nr_dirty_buffers(void)
+{
+	int isize, dirty = 0;
+
+	for (isize = 0 ; isize < NR_SIZES ; isize++)
+		dirty += nr_buffers_type[BUF_DIRTY][isize];
+	return dirty;
+}
+
+/* bhhashlruɾ
+ */
+static inline void remove_from_queues(struct buffer_head * bh)
+{
+	remove_from_hash_queue(bh);
+	remove_from_lru_list(bh);
 }
 
-/* bh뵽free_listһ
-  * ΪҿжǴfree_listĵһʼ
+/* bh뵽Ӧlruһ
+  * ΪҿжǴlruĵһʼ
   * ҵģѾӳdevblocksizeʱ
   * Ǵhashĵһʼģ
   * Խ뵽hash
   */
 static inline void insert_into_queues(struct buffer_head * bh)
 {
-/* put at end of free list */
-	bh->b_next_free = free_list;
-	bh->b_prev_free = free_list->b_prev_free;
-	free_list->b_prev_free->b_next_free = bh;
-	free_list->b_prev_free = bh;
+/* put at end of its lru list */
+	bh->b_list = buffer_list(bh);
+	bh->b_flushtime = 0;
+	put_last_lru(bh);
 /* put the buffer in new hash-queue if it has a device */
 	bh->b_prev = NULL;
 	bh->b_next = NULL;
@@ -432,7 +542,7 @@ struct buffer_head * get_hash_table(dev_t dev, int block, int size)
  */
 void set_blocksize(dev_t dev, int size)
 {
-	int i;
+	int i, nlist, isize;
 	struct buffer_head * bh, *bhnext;
 
 	if (!blksize_size[MAJOR(dev)])
@@ -455,10 +565,12 @@ void set_blocksize(dev_t dev, int size)
 	blksize_size[MAJOR(dev)][MINOR(dev)] = size;
 
   /* We need to be quite careful how we do this - we are moving entries
-     around on the free list, and we can get in a loop if we are not careful.*/
+     around on the lru lists, and we can get in a loop if we are not careful.*/
 
-	bh = free_list;
-	for (i = nr_buffers*2 ; --i > 0 ; bh = bhnext) {
+	for (nlist = 0 ; nlist < NR_LIST ; nlist++)
+	for (isize = 0 ; isize < NR_SIZES ; isize++) {
+	bh = lru_list[nlist][isize];
+	for (i = nr_buffers_type[nlist][isize]*2 ; --i > 0 && bh ; bh = bhnext) {
 		bhnext = bh->b_next_free; 
 		if (bh->b_dev != dev)
 			continue;
@@ -469,10 +581,63 @@ void set_blocksize(dev_t dev, int size)
 		if (bh->b_dev == dev && bh->b_size != size)
 			bh->b_uptodate = bh->b_dirt = 0;
 		remove_from_hash_queue(bh);
-/*    put_first_free(bh); */
+	}
+	}
+}
+
+/*
+ * A block that generic_file_read() read ahead is being thrown away
+ * before anybody asked for it: that read was wasted.
+ */
+static inline void forget_reada(struct buffer_head * bh)
+{
+	if (bh->b_reada) {
+		if (bh->b_uptodate)
+			reada_wasted++;
+		bh->b_reada = 0;
 	}
 }
 
+/*
+ * Find a buffer of the given size that getblk() can take over: unused,
+ * clean, unlocked and not shared with a process page. Whatever sits at
+ * the head of the clean list and doesn't qualify is refiled, which moves
+ * it either to the list it belongs on or to the back of this one, so the
+ * usual case looks at a single buffer. Only when the clean list has
+ * nothing do we pull finished writes back off the locked and dirty lists.
+ */
+static struct buffer_head * find_candidate(int isize)
+{
+	struct buffer_head * bh;
+	int i, nlist, refiled, pass = 0, scanned = 0;
+
+	getblk_misses++;
+repeat:
+	for (i = nr_buffers_type[BUF_CLEAN][isize] ; i-- > 0 ; ) {
+		bh = lru_list[BUF_CLEAN][isize];
+		scanned++;
+		if (!bh->b_count && !bh->b_dirt && !bh->b_lock &&
+		    mem_map[MAP_NR((unsigned long) bh->b_data)] == 1)
+			goto out;
+		refile_buffer(bh);
+	}
+	bh = NULL;
+	if (pass++)
+		goto out;
+	refiled = 0;
+	for (nlist = BUF_LOCKED ; nlist < NR_LIST ; nlist++) {
+		scanned += nr_buffers_type[nlist][isize];
+		refiled += refile_misfiled(nlist, isize);
+	}
+	if (refiled)
+		goto repeat;
+out:
+	getblk_scanned += scanned;
+	if (scanned > getblk_maxscan)
+		getblk_maxscan = scanned;
+	return bh;
+}
+
 /*
  * Ok, this is getblk, and it isn't very clear, again to hinder
  * race-conditions. Most of the code is seldom used, (ie repeating),
@@ -489,18 +654,17 @@ void set_blocksize(dev_t dev, int size)
   * ûҵӦĸٻ棬ȥgrow_buffer
   * ע˺һʽĺblockΪ豸߼ţsizeΪ豸ĿС
   */
-#define BADNESS(bh) (((bh)->b_dirt<<1)+(bh)->b_lock)
 struct buffer_head * getblk(dev_t dev, int block, int size)
 {
-	struct buffer_head * bh, * tmp;
-	int buffers;
+	struct buffer_head * bh;
+	int i, isize = BUFSIZE_INDEX(size);
 	static int grow_size = 0;
 
 repeat:
 	bh = get_hash_table(dev, block, size);
 	if (bh) {
 		if (bh->b_uptodate && !bh->b_dirt)
-			put_last_free(bh);
+			refile_buffer(bh);
 		return bh;
 	}
 	grow_size -= size;
@@ -508,32 +672,28 @@ repeat:
 		if (grow_buffers(GFP_BUFFER, size))
 			grow_size = PAGE_SIZE;
 	}
-	buffers = nr_buffers;
-	bh = NULL;
 
-	/* ɨ
-	 */
-	for (tmp = free_list; buffers-- > 0 ; tmp = tmp->b_next_free) {
-		if (tmp->b_count || tmp->b_size != size)
-			continue;
-		if (mem_map[MAP_NR((unsigned long) tmp->b_data)] != 1)
-			continue;
-		if (!bh || BADNESS(tmp)<BADNESS(bh)) {
-			bh = tmp;
-			/*ǸɾҲûбסû*/
-			if (!BADNESS(tmp))
-				break;
-		}
-#if 0
-		if (tmp->b_dirt) {
-			tmp->b_count++;
-			ll_rw_block(WRITEA, 1, &tmp);
-			tmp->b_count--;
-		}
-#endif
-	}
+	/* ֻСĸɾ */
+	bh = find_candidate(isize);
 
 	if (!bh) {
+		/* ûиɾĻ飺ȵһдĻ飬
+		 * ٲоͰдȥдǻصɾ
+		 */
+		bh = lru_list[BUF_LOCKED][isize];
+		for (i = nr_buffers_type[BUF_LOCKED][isize] ; i-- > 0 ; bh = bh->b_next_free)
+			if (!bh->b_count && bh->b_lock) {
+				wait_on_buffer(bh);
+				goto repeat;
+			}
+		if (nr_buffers_type[BUF_DIRTY][isize]) {
+			unsigned long written = bdflush_written;
+
+			bdflush_want |= 1 << isize;
+			if (!wakeup_bdflush(1) || bdflush_written == written)
+				sync_buffers(0,0);
+			goto repeat;
+		}
 		if (nr_free_pages > 5)
 			if (grow_buffers(GFP_BUFFER, size))
 				goto repeat;
@@ -564,6 +724,7 @@ repeat:
 /* ʱȷʹøøٻ棬
   * Ȼü豸ţŵȱ
   */
+	forget_reada(bh);
 	bh->b_count=1;
 	bh->b_dirt=0;
 	bh->b_uptodate=0;
@@ -588,7 +749,14 @@ void brelse(struct buffer_head * buf)
 		 */
 		if (--buf->b_count)
 			return;
+		refile_buffer(buf);
 		wake_up(&buffer_wait);
+		if (buf->b_list == BUF_DIRTY) {
+			int dirty = nr_dirty_buffers() * 100;
+
+			if (dirty > bdf_prm.b_un.nfract * nr_buffers)
+				wakeup_bdflush(dirty > bdf_prm.b_un.nthrottle * nr_buffers);
+		}
 		return;
 	}
 	printk("VFS: brelse: Trying to free free buffer\n");
@@ -672,7 +840,7 @@ struct buffer_head * breada(dev_t dev,int first, ...)
  * See fs/inode.c for the weird use of volatile..
  */
 
-/* ûͷգȴУbhunused_list
+/* ûͷգȴУbh󻺴
  */
 static void put_unused_buffer_head(struct buffer_head * bh)
 {
@@ -681,48 +849,29 @@ static void put_unused_buffer_head(struct buffer_head * bh)
 	wait = ((volatile struct buffer_head *) bh)->b_wait;
 	memset((void *) bh,0,sizeof(*bh));
 	((volatile struct buffer_head *) bh)->b_wait = wait;
-	bh->b_next_free = unused_list;
-	unused_list = bh;
+	kmem_cache_free(bh_cachep, bh);
+	nr_buffer_heads--;
 }
 
-/* Ļͷǲûָͷָb_data
+/*
+ * Buffer heads go back to the cache already cleared, so the constructor
+ * only has to clear fresh ones. The cache is created KMEM_NOREAP: as
+ * above, somebody may still be sleeping on a released head's b_wait.
  */
-static void get_more_buffer_heads(void)
+static void init_buffer_head(void * bh)
 {
-	int i;
-	struct buffer_head * bh;
-
-	/*δʹõĻͷ*/
-	if (unused_list)
-		return;
-
-	if(! (bh = (struct buffer_head*) get_free_page(GFP_BUFFER)))
-		return;
-	/* һҳڴ棬עǵӣ
-	 * ҽunused_listָףͬʱӻͷ
-	 */
-	for (nr_buffer_heads+=i=PAGE_SIZE/sizeof*bh ; i>0; i--) {
-		bh->b_next_free = unused_list;	/* only make link */
-		unused_list = bh++;
-	}
+	memset(bh, 0, sizeof(struct buffer_head));
 }
 
-/* ӻͷunused_listȡһڵ
- * ʼ
+/* ӻͷ󻺴ȡһյĻͷ
  */
 static struct buffer_head * get_unused_buffer_head(void)
 {
 	struct buffer_head * bh;
 
-	get_more_buffer_heads();
-	if (!unused_list)
-		return NULL;
-	bh = unused_list;
-	unused_list = bh->b_next_free;
-	bh->b_next_free = NULL;
-	bh->b_data = NULL;
-	bh->b_size = 0;
-	bh->b_req = 0;
+	bh = (struct buffer_head *) kmem_cache_alloc(bh_cachep, GFP_BUFFER);
+	if (bh)
+		nr_buffer_heads++;
 	return bh;
 }
 
@@ -1010,7 +1159,7 @@ static int grow_buffers(int pri, int size)
 
 	/* bufferĴСҪô512KB,Ҫô1024KB
 	 */
-	if ((size & 511) || (size > PAGE_SIZE)) {
+	if ((size & 511) || (size > PAGE_SIZE) || BUFSIZE_INDEX(size) < 0) {
 		printk("VFS: grow_buffers: size = %d\n",size);
 		return 0;
 	}
@@ -1022,19 +1171,12 @@ static int grow_buffers(int pri, int size)
 		return 0;
 	}
 	tmp = bh;
-	/* ղŷһҹڴӦĻͷӵfree_list˫
+	/* ղŷһҹڴӦĻͷӵӦСĸɾ
 	 */
 	while (1) {
-		if (free_list) {
-			tmp->b_next_free = free_list;
-			tmp->b_prev_free = free_list->b_prev_free;
-			free_list->b_prev_free->b_next_free = tmp;
-			free_list->b_prev_free = tmp;
-		} else {
-			tmp->b_prev_free = tmp;
-			tmp->b_next_free = tmp;
-		}
-		free_list = tmp;
+		tmp->b_list = BUF_CLEAN;
+		put_last_lru(tmp);
+		lru_list[BUF_CLEAN][BUFSIZE_INDEX(size)] = tmp;
 		++nr_buffers; /*ӻ*/
 		if (tmp->b_this_page)
 			tmp = tmp->b_this_page;
@@ -1083,6 +1225,7 @@ static int try_to_free(struct buffer_head * bh, struct buffer_head ** bhp)
 		nr_buffers--;
 		if (p == *bhp)
 			*bhp = p->b_prev_free;
+		forget_reada(p);
 		remove_from_queues(p);
 		put_unused_buffer_head(p);
 	} while (tmp != bh);
@@ -1104,17 +1247,20 @@ static int try_to_free(struct buffer_head * bh, struct buffer_head ** bhp)
 int shrink_buffers(unsigned int priority)
 {
 	struct buffer_head *bh;
-	int i;
+	int i, nlist, isize;
 
 	if (priority < 2)
 		sync_buffers(0,0);
-	bh = free_list;
-	i = nr_buffers >> priority;
-	for ( ; i-- > 0 ; bh = bh->b_next_free) {
+	for (nlist = 0 ; nlist < NR_LIST ; nlist++)
+	for (isize = 0 ; isize < NR_SIZES ; isize++) {
+	bh = lru_list[nlist][isize];
+	i = nr_buffers_type[nlist][isize] >> priority;
+	for ( ; i-- > 0 && bh ; bh = bh->b_next_free) {
+		reclaim_stat[RECLAIM_BUFFERS].scan++;
 		if (bh->b_count ||
 		    (priority >= 5 &&
 		     mem_map[MAP_NR((unsigned long) bh->b_data)] > 1)) {
-			put_last_free(bh);
+			refile_buffer(bh);
 			continue;
 		}
 		if (!bh->b_this_page)
@@ -1136,30 +1282,68 @@ int shrink_buffers(unsigned int priority)
 		if (try_to_free(bh, &bh))
 			return 1;
 	}
+	}
 	return 0;
 }
 
 void show_buffers(void)
 {
 	struct buffer_head * bh;
-	int found = 0, locked = 0, dirty = 0, used = 0, lastused = 0;
+	int found, locked, dirty, used, lastused, nlist, isize;
+	static char *buf_types[NR_LIST] = {"CLEAN","LOCKED","DIRTY"};
 
 	printk("Buffer memory:   %6dkB\n",buffermem>>10);
 	printk("Buffer heads:    %6d\n",nr_buffer_heads);
 	printk("Buffer blocks:   %6d\n",nr_buffers);
-	bh = free_list;
-	do {
-		found++;
-		if (bh->b_lock)
-			locked++;
-		if (bh->b_dirt)
-			dirty++;
-		if (bh->b_count)
-			used++, lastused = found;
-		bh = bh->b_next_free;
-	} while (bh != free_list);
-	printk("Buffer mem: %d buffers, %d used (last=%d), %d locked, %d dirty\n",
-		found, used, lastused, locked, dirty);
+	for (nlist = 0 ; nlist < NR_LIST ; nlist++)
+	for (isize = 0 ; isize < NR_SIZES ; isize++) {
+		found = locked = dirty = used = lastused = 0;
+		bh = lru_list[nlist][isize];
+		if (!bh)
+			continue;
+		do {
+			found++;
+			if (bh->b_lock)
+				locked++;
+			if (bh->b_dirt)
+				dirty++;
+			if (bh->b_count)
+				used++, lastused = found;
+			bh = bh->b_next_free;
+		} while (bh != lru_list[nlist][isize]);
+		printk("Buffer[%d] %-6s: %d buffers, %d used (last=%d), %d locked, %d dirty\n",
+			512 << isize, buf_types[nlist], found, used, lastused,
+			locked, dirty);
+	}
+	printk("getblk: %lu misses, %lu scanned, %lu max\n",
+		getblk_misses, getblk_scanned, getblk_maxscan);
+}
+
+/*
+ * /proc/buffers: the length of every lru list, and how many buffers
+ * getblk() had to look at to find one it could reuse.
+ */
+int get_buffer_info(char * buffer)
+{
+	int nlist, isize, len;
+
+	len = sprintf(buffer, "size   clean  locked   dirty\n");
+	for (isize = 0 ; isize < NR_SIZES ; isize++) {
+		len += sprintf(buffer+len, "%4d", 512 << isize);
+		for (nlist = 0 ; nlist < NR_LIST ; nlist++)
+			len += sprintf(buffer+len, " %7d",
+				nr_buffers_type[nlist][isize]);
+		buffer[len++] = '\n';
+	}
+	len += sprintf(buffer+len,
+		"getblk misses: %lu\n"
+		"getblk scanned: %lu\n"
+		"getblk max scan: %lu\n"
+		"bdflush written: %lu\n"
+		"bdflush throttled: %lu\n",
+		getblk_misses, getblk_scanned, getblk_maxscan,
+		bdflush_written, bdflush_throttled);
+	return len;
 }
 
 /*
@@ -1182,11 +1366,161 @@ void buffer_init(void)
 		min_free_pages = 20;
 	for (i = 0 ; i < NR_HASH ; i++)
 		hash_table[i] = NULL;
-	free_list = 0;
+	bh_cachep = kmem_cache_create("buffer_head", sizeof(struct buffer_head),
+		0, KMEM_NOREAP, init_buffer_head);
+	if (!bh_cachep)
+		panic("VFS: Unable to create the buffer head cache!");
 	/* һʼһҳĸٻ
 	 */
 	grow_buffers(GFP_KERNEL, BLOCK_SIZE);
-	if (!free_list)
+	if (!lru_list[BUF_CLEAN][BUFSIZE_INDEX(BLOCK_SIZE)])
 		panic("VFS: Unable to initialize buffer free list!");
 	return;
 }
+
+/*
+ * The buffer flush daemon. Instead of leaving all writeback to sync()
+ * and to getblk() running out of clean buffers, a process sits in
+ * sys_bdflush(0,0) and writes out buffers that have been dirty for longer
+ * than age_buffer, and more whenever the dirty buffers go above nfract
+ * percent of the cache. Writers that push it above nthrottle percent
+ * wait in brelse() until the daemon has had a go.
+ *
+ * The daemon only does ll_rw_block() on buffers. It never takes inode
+ * or superblock locks, so a throttled writer can't deadlock against it.
+ */
+#define NBUF 32
+
+/*
+ * Write up to max dirty buffers of one size, at most NBUF of one device
+ * at a time, sorted by block number and handed to ll_rw_block() in one
+ * go so the drive sees them in elevator order. With age set only
+ * buffers whose flush time has passed are written.
+ */
+static int flush_dirty_size(int isize, int age, int max)
+{
+	struct buffer_head * bh, * next, * bharr[NBUF];
+	int i, n, count, written = 0;
+
+	while (written < max) {
+		n = 0;
+		next = lru_list[BUF_DIRTY][isize];
+		for (count = nr_buffers_type[BUF_DIRTY][isize] ;
+		     count-- > 0 && n < NBUF && written + n < max ; ) {
+			bh = next;
+			next = bh->b_next_free;
+			if (!bh->b_dirt || bh->b_lock)
+				continue;
+			if (age && bh->b_flushtime > jiffies)
+				continue;
+			if (n && bh->b_dev != bharr[0]->b_dev)
+				continue;
+			bh->b_count++;
+			for (i = n++ ; i > 0 && bharr[i-1]->b_blocknr > bh->b_blocknr ; i--)
+				bharr[i] = bharr[i-1];
+			bharr[i] = bh;
+		}
+		if (!n)
+			break;
+		ll_rw_block(WRITE, n, bharr);
+		for (i = 0 ; i < n ; i++) {
+			refile_buffer(bharr[i]);
+			bharr[i]->b_count--;
+		}
+		written += n;
+	}
+	bdflush_written += written;
+	return written;
+}
+
+static int flush_dirty_buffers(int age, int max)
+{
+	int isize, written = 0;
+
+	for (isize = 0 ; isize < NR_SIZES && written < max ; isize++)
+		written += flush_dirty_size(isize, age, max - written);
+	return written;
+}
+
+/*
+ * Wake the daemon, and if wait is set sleep until it has been through
+ * its loop once. Returns 0 if there is no daemon to do the work.
+ */
+static int wakeup_bdflush(int wait)
+{
+	if (!bdflush_tsk || current == bdflush_tsk)
+		return 0;
+	wake_up(&bdflush_wait);
+	if (wait) {
+		bdflush_throttled++;
+		sleep_on(&bdflush_done);
+	}
+	return 1;
+}
+
+/*
+ * func 0 turns the calling process into the flush daemon, which only
+ * returns on a signal. func 1 writes out the buffers that are due.
+ * func 2*n+2 reads tunable n into *data, func 2*n+3 sets it to data.
+ */
+asmlinkage int sys_bdflush(int func, long data)
+{
+	int i, error, dirty, want;
+
+	if (!suser())
+		return -EPERM;
+	if (func == 1) {
+		for (i = 0 ; i < NR_SIZES ; i++) {
+			refile_misfiled(BUF_CLEAN, i);
+			refile_misfiled(BUF_LOCKED, i);
+		}
+		return flush_dirty_buffers(1, nr_buffers);
+	}
+	if (func >= 2) {
+		i = (func-2) >> 1;
+		if (i >= N_PARAM)
+			return -EINVAL;
+		if ((func & 1) == 0) {
+			error = verify_area(VERIFY_WRITE, (void *) data, sizeof(int));
+			if (error)
+				return error;
+			put_fs_long(bdf_prm.data[i], (unsigned long *) data);
+			return 0;
+		}
+		if (data < bdflush_min[i] || data > bdflush_max[i])
+			return -EINVAL;
+		bdf_prm.data[i] = data;
+		return 0;
+	}
+	if (func)
+		return -EINVAL;
+	if (bdflush_tsk)
+		return -EBUSY;
+	bdflush_tsk = current;
+	strcpy(current->comm, "bdflush");
+	for (;;) {
+		/* дڵģдgetblk()ҪĴС̫ʱٲдһ */
+		for (i = 0 ; i < NR_SIZES ; i++) {
+			refile_misfiled(BUF_CLEAN, i);
+			refile_misfiled(BUF_LOCKED, i);
+		}
+		flush_dirty_buffers(1, nr_buffers);
+		want = bdflush_want;
+		bdflush_want = 0;
+		for (i = 0 ; i < NR_SIZES ; i++)
+			if (want & (1 << i))
+				flush_dirty_size(i, 0, NBUF);
+		dirty = nr_dirty_buffers() * 100;
+		if (dirty > bdf_prm.b_un.nfract * nr_buffers)
+			flush_dirty_buffers(0, bdf_prm.b_un.ndirty);
+		wake_up(&bdflush_done);
+		if (current->signal & ~current->blocked)
+			break;
+		current->timeout = jiffies + bdf_prm.b_un.interval;
+		interruptible_sleep_on(&bdflush_wait);
+		current->timeout = 0;
+	}
+	bdflush_tsk = NULL;
+	wake_up(&bdflush_done);
+	return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ *  linux/fs/dcache.c
+ *
+ * The name cache sits in front of the filesystems' lookup() ops: it
+ * maps (directory, name) to an inode number, or remembers that the
+ * name doesn't exist (ino 0, a negative entry).
+ *
+ * Nothing is ever looked for to invalidate. Each entry records the
+ * i_version its directory had when the entry was made, and only
+ * matches while the directory still has that version. The namei.c
+ * functions that change a directory give it a new version afterwards
+ * (dcache_changed()), and an inode that is read back in gets a new
+ * version too, so old entries simply stop matching and fall off the
+ * end of the LRU list.
+ */
+
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/string.h>
+#include <linux/malloc.h>
+
+#define DCACHE_SIZE	1024		/* most entries kept at once */
+#define DCACHE_HASH	256		/* must be a power of two */
+
+struct dir_cache_entry {
+	struct dir_cache_entry * hash_next, * hash_prev;
+	struct dir_cache_entry * lru_next, * lru_prev;
+	dev_t dev;
+	unsigned long dir;
+	unsigned long version;
+	unsigned long ino;		/* 0: the name doesn't exist */
+	unsigned long hash;
+	int len;
+	char name[1];
+};
+
+unsigned long event = 0;
+
+static struct dir_cache_entry * hash_table[DCACHE_HASH];
+static struct dir_cache_entry * lru_head = NULL;	/* least recently used */
+static int nr_entries = 0;
+
+static inline unsigned long name_hash(const char * name, int len)
+{
+	unsigned long hash = 0;
+
+	while (len-- > 0)
+		hash = (hash << 4) ^ (hash >> 28) ^ (unsigned char) *name++;
+	return hash;
+}
+
+#define hashfn(dev,dir,hash) \
+	(hash_table + (((dev) ^ (dir) ^ (hash)) & (DCACHE_HASH - 1)))
+
+static inline void remove_lru(struct dir_cache_entry * de)
+{
+	de->lru_next->lru_prev = de->lru_prev;
+	de->lru_prev->lru_next = de->lru_next;
+	if (lru_head == de)
+		lru_head = de->lru_next;
+	if (lru_head == de)
+		lru_head = NULL;
+}
+
+/* the most recently used entry goes just before the head */
+static inline void add_lru(struct dir_cache_entry * de)
+{
+	if (!lru_head) {
+		lru_head = de->lru_next = de->lru_prev = de;
+		return;
+	}
+	de->lru_next = lru_head;
+	de->lru_prev = lru_head->lru_prev;
+	lru_head->lru_prev->lru_next = de;
+	lru_head->lru_prev = de;
+}
+
+static inline void remove_hash(struct dir_cache_entry * de)
+{
+	if (de->hash_next)
+		de->hash_next->hash_prev = de->hash_prev;
+	if (de->hash_prev)
+		de->hash_prev->hash_next = de->hash_next;
+	else
+		*hashfn(de->dev, de->dir, de->hash) = de->hash_next;
+}
+
+static inline void add_hash(struct dir_cache_entry * de)
+{
+	struct dir_cache_entry ** head = hashfn(de->dev, de->dir, de->hash);
+
+	de->hash_prev = NULL;
+	if ((de->hash_next = *head) != NULL)
+		de->hash_next->hash_prev = de;
+	*head = de;
+}
+
+static struct dir_cache_entry * find_entry(struct inode * dir,
+	const char * name, int len, unsigned long hash)
+{
+	struct dir_cache_entry * de;
+
+	for (de = *hashfn(dir->i_dev, dir->i_ino, hash) ; de ; de = de->hash_next) {
+		if (de->hash != hash || de->dir != dir->i_ino ||
+		    de->dev != dir->i_dev || de->len != len)
+			continue;
+		if (!memcmp(de->name, name, len))
+			return de;
+	}
+	return NULL;
+}
+
+static void free_entry(struct dir_cache_entry * de)
+{
+	remove_hash(de);
+	remove_lru(de);
+	nr_entries--;
+	kfree_s(de, sizeof(*de) + de->len);
+}
+
+/*
+ * Returns 1 and sets *ino if the cache knows the answer; *ino is 0 if
+ * the name is known not to exist. An entry that is out of date is
+ * dropped on the way.
+ */
+int dcache_lookup(struct inode * dir, const char * name, int len,
+	unsigned long * ino)
+{
+	struct dir_cache_entry * de;
+
+	if (!(de = find_entry(dir, name, len, name_hash(name, len))))
+		return 0;
+	if (de->version != dir->i_version) {
+		free_entry(de);
+		return 0;
+	}
+	remove_lru(de);
+	add_lru(de);
+	*ino = de->ino;
+	return 1;
+}
+
+/*
+ * version is what dir->i_version was before the filesystem was asked:
+ * if the directory changed while it looked, the answer may be stale and
+ * isn't kept.
+ */
+void dcache_add(struct inode * dir, const char * name, int len,
+	unsigned long ino, unsigned long version)
+{
+	struct dir_cache_entry * de;
+	unsigned long hash;
+
+	if (version != dir->i_version)
+		return;
+	hash = name_hash(name, len);
+	if ((de = find_entry(dir, name, len, hash)) != NULL) {
+		de->version = version;
+		de->ino = ino;
+		remove_lru(de);
+		add_lru(de);
+		return;
+	}
+	if (nr_entries >= DCACHE_SIZE)
+		free_entry(lru_head);
+	de = (struct dir_cache_entry *) kmalloc(sizeof(*de) + len, GFP_ATOMIC);
+	if (!de)
+		return;
+	de->dev = dir->i_dev;
+	de->dir = dir->i_ino;
+	de->version = version;
+	de->ino = ino;
+	de->hash = hash;
+	de->len = len;
+	memcpy(de->name, name, len);
+	de->name[len] = '\0';
+	add_hash(de);
+	add_lru(de);
+	nr_entries++;
+}
+
+/* called when a filesystem is unmounted: its entries can't match again */
+void dcache_invalidate(dev_t dev)
+{
+	struct dir_cache_entry * de, * next;
+	int i;
+
+	for (i = 0 ; i < DCACHE_HASH ; i++) {
+		for (de = hash_table[i] ; de ; de = next) {
+			next = de->hash_next;
+			if (de->dev == dev)
+				free_entry(de);
+		}
+	}
+}
@@ -0,0 +1,455 @@
+/*
+ *  linux/fs/eventpoll.c
+ *
+ * Persistent readiness sets. select() calls the driver's select()
+ * operation for every fd on every call and again after every wakeup,
+ * and queues the caller on all the wait queues from scratch each time.
+ * That is a lot of work per event for a daemon that watches a few
+ * hundred sockets and ttys.
+ *
+ * epoll_create() returns an fd for an empty set. epoll_ctl() adds a file
+ * to the set once. The file's select() operation is called with a
+ * select_table whose entries carry ep_poll_callback() instead of a task.
+ * Those entries stay on the driver's wait queues, and a wake_up() on any
+ * of them puts the item on the set's ready list. epoll_wait() only looks
+ * at the items on that list. It asks their select() operation, without
+ * a table, whether they really are ready.
+ *
+ * Readiness is level triggered by default, like select() and poll().
+ * An item that is still ready goes back on the list, so the next
+ * epoll_wait() reports it again. With EPOLLET the item is dropped from
+ * the list once reported, and is only seen again after the next wakeup.
+ *
+ * A set holds no reference to its files. The last close of a file takes
+ * it out of every set, through eventpoll_release().
+ */
+
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/stat.h>
+#include <linux/fcntl.h>
+#include <linux/mm.h>
+#include <linux/malloc.h>
+#include <linux/string.h>
+#include <linux/eventpoll.h>
+
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define ep_hashfn(fd) ((fd) & (EP_HASH_SIZE-1))
+
+static struct file_operations eventpoll_fops;
+
+/*
+ * Put an item on the ready list of its set, unless it is there already.
+ * Interrupts must be off.
+ */
+static inline void __ep_queue(struct eventpoll * ep, struct epitem * epi)
+{
+	if (epi->ready)
+		return;
+	epi->ready = 1;
+	epi->rdnext = NULL;
+	*ep->ready_tail = epi;
+	ep->ready_tail = &epi->rdnext;
+}
+
+static void ep_queue(struct eventpoll * ep, struct epitem * epi)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	__ep_queue(ep, epi);
+	restore_flags(flags);
+	wake_up_interruptible(&ep->wait);
+}
+
+static void ep_unqueue(struct eventpoll * ep, struct epitem * epi)
+{
+	struct epitem ** p;
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	if (epi->ready) {
+		for (p = &ep->ready ; *p != epi ; p = &(*p)->rdnext)
+			/* nothing */;
+		if (!(*p = epi->rdnext))
+			ep->ready_tail = p;
+		epi->ready = 0;
+	}
+	restore_flags(flags);
+}
+
+/*
+ * This is what wake_up() calls for the entries an item has on its
+ * file's wait queues. It may be called from an interrupt.
+ */
+static void ep_poll_callback(struct wait_queue * wait)
+{
+	struct epitem * epi;
+
+	epi = (struct epitem *) ((struct select_table_entry *) wait)->data;
+	ep_queue(epi->ep, epi);
+}
+
+/*
+ * Ask the file which of the events it is ready for. With a table, this
+ * also puts the item on the file's wait queues, as select() does.
+ */
+static unsigned long ep_check(struct epitem * epi, select_table * wait)
+{
+	struct file * file = epi->file;
+	struct inode * inode = file->f_inode;
+	unsigned long events = epi->event.events & (EPOLLIN | EPOLLOUT | EPOLLPRI);
+	unsigned long revents = 0;
+	int (*select) (struct inode *, struct file *, int, select_table *);
+
+	if (!file->f_op || !(select = file->f_op->select)) {
+		if (S_ISREG(inode->i_mode))
+			return events;
+		return 0;
+	}
+	if ((events & EPOLLIN) && select(inode, file, SEL_IN, wait))
+		revents |= EPOLLIN;
+	if ((events & EPOLLOUT) && select(inode, file, SEL_OUT, wait))
+		revents |= EPOLLOUT;
+	if ((events & EPOLLPRI) && select(inode, file, SEL_EX, wait))
+		revents |= EPOLLPRI;
+	return revents;
+}
+
+/*
+ * Start watching: wait on the file's queues, then look again in case
+ * it became ready before we got on them.
+ */
+static void ep_arm(struct eventpoll * ep, struct epitem * epi)
+{
+	if (ep_check(epi, &epi->wait) || ep_check(epi, NULL))
+		ep_queue(ep, epi);
+}
+
+static struct epitem * ep_find(struct eventpoll * ep, int fd, struct file * file)
+{
+	struct epitem * epi;
+
+	for (epi = ep->hash[ep_hashfn(fd)] ; epi ; epi = epi->next)
+		if (epi->fd == fd && epi->file == file)
+			return epi;
+	return NULL;
+}
+
+static int ep_insert(struct eventpoll * ep, struct epoll_event * event,
+	struct file * file, int fd)
+{
+	struct epitem * epi;
+
+	epi = (struct epitem *) kmalloc(sizeof(*epi), GFP_KERNEL);
+	if (!epi)
+		return -ENOMEM;
+	epi->ep = ep;
+	epi->file = file;
+	epi->fd = fd;
+	epi->ready = 0;
+	epi->rdnext = NULL;
+	epi->event = *event;
+	epi->wait.nr = 0;
+	epi->wait.max = EP_NR_WAIT;
+	epi->wait.entry = epi->entry;
+	epi->wait.more = NULL;
+	epi->wait.func = ep_poll_callback;
+	epi->wait.data = epi;
+	epi->next = ep->hash[ep_hashfn(fd)];
+	ep->hash[ep_hashfn(fd)] = epi;
+	epi->f_next = file->f_ep;
+	file->f_ep = epi;
+	ep->nr_items++;
+	ep_arm(ep, epi);
+	return 0;
+}
+
+static void ep_modify(struct eventpoll * ep, struct epitem * epi,
+	struct epoll_event * event)
+{
+	/* the events decide which queues the driver puts us on */
+	free_wait(&epi->wait);
+	ep_unqueue(ep, epi);
+	epi->event = *event;
+	ep_arm(ep, epi);
+}
+
+static void ep_remove(struct eventpoll * ep, struct epitem * epi)
+{
+	struct epitem ** p;
+
+	/* once off the wait queues, no callback can queue it again */
+	free_wait(&epi->wait);
+	ep_unqueue(ep, epi);
+	for (p = &ep->hash[ep_hashfn(epi->fd)] ; *p != epi ; p = &(*p)->next)
+		/* nothing */;
+	*p = epi->next;
+	for (p = &epi->file->f_ep ; *p != epi ; p = &(*p)->f_next)
+		/* nothing */;
+	*p = epi->f_next;
+	ep->nr_items--;
+	kfree_s(epi, sizeof(*epi));
+}
+
+/*
+ * The last close of a file: take it out of all the sets it is in.
+ */
+void eventpoll_release(struct file * file)
+{
+	struct epitem * epi;
+
+	while ((epi = file->f_ep) != NULL)
+		ep_remove(epi->ep, epi);
+}
+
+/*
+ * Move the items that are really ready off the ready list and into buf.
+ * Items we report go back on the list unless they are edge triggered;
+ * the ones we have no room for stay where they are.
+ *
+ * Pipes, ttys and most other drivers return from select() before they
+ * get to select_wait() when they are ready, so an item armed while ready
+ * may be on none of its file's wait queues. Items that turn out not to
+ * be ready are armed again here, and edge triggered items stay on the
+ * list until they are on at least one queue.
+ */
+static int ep_collect(struct eventpoll * ep, struct epoll_event * buf, int maxevents)
+{
+	struct epitem * list, * epi;
+	unsigned long flags, revents;
+	int count = 0;
+
+	save_flags(flags);
+	cli();
+	list = ep->ready;
+	ep->ready = NULL;
+	ep->ready_tail = &ep->ready;
+	restore_flags(flags);
+	while ((epi = list) != NULL && count < maxevents) {
+		list = epi->rdnext;
+		/* a wakeup from now on queues it again */
+		epi->ready = 0;
+		if (!(revents = ep_check(epi, NULL))) {
+			free_wait(&epi->wait);
+			if (!ep_check(epi, &epi->wait))
+				continue;
+			cli();
+			__ep_queue(ep, epi);
+			restore_flags(flags);
+			continue;
+		}
+		buf[count].events = revents;
+		buf[count].data = epi->event.data;
+		count++;
+		if ((epi->event.events & EPOLLET) && epi->wait.nr)
+			continue;
+		cli();
+		__ep_queue(ep, epi);
+		restore_flags(flags);
+	}
+	if (list) {
+		for (epi = list ; epi->rdnext ; epi = epi->rdnext)
+			/* nothing */;
+		cli();
+		if (!(epi->rdnext = ep->ready))
+			ep->ready_tail = &epi->rdnext;
+		ep->ready = list;
+		restore_flags(flags);
+	}
+	return count;
+}
+
+static int ep_select(struct inode * inode, struct file * file, int flag,
+	select_table * wait)
+{
+	struct eventpoll * ep = inode->u.eventpoll_i;
+
+	if (flag != SEL_IN)
+		return 0;
+	if (ep->ready)
+		return 1;
+	select_wait(&ep->wait, wait);
+	return 0;
+}
+
+static void ep_release(struct inode * inode, struct file * file)
+{
+	struct eventpoll * ep = inode->u.eventpoll_i;
+	int i;
+
+	for (i = 0 ; i < EP_HASH_SIZE ; i++)
+		while (ep->hash[i])
+			ep_remove(ep, ep->hash[i]);
+	inode->u.eventpoll_i = NULL;
+	kfree_s(ep, sizeof(*ep));
+}
+
+static struct file_operations eventpoll_fops = {
+	NULL,		/* lseek */
+	NULL,		/* read */
+	NULL,		/* write */
+	NULL,		/* readdir */
+	ep_select,
+	NULL,		/* ioctl */
+	NULL,		/* mmap */
+	NULL,		/* open */
+	ep_release,
+	NULL		/* fsync */
+};
+
+static struct eventpoll * ep_get(unsigned int epfd, int * error)
+{
+	struct file * file;
+
+	*error = -EBADF;
+	if (epfd >= NR_OPEN || !(file = current->filp[epfd]))
+		return NULL;
+	*error = -EINVAL;
+	if (file->f_op != &eventpoll_fops)
+		return NULL;
+	return file->f_inode->u.eventpoll_i;
+}
+
+/*
+ * size is only a hint for how many files will be added, and isn't used.
+ */
+asmlinkage int sys_epoll_create(int size)
+{
+	struct eventpoll * ep;
+	struct inode * inode;
+	struct file * f;
+	int fd;
+
+	if (size <= 0)
+		return -EINVAL;
+	for (fd = 0 ; fd < NR_OPEN ; fd++)
+		if (!current->filp[fd])
+			break;
+	if (fd >= NR_OPEN)
+		return -EMFILE;
+	if (!(f = get_empty_filp()))
+		return -ENFILE;
+	ep = (struct eventpoll *) kmalloc(sizeof(*ep), GFP_KERNEL);
+	if (!ep) {
+		f->f_count--;
+		return -ENOMEM;
+	}
+	if (!(inode = get_empty_inode())) {
+		kfree_s(ep, sizeof(*ep));
+		f->f_count--;
+		return -ENFILE;
+	}
+	memset(ep, 0, sizeof(*ep));
+	ep->ready_tail = &ep->ready;
+	inode->i_mode = S_IRUSR | S_IWUSR;
+	inode->i_uid = current->euid;
+	inode->i_gid = current->egid;
+	inode->u.eventpoll_i = ep;
+	f->f_inode = inode;
+	f->f_op = &eventpoll_fops;
+	f->f_mode = 1;
+	f->f_flags = O_RDONLY;
+	f->f_pos = 0;
+	FD_CLR(fd, &current->close_on_exec);
+	current->filp[fd] = f;
+	return fd;
+}
+
+asmlinkage int sys_epoll_ctl(unsigned int epfd, int op, unsigned int fd,
+	struct epoll_event * event)
+{
+	struct eventpoll * ep;
+	struct epitem * epi;
+	struct file * file;
+	struct epoll_event ev;
+	int error;
+
+	if (!(ep = ep_get(epfd, &error)))
+		return error;
+	if (op != EPOLL_CTL_DEL) {
+		error = verify_area(VERIFY_READ, event, sizeof(ev));
+		if (error)
+			return error;
+		memcpy_fromfs(&ev, event, sizeof(ev));
+	}
+	if (fd >= NR_OPEN || !(file = current->filp[fd]) || !file->f_inode)
+		return -EBADF;
+	/* sets can't watch sets: a wakeup must not go round in circles */
+	if (file->f_op == &eventpoll_fops)
+		return -EINVAL;
+	epi = ep_find(ep, fd, file);
+	switch (op) {
+		case EPOLL_CTL_ADD:
+			if (epi)
+				return -EEXIST;
+			return ep_insert(ep, &ev, file, fd);
+		case EPOLL_CTL_DEL:
+			if (!epi)
+				return -ENOENT;
+			ep_remove(ep, epi);
+			return 0;
+		case EPOLL_CTL_MOD:
+			if (!epi)
+				return -ENOENT;
+			ep_modify(ep, epi, &ev);
+			return 0;
+	}
+	return -EINVAL;
+}
+
+/*
+ * timeout is in milliseconds; a negative one waits forever.
+ */
+asmlinkage int sys_epoll_wait(unsigned int epfd, struct epoll_event * events,
+	int maxevents, int timeout)
+{
+	struct wait_queue wait = { current, NULL };
+	struct eventpoll * ep;
+	struct epoll_event * buf;
+	int count, error;
+
+	if (!(ep = ep_get(epfd, &error)))
+		return error;
+	if (maxevents <= 0)
+		return -EINVAL;
+	if (maxevents > EP_MAX_EVENTS)
+		maxevents = EP_MAX_EVENTS;
+	error = verify_area(VERIFY_WRITE, events, maxevents * sizeof(struct epoll_event));
+	if (error)
+		return error;
+	/* collect into a kernel buffer: we can't fault while TASK_INTERRUPTIBLE */
+	if (!(buf = (struct epoll_event *) __get_free_page(GFP_KERNEL)))
+		return -ENOMEM;
+	current->timeout = ~0UL;
+	if (timeout >= 0) {
+		current->timeout = (timeout / 1000) * HZ
+			+ ((timeout % 1000) * HZ + 999) / 1000;
+		if (current->timeout)
+			current->timeout += jiffies + 1;
+	}
+	add_wait_queue(&ep->wait, &wait);
+	for (;;) {
+		current->state = TASK_INTERRUPTIBLE;
+		count = ep_collect(ep, buf, maxevents);
+		if (count || !current->timeout || (current->signal & ~current->blocked))
+			break;
+		schedule();
+	}
+	current->state = TASK_RUNNING;
+	remove_wait_queue(&ep->wait, &wait);
+	current->timeout = 0;
+	if (count)
+		memcpy_tofs(events, buf, count * sizeof(struct epoll_event));
+	free_page((unsigned long) buf);
+	if (!count && (current->signal & ~current->blocked))
+		return -EINTR;
+	return count;
+}
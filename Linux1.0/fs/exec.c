@@ -81,6 +81,9 @@ int open_inode(struct inode * inode, int mode)
 	f->f_inode = inode;
 	f->f_pos = 0;
 	f->f_reada = 0;
+	f->f_rawin = 0;
+	f->f_ralast = 0;
+	f->f_raend = 0;
 	f->f_op = inode->i_op->default_file_ops;
 	if (f->f_op->open) {
 		error = f->f_op->open(inode,f);
@@ -156,6 +159,9 @@ int core_dump(long signr, struct pt_regs * regs)
 	file.f_inode = inode;
 	file.f_pos = 0;
 	file.f_reada = 0;
+	file.f_rawin = 0;
+	file.f_ralast = 0;
+	file.f_raend = 0;
 	file.f_op = inode->i_op->default_file_ops;
 	if (file.f_op->open)
 		if (file.f_op->open(inode,&file))
@@ -441,6 +447,9 @@ int read_exec(struct inode *inode, unsigned long offset,
 	file.f_inode = inode;
 	file.f_pos = 0;
 	file.f_reada = 0;
+	file.f_rawin = 0;
+	file.f_ralast = 0;
+	file.f_raend = 0;
 	file.f_op = inode->i_op->default_file_ops;
 	if (file.f_op->open)
 		if (file.f_op->open(inode,&file))
@@ -515,13 +524,8 @@ void flush_old_exec(struct linux_binprm * bprm)
 	if (current->ldt) {
 		free_page((unsigned long) current->ldt);
 		current->ldt = NULL;
-		for (i=1 ; i<NR_TASKS ; i++) {
-			if (task[i] == current)  {
-				set_ldt_desc(gdt+(i<<1)+
-					     FIRST_LDT_ENTRY,&default_ldt, 1);
-				load_ldt(i);
-			}
-		}	
+		set_task_ldt(current);
+		load_ldt(0);
 	}
 
 	for (i=0 ; i<8 ; i++) current->debugreg[i] = 0;
@@ -544,6 +548,7 @@ void flush_old_exec(struct linux_binprm * bprm)
 	FD_ZERO(&current->close_on_exec);
         /* û̬ҳ */
 	clear_page_tables(current);
+	vfork_release(current);
 	if (last_task_used_math == current)
 		last_task_used_math = NULL;
 	current->used_math = 0;
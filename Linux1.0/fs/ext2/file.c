@@ -24,8 +24,7 @@
 #include <linux/sched.h>
 #include <linux/stat.h>
 #include <linux/locks.h>
-
-#define	NBUF	32
+#include <linux/pagemap.h>
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
@@ -78,163 +77,16 @@ struct inode_operations ext2_file_inode_operations = {
 static int ext2_file_read (struct inode * inode, struct file * filp,
 		    char * buf, int count)
 {
-	int read, left, chars;
-	int block, blocks, offset;
-	int bhrequest, uptodate;
-	struct buffer_head ** bhb, ** bhe;
-	/* δ32 */
-	struct buffer_head * bhreq[NBUF];
-	struct buffer_head * buflist[NBUF];
-	struct super_block * sb;
-	unsigned int size;
-	int err;
-
 	if (!inode) {
 		printk ("ext2_file_read: inode = NULL\n");
 		return -EINVAL;
 	}
-	sb = inode->i_sb;
 	if (!S_ISREG(inode->i_mode)) {
-		ext2_warning (sb, "ext2_file_read", "mode = %07o",
+		ext2_warning (inode->i_sb, "ext2_file_read", "mode = %07o",
 			      inode->i_mode);
 		return -EINVAL;
 	}
-	/* ȡƫļС */
-	offset = filp->f_pos;
-	size = inode->i_size;
-	if (offset > size)
-		left = 0;
-	else
-		left = size - offset;
-	if (left > count)
-		left = count;
-	if (left <= 0)
-		return 0;
-	read = 0;
-	/* ȡǰƫڵĿźڿеƫ */
-	block = offset >> EXT2_BLOCK_SIZE_BITS(sb);
-	offset &= (sb->s_blocksize - 1);
-	/* sizeʾļܹռ˶ٿ */
-	size = (size + sb->s_blocksize - 1) >> EXT2_BLOCK_SIZE_BITS(sb);
-	/* Ҫȡ */
-	blocks = (left + offset + sb->s_blocksize - 1) >> EXT2_BLOCK_SIZE_BITS(sb);
-	bhb = bhe = buflist;
-	if (filp->f_reada) {
-		blocks += read_ahead[MAJOR(inode->i_dev)] >>
-			(EXT2_BLOCK_SIZE_BITS(sb) - 9);
-		if (block + blocks > size)
-			blocks = size - block;
-	}
-
-	/*
-	 * We do this in a two stage process.  We first try and request
-	 * as many blocks as we can, then we wait for the first one to
-	 * complete, and then we try and wrap up as many as are actually
-	 * done.  This routine is rather generic, in that it can be used
-	 * in a filesystem by substituting the appropriate function in
-	 * for getblk
-	 *
-	 * This routine is optimized to make maximum use of the various
-	 * buffers and caches.
-	 */
-	/* һѭֻܶȡ32ݿ
-	 */
-	do {
-		bhrequest = 0;
-		uptodate = 1;
-		/* blocksʾܹҪȡĿblockʾʼȡĿ */
-		while (blocks) {
-			--blocks;
-			/* ȡĸ߶Ȼַbuflist鵱 */
-			*bhb = ext2_getblk (inode, block++, 0, &err);
-			if (*bhb && !(*bhb)->b_uptodate) {
-				uptodate = 0;
-				/* ȡĸٻָbhreqУʱbhreqԪʵbuflistͬ */
-				bhreq[bhrequest++] = *bhb;
-			}
-
-			/* ǰȡһٻ棬bhbֻص׵ַ */
-			if (++bhb == &buflist[NBUF])
-				bhb = buflist;
-
-			/*
-			 * If the block we have on hand is uptodate, go ahead
-			 * and complete processing
-			 */
-			if (uptodate)
-				break;
-
-			/* ʾѾȡ8ٻ棬һ־Ҫֹͣ */
-			if (bhb == bhe)
-				break;
-		}
-
-		/*
-		 * Now request them all
-		 */
-		/* ߼ݶȡӦĸٻ浱 
-		 */
-		if (bhrequest)
-			ll_rw_block (READ, bhrequest, bhreq);
-
-		do {
-			/*
-			 * Finish off all I/O that has actually completed
-			 */
-			if (*bhe) {
-				wait_on_buffer (*bhe);
-				/* ȡݲµģ򷵻س */
-				if (!(*bhe)->b_uptodate) { /* read error? */
-				        brelse(*bhe);
-					if (++bhe == &buflist[NBUF])
-					  bhe = buflist;
-					left = 0;
-					break;
-				}
-			}
-			/* ȡζȡֽchars */
-			if (left < sb->s_blocksize - offset)
-				chars = left;
-			else
-				chars = sb->s_blocksize - offset;
-			/* ޸ļָˡʣ¶ȡֽѶȡֽ */
-			filp->f_pos += chars;
-			left -= chars;
-			read += chars;
-			/* ݴӸٻ浱пbuf */
-			if (*bhe) {
-				memcpy_tofs (buf, offset + (*bhe)->b_data,
-					     chars);
-				brelse (*bhe);
-				buf += chars;
-			} else {
-				while (chars-- > 0)
-					put_fs_byte (0, buf++);
-			}
-			offset = 0;
-			/* bhebuflistһԪأֻصײ */
-			if (++bhe == &buflist[NBUF])
-				bhe = buflist;
-		} while (left > 0 && bhe != bhb && (!*bhe || !(*bhe)->b_lock));
-	} while (left > 0);   /* û꣬ */
-
-	/*
-	 * Release the read-ahead blocks
-	 */
-	while (bhe != bhb) {
-		brelse (*bhe);
-		if (++bhe == &buflist[NBUF])
-			bhe = buflist;
-	}
-	if (!read)
-		return -EIO;
-	filp->f_reada = 1;
-	if (!IS_RDONLY(inode)) {
-		inode->i_atime = CURRENT_TIME;
-		inode->i_dirt = 1;
-	}
-	/* ʵʶȡֽ */
-	return read;
+	return generic_file_read (inode, filp, buf, count);
 }
 
 static int ext2_file_write (struct inode * inode, struct file * filp,
@@ -311,6 +163,7 @@ static int ext2_file_write (struct inode * inode, struct file * filp,
 		/* дֽͬʱݿٻ */
 		written += c;
 		memcpy_fromfs (p, buf, c);
+		update_page_cache (inode, pos - c, p, c);
 		buf += c;
 		/* ΪдһҪøٻΪµģԱͬʱ
 		 * Ѹղдд뵽ļ 
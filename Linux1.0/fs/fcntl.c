@@ -104,6 +104,8 @@ asmlinkage int sys_fcntl(unsigned int fd, unsigned int cmd, unsigned long arg)
 		case F_SETLKW:
 			return fcntl_setlk(fd, cmd, (struct flock *) arg);
 		default:
+			if (filp->f_inode->i_pipe)
+				return pipe_fcntl(filp->f_inode, cmd, arg);
 			/* sockets need a few special fcntls. */
 			if (S_ISSOCK (filp->f_inode->i_mode))
 			  {
@@ -12,7 +12,6 @@
 static int fifo_open(struct inode * inode,struct file * filp)
 {
 	int retval = 0;
-	unsigned long page;
 
 	switch( filp->f_mode ) {
 
@@ -97,19 +96,9 @@ static int fifo_open(struct inode * inode,struct file * filp)
 	default:
 		retval = -EINVAL;
 	}
-	if (retval || PIPE_BASE(*inode))
+	if (retval || PIPE_BUFS(*inode))
 		return retval;
-	page = __get_free_page(GFP_KERNEL);
-	if (PIPE_BASE(*inode)) {
-		free_page(page);
-		return 0;
-	}
-	if (!page)
-		return -ENOMEM;
-	PIPE_LOCK(*inode) = 0;
-	PIPE_START(*inode) = PIPE_LEN(*inode) = 0;
-	PIPE_BASE(*inode) = (char *) page;
-	return 0;
+	return pipe_alloc(inode);
 }
 
 /*
@@ -154,8 +143,9 @@ void init_fifo(struct inode * inode)
 	inode->i_op = &fifo_inode_operations;
 	inode->i_pipe = 1;
 	PIPE_LOCK(*inode) = 0;
-	PIPE_BASE(*inode) = NULL;
-	PIPE_START(*inode) = PIPE_LEN(*inode) = 0;
+	PIPE_BUFS(*inode) = NULL;
+	PIPE_TMP_PAGE(*inode) = 0;
+	PIPE_LEN(*inode) = 0;
 	PIPE_RD_OPENERS(*inode) = PIPE_WR_OPENERS(*inode) = 0;
 	PIPE_WAIT(*inode) = NULL;
 	PIPE_READERS(*inode) = PIPE_WRITERS(*inode) = 0;
@@ -53,19 +53,19 @@ struct file_system_type file_systems[] = {
 	{xiafs_read_super,	"xiafs",	1},
 #endif
 #ifdef CONFIG_MSDOS_FS
-	{msdos_read_super,	"msdos",	1},
+	{msdos_read_super,	"msdos",	1, FS_DCACHE_NEG},
 #endif
 #ifdef CONFIG_PROC_FS
 	/* procļϵͳȡ */
-	{proc_read_super,	"proc",		0},
+	{proc_read_super,	"proc",		0, FS_NO_DCACHE},
 #endif
 #ifdef CONFIG_NFS_FS
         /* ļϵͳ */
-	{nfs_read_super,	"nfs",		0},
+	{nfs_read_super,	"nfs",		0, FS_NO_DCACHE},
 #endif
 #ifdef CONFIG_ISO9660_FS
         /* ISOļϵͳLinuxһISOļ */
-	{isofs_read_super,	"iso9660",	1},
+	{isofs_read_super,	"iso9660",	1, FS_DCACHE_NEG},
 #endif
 #ifdef CONFIG_SYSV_FS
 	{sysv_read_super,	"xenix",	1},
@@ -73,7 +73,7 @@ struct file_system_type file_systems[] = {
 	{sysv_read_super,	"coherent",	1},
 #endif
 #ifdef CONFIG_HPFS_FS
-	{hpfs_read_super,	"hpfs",		1},
+	{hpfs_read_super,	"hpfs",		1, FS_DCACHE_NEG},
 #endif
 	{NULL,			NULL,		0}
 };
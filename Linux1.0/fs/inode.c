@@ -8,6 +8,7 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/pagemap.h>
 #include <linux/string.h>
 
 #include <asm/system.h>
@@ -188,6 +189,7 @@ void clear_inode(struct inode * inode)
 	struct wait_queue * wait;
 
 	wait_on_inode(inode);
+	truncate_page_cache(inode, 0);
 	remove_inode_hash(inode);
 	remove_inode_free(inode);
 	wait = ((volatile struct inode *) inode)->i_wait;
@@ -385,11 +387,8 @@ repeat:
 	/* ѵȴʹinode
 	 */
 	wake_up(&inode_wait);
-	if (inode->i_pipe) {
-		unsigned long page = (unsigned long) PIPE_BASE(*inode);
-		PIPE_BASE(*inode) = NULL;
-		free_page(page);
-	}
+	if (inode->i_pipe)
+		pipe_free(inode);
 	if (inode->i_sb && inode->i_sb->s_op && inode->i_sb->s_op->put_inode) {
 		inode->i_sb->s_op->put_inode(inode);
 		if (!inode->i_nlink)
@@ -460,6 +459,7 @@ repeat:
 	inode->i_count = 1;
 	inode->i_nlink = 1;
 	inode->i_sem.count = 1;
+	inode->i_version = ++event;
 	nr_free_inodes--;
 	if (nr_free_inodes < 0) {
 		printk ("VFS: get_empty_inode: bad free inode count.\n");
@@ -477,8 +477,8 @@ struct inode * get_pipe_inode(void)
 
 	if (!(inode = get_empty_inode()))
 		return NULL;
-	/* ܵһҳݣԿܵʺϴݴ*/
-	if (!(PIPE_BASE(*inode) = (char*) __get_free_page(GFP_USER))) {
+	/* ܵ仺ҳдʱŷ */
+	if (pipe_alloc(inode)) {
 		iput(inode);
 		return NULL;
 	}
@@ -486,7 +486,6 @@ struct inode * get_pipe_inode(void)
 	/*ܵһͷһͷд*/
 	inode->i_count = 2;	/* sum of readers/writers */
 	PIPE_WAIT(*inode) = NULL;
-	PIPE_START(*inode) = PIPE_LEN(*inode) = 0;
 	PIPE_RD_OPENERS(*inode) = PIPE_WR_OPENERS(*inode) = 0;
         /* öдΪ1 */
 	PIPE_READERS(*inode) = PIPE_WRITERS(*inode) = 1;
@@ -15,6 +15,7 @@
 #include <linux/errno.h>
 #include <linux/fcntl.h>
 #include <linux/stat.h>
+#include <linux/pagemap.h>
 
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -96,6 +97,8 @@ static int msdos_file_read(struct inode *inode,struct file *filp,char *buf,
 		return -EINVAL;
 	}
 	if (filp->f_pos >= inode->i_size || count <= 0) return 0;
+	if (MSDOS_I(inode)->i_binary && inode->i_op->bmap)
+		return generic_file_read(inode,filp,buf,count);
 	start = buf;
 	while ((left = MIN(inode->i_size-filp->f_pos,count-(buf-start))) > 0){
 		if (!(sector = msdos_smap(inode,filp->f_pos >> SECTOR_BITS)))
@@ -172,6 +175,8 @@ static int msdos_file_write(struct inode *inode,struct file *filp,char *buf,
 		if (MSDOS_I(inode)->i_binary) {
 			memcpy_fromfs(data+(filp->f_pos & (SECTOR_SIZE-1)),
 			    buf,written = size);
+			update_page_cache(inode,filp->f_pos,
+			    data+(filp->f_pos & (SECTOR_SIZE-1)),size);
 			buf += size;
 		}
 		else {
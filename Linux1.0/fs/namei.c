@@ -16,6 +16,7 @@
 #include <linux/string.h>
 #include <linux/fcntl.h>
 #include <linux/stat.h>
+#include <linux/pagemap.h>
 
 #define ACC_MODE(x) ("\000\004\002\006"[(x)&O_ACCMODE])
 
@@ -105,7 +106,8 @@ int lookup(struct inode * dir,const char * name, int len,
 	struct inode ** result)
 {
 	struct super_block * sb;
-	int perm;
+	unsigned long ino, version;
+	int perm, flags, error;
 
 	*result = NULL;
 	if (!dir)
@@ -139,7 +141,30 @@ int lookup(struct inode * dir,const char * name, int len,
 		*result = dir;
 		return 0;
 	}
-	return dir->i_op->lookup(dir,name,len,result);
+	/* "."".."ֻ棬renameĿ¼ʱ".." */
+	flags = dir->i_sb && dir->i_sb->s_type ? dir->i_sb->s_type->fs_flags : FS_NO_DCACHE;
+	if ((flags & FS_NO_DCACHE) || (name[0] == '.' && (len == 1 ||
+	    (len == 2 && name[1] == '.'))))
+		return dir->i_op->lookup(dir,name,len,result);
+	if (dcache_lookup(dir,name,len,&ino)) {
+		if (!ino) {
+			iput(dir);
+			return -ENOENT;
+		}
+		if ((*result = iget(dir->i_sb,ino)) != NULL) {
+			iput(dir);
+			return 0;
+		}
+	}
+	version = dir->i_version;
+	dir->i_count++;		/* lookup eats the dir */
+	error = dir->i_op->lookup(dir,name,len,result);
+	if (error == -ENOENT)
+		dcache_add(dir,name,len,0,version);
+	else if (!error && !(flags & FS_DCACHE_NEG) && (*result)->i_sb == dir->i_sb)
+		dcache_add(dir,name,len,(*result)->i_ino,version);
+	iput(dir);
+	return error;
 }
 
 int follow_link(struct inode * dir, struct inode * inode,
@@ -367,6 +392,7 @@ int open_namei(const char * pathname, int flag, int mode,
 		else {
 			dir->i_count++;		/* create eats the dir */
 			error = dir->i_op->create(dir,basename,namelen,mode,res_inode);
+			dcache_changed(dir);
 			up(&dir->i_sem);
 			iput(dir);
 			return error;
@@ -421,6 +447,7 @@ int open_namei(const char * pathname, int flag, int mode,
  	}
 	if (flag & O_TRUNC) {
 	      inode->i_size = 0;
+	      truncate_page_cache(inode, 0);
 	      if (inode->i_op && inode->i_op->truncate)
 	           inode->i_op->truncate(inode);
 	      if ((error = notify_change(NOTIFY_SIZE, inode))) {
@@ -462,9 +489,12 @@ int do_mknod(const char * filename, int mode, dev_t dev)
 	}
 	/* ռøĿ¼ */
 	down(&dir->i_sem);
+	dir->i_count++;		/* mknod eats the dir */
 	error = dir->i_op->mknod(dir,basename,namelen,mode,dev);
+	dcache_changed(dir);
 	/* ֮ͷŸĿ¼ */
 	up(&dir->i_sem);
+	iput(dir);
 	return error;
 }
 
@@ -518,8 +548,11 @@ static int do_mkdir(const char * pathname, int mode)
 		return -EPERM;
 	}
 	down(&dir->i_sem);
+	dir->i_count++;		/* mkdir eats the dir */
 	error = dir->i_op->mkdir(dir,basename,namelen,mode);
+	dcache_changed(dir);
 	up(&dir->i_sem);
+	iput(dir);
 	return error;
 }
 
@@ -561,7 +594,11 @@ static int do_rmdir(const char * name)
 		iput(dir);
 		return -EPERM;
 	}
-	return dir->i_op->rmdir(dir,basename,namelen);
+	dir->i_count++;		/* rmdir eats the dir */
+	error = dir->i_op->rmdir(dir,basename,namelen);
+	dcache_changed(dir);
+	iput(dir);
+	return error;
 }
 
 asmlinkage int sys_rmdir(const char * pathname)
@@ -602,7 +639,11 @@ static int do_unlink(const char * name)
 		iput(dir);
 		return -EPERM;
 	}
-	return dir->i_op->unlink(dir,basename,namelen);
+	dir->i_count++;		/* unlink eats the dir */
+	error = dir->i_op->unlink(dir,basename,namelen);
+	dcache_changed(dir);
+	iput(dir);
+	return error;
 }
 
 asmlinkage int sys_unlink(const char * pathname)
@@ -644,8 +685,11 @@ static int do_symlink(const char * oldname, const char * newname)
 		return -EPERM;
 	}
 	down(&dir->i_sem);
+	dir->i_count++;		/* symlink eats the dir */
 	error = dir->i_op->symlink(dir,basename,namelen,oldname);
+	dcache_changed(dir);
 	up(&dir->i_sem);
+	iput(dir);
 	return error;
 }
 
@@ -705,8 +749,11 @@ static int do_link(struct inode * oldinode, const char * newname)
 		return -EPERM;
 	}
 	down(&dir->i_sem);
+	dir->i_count++;		/* link eats the dir */
 	error = dir->i_op->link(oldinode, dir, basename, namelen);
+	dcache_changed(dir);
 	up(&dir->i_sem);
+	iput(dir);
 	return error;
 }
 
@@ -783,9 +830,15 @@ static int do_rename(const char * oldname, const char * newname)
 		return -EPERM;
 	}
 	down(&new_dir->i_sem);
+	old_dir->i_count++;	/* rename eats both dirs */
+	new_dir->i_count++;
 	error = old_dir->i_op->rename(old_dir, old_base, old_len, 
 		new_dir, new_base, new_len);
+	dcache_changed(old_dir);
+	dcache_changed(new_dir);
 	up(&new_dir->i_sem);
+	iput(old_dir);
+	iput(new_dir);
 	return error;
 }
 
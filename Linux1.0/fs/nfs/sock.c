@@ -88,7 +88,11 @@ static int do_nfs_rpc_call(struct nfs_server *server, int *start, int *end)
 		}
 	re_select:
 		wait_table.nr = 0;
+		wait_table.max = 1;
 		wait_table.entry = &entry;
+		wait_table.more = NULL;
+		wait_table.func = NULL;
+		wait_table.data = NULL;
 		current->state = TASK_INTERRUPTIBLE;
 		if (!select(inode, file, SEL_IN, &wait_table)
 		    && !select(inode, file, SEL_IN, NULL)) {
@@ -96,7 +100,7 @@ static int do_nfs_rpc_call(struct nfs_server *server, int *start, int *end)
 				timeout = max_timeout;
 			current->timeout = jiffies + timeout;
 			schedule();
-			remove_wait_queue(entry.wait_address, &entry.wait);
+			free_wait(&wait_table);
 			current->state = TASK_RUNNING;
 			if (current->signal & ~current->blocked) {
 				current->timeout = 0;
@@ -125,8 +129,8 @@ static int do_nfs_rpc_call(struct nfs_server *server, int *start, int *end)
 			else
 				current->timeout = 0;
 		}
-		else if (wait_table.nr)
-			remove_wait_queue(entry.wait_address, &entry.wait);
+		else
+			free_wait(&wait_table);
 		current->state = TASK_RUNNING;
 		addrlen = 0;
 		result = sock->ops->recvfrom(sock, (void *) start, PAGE_SIZE, 1, 0,
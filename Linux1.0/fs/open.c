@@ -16,6 +16,8 @@
 #include <linux/signal.h>
 #include <linux/tty.h>
 #include <linux/time.h>
+#include <linux/pagemap.h>
+#include <linux/eventpoll.h>
 
 #include <asm/segment.h>
 
@@ -82,6 +84,7 @@ asmlinkage int sys_truncate(const char * path, unsigned int length)
 		return -EROFS;
 	}
 	inode->i_size = length;
+	truncate_page_cache(inode, length);
 	if (inode->i_op && inode->i_op->truncate)
 		inode->i_op->truncate(inode);
 	inode->i_ctime = inode->i_mtime = CURRENT_TIME;
@@ -103,6 +106,7 @@ asmlinkage int sys_ftruncate(unsigned int fd, unsigned int length)
 	if (S_ISDIR(inode->i_mode) || !(file->f_mode & 2))
 		return -EACCES;
 	inode->i_size = length;
+	truncate_page_cache(inode, length);
 	if (inode->i_op && inode->i_op->truncate)
 		inode->i_op->truncate(inode);
 	inode->i_ctime = inode->i_mtime = CURRENT_TIME;
@@ -432,6 +436,9 @@ int do_open(const char * filename,int flags,int mode)
 	f->f_inode = inode;
 	f->f_pos = 0;
 	f->f_reada = 0;
+	f->f_rawin = 0;
+	f->f_ralast = 0;
+	f->f_raend = 0;
 	f->f_op = NULL;
         /* inodefilef_opָ */
 	if (inode->i_op)
@@ -490,6 +497,9 @@ int close_fp(struct file *filp, unsigned int fd)
 		filp->f_count--;
 		return 0;
 	}
+	/* һιرʱмepollɾ */
+	if (filp->f_ep)
+		eventpoll_release(filp);
 	if (filp->f_op && filp->f_op->release)
 		filp->f_op->release(inode,filp);
 	/* struct fileеf_countf_inodeָ룬
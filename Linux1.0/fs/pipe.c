@@ -12,6 +12,10 @@
 #include <linux/signal.h>
 #include <linux/fcntl.h>
 #include <linux/termios.h>
+#include <linux/stat.h>
+#include <linux/mm.h>
+#include <linux/malloc.h>
+#include <linux/pagemap.h>
 
 
 /* We don't use the head/tail construction any more. Now we use the start/len*/
@@ -20,11 +24,56 @@
 /* Additionally, we now use locking technique. This prevents race condition  */
 /* in case of paging and multiple read/write on the same pipe. (FGC)         */
 
+/*
+ * Pipes are a ring of up to PIPE_BUFFERS(inode) pages (see
+ * <linux/pipe_fs_i.h>), so a writer can get well ahead of the reader
+ * before either of them has to sleep. Pages are only allocated while
+ * they hold data; one emptied page is kept back for the next write.
+ */
+static unsigned long pipe_get_page(struct inode * inode)
+{
+	unsigned long page;
+
+	if ((page = PIPE_TMP_PAGE(*inode)) != 0) {
+		PIPE_TMP_PAGE(*inode) = 0;
+		return page;
+	}
+	return __get_free_page(GFP_KERNEL);
+}
+
+/* ڻĩβһ */
+static void pipe_push(struct inode * inode, unsigned long page,
+	unsigned int offset, unsigned int len, unsigned int flags)
+{
+	struct pipe_buffer * pb;
+
+	pb = PIPE_BUFS(*inode) + ((PIPE_CURBUF(*inode)+PIPE_NRBUFS(*inode)) & (PIPE_BUFFERS(*inode)-1));
+	pb->page = page;
+	pb->offset = offset;
+	pb->len = len;
+	pb->flags = flags;
+	PIPE_NRBUFS(*inode)++;
+	PIPE_LEN(*inode) += len;
+}
+
+/* һѾգͷ */
+static void pipe_pop(struct inode * inode)
+{
+	struct pipe_buffer * pb = &PIPE_FIRST(*inode);
+
+	if (!(pb->flags & PIPE_BUF_SHARED) && !PIPE_TMP_PAGE(*inode))
+		PIPE_TMP_PAGE(*inode) = pb->page;
+	else
+		free_page(pb->page);
+	PIPE_CURBUF(*inode) = (PIPE_CURBUF(*inode)+1) & (PIPE_BUFFERS(*inode)-1);
+	PIPE_NRBUFS(*inode)--;
+}
+
 /* ӹܵ0ͨжȡ */
 static int pipe_read(struct inode * inode, struct file * filp, char * buf, int count)
 {
-	int chars = 0, size = 0, read = 0;
-        char *pipebuf;
+	int chars = 0, read = 0;
+	struct pipe_buffer * pb;
 
 	/* Ƿ */
 	if (filp->f_flags & O_NONBLOCK) {
@@ -47,19 +96,19 @@ static int pipe_read(struct inode * inode, struct file * filp, char * buf, int c
 	}
 	/* סܵ */
 	PIPE_LOCK(*inode)++;
-	while (count>0 && (size = PIPE_SIZE(*inode))) {
-		chars = PIPE_MAX_RCHUNK(*inode);
+	while (count>0 && PIPE_SIZE(*inode)) {
+		pb = &PIPE_FIRST(*inode);
+		chars = pb->len;
 		if (chars > count)
 			chars = count;
-		if (chars > size)
-			chars = size;
-		read += chars;
-                pipebuf = PIPE_BASE(*inode)+PIPE_START(*inode);
-		PIPE_START(*inode) += chars;
-		PIPE_START(*inode) &= (PIPE_BUF-1);
+		memcpy_tofs(buf, (char *) pb->page + pb->offset, chars);
+		pb->offset += chars;
+		pb->len -= chars;
 		PIPE_LEN(*inode) -= chars;
+		if (!pb->len)
+			pipe_pop(inode);
+		read += chars;
 		count -= chars;
-		memcpy_tofs(buf, pipebuf, chars );
 		buf += chars;
 	}
 	/*  */
@@ -76,7 +125,8 @@ static int pipe_read(struct inode * inode, struct file * filp, char * buf, int c
 static int pipe_write(struct inode * inode, struct file * filp, char * buf, int count)
 {
 	int chars = 0, free = 0, written = 0;
-	char *pipebuf;
+	struct pipe_buffer * pb;
+	unsigned long page;
 
 	if (!PIPE_READERS(*inode)) { /* no readers */
 		send_sig(SIGPIPE,current,0);
@@ -100,17 +150,25 @@ static int pipe_write(struct inode * inode, struct file * filp, char * buf, int
 			interruptible_sleep_on(&PIPE_WAIT(*inode));
 		}
 		PIPE_LOCK(*inode)++;
-		while (count>0 && (free = PIPE_FREE(*inode))) {
-			chars = PIPE_MAX_WCHUNK(*inode);
+		while (count>0 && PIPE_FREE(*inode)) {
+			/* һҳдˣһµĻ */
+			if (!(chars = PIPE_ROOM(*inode))) {
+				if (!(page = pipe_get_page(inode))) {
+					PIPE_LOCK(*inode)--;
+					wake_up_interruptible(&PIPE_WAIT(*inode));
+					return written? :-ENOMEM;
+				}
+				pipe_push(inode, page, 0, 0, 0);
+				chars = PAGE_SIZE;
+			}
 			if (chars > count)
 				chars = count;
-			if (chars > free)
-				chars = free;
-                        pipebuf = PIPE_BASE(*inode)+PIPE_END(*inode);
-			written += chars;
+			pb = &PIPE_LAST(*inode);
+			memcpy_fromfs((char *) pb->page + pb->offset + pb->len, buf, chars);
+			pb->len += chars;
 			PIPE_LEN(*inode) += chars;
+			written += chars;
 			count -= chars;
-			memcpy_fromfs(pipebuf, buf, chars );
 			buf += chars;
 		}
 		PIPE_LOCK(*inode)--;
@@ -443,3 +501,255 @@ asmlinkage int sys_pipe(unsigned long * fildes)
 	put_fs_long(fd[1],1+fildes);
 	return 0;
 }
+
+/* ܵ仺fifo_openܺͱͬʱ */
+int pipe_alloc(struct inode * inode)
+{
+	struct pipe_buffer * bufs;
+
+	bufs = (struct pipe_buffer *) kmalloc(PIPE_DEF_BUFFERS * sizeof(struct pipe_buffer), GFP_KERNEL);
+	if (!bufs)
+		return -ENOMEM;
+	if (PIPE_BUFS(*inode)) {
+		kfree_s(bufs, PIPE_DEF_BUFFERS * sizeof(struct pipe_buffer));
+		return 0;
+	}
+	PIPE_BUFS(*inode) = bufs;
+	PIPE_BUFFERS(*inode) = PIPE_DEF_BUFFERS;
+	PIPE_CURBUF(*inode) = PIPE_NRBUFS(*inode) = 0;
+	PIPE_TMP_PAGE(*inode) = 0;
+	PIPE_LOCK(*inode) = 0;
+	PIPE_LEN(*inode) = 0;
+	return 0;
+}
+
+/* ͷŹܵеҳͻ */
+void pipe_free(struct inode * inode)
+{
+	if (!PIPE_BUFS(*inode))
+		return;
+	while (PIPE_NRBUFS(*inode))
+		pipe_pop(inode);
+	if (PIPE_TMP_PAGE(*inode))
+		free_page(PIPE_TMP_PAGE(*inode));
+	kfree_s(PIPE_BUFS(*inode), PIPE_BUFFERS(*inode) * sizeof(struct pipe_buffer));
+	PIPE_BUFS(*inode) = NULL;
+	PIPE_TMP_PAGE(*inode) = 0;
+	PIPE_LEN(*inode) = 0;
+}
+
+/*
+ * F_SETPIPE_SZ: change the number of pages in the ring. The size is
+ * rounded up to a power of two pages, and can't drop below what the
+ * pipe holds right now.
+ */
+static int pipe_resize(struct inode * inode, unsigned long size)
+{
+	struct pipe_buffer * bufs;
+	unsigned int nr, i;
+
+	if (size > PIPE_MAX_BUFFERS * PAGE_SIZE)
+		return -EINVAL;
+	for (nr = 1 ; nr * PAGE_SIZE < size ; nr <<= 1)
+		/* nothing */;
+	bufs = (struct pipe_buffer *) kmalloc(nr * sizeof(struct pipe_buffer), GFP_KERNEL);
+	if (!bufs)
+		return -ENOMEM;
+	/* a sleeping reader or writer may be holding a pointer into the ring */
+	if (PIPE_LOCK(*inode) || PIPE_NRBUFS(*inode) > nr) {
+		kfree_s(bufs, nr * sizeof(struct pipe_buffer));
+		return -EBUSY;
+	}
+	for (i = 0 ; i < PIPE_NRBUFS(*inode) ; i++)
+		bufs[i] = PIPE_BUFS(*inode)[(PIPE_CURBUF(*inode)+i) & (PIPE_BUFFERS(*inode)-1)];
+	kfree_s(PIPE_BUFS(*inode), PIPE_BUFFERS(*inode) * sizeof(struct pipe_buffer));
+	PIPE_BUFS(*inode) = bufs;
+	PIPE_BUFFERS(*inode) = nr;
+	PIPE_CURBUF(*inode) = 0;
+	wake_up_interruptible(&PIPE_WAIT(*inode));
+	return nr * PAGE_SIZE;
+}
+
+int pipe_fcntl(struct inode * inode, unsigned int cmd, unsigned long arg)
+{
+	switch (cmd) {
+		case F_GETPIPE_SZ:
+			return PIPE_BUFFERS(*inode) * PAGE_SIZE;
+		case F_SETPIPE_SZ:
+			return pipe_resize(inode, arg);
+	}
+	return -EINVAL;
+}
+
+/*
+ * Get the next piece of the input file for splice() into a pipe. Files
+ * that are read through the page cache lend the cached page itself to
+ * the pipe. Anything else (sockets, ttys, other pipes) is read straight
+ * into a page of the pipe's own, so the data still never passes through
+ * user space.
+ */
+static int splice_page_in(struct file * in, unsigned int len,
+	unsigned long * page, unsigned int * offset, unsigned int * flags)
+{
+	struct inode * inode = in->f_inode;
+	unsigned long pos = in->f_pos;
+	unsigned short fs;
+	int error, n;
+
+	if (S_ISREG(inode->i_mode) && inode->i_op && inode->i_op->bmap) {
+		if (pos >= inode->i_size)
+			return 0;
+		*offset = pos & ~PAGE_MASK;
+		n = PAGE_SIZE - *offset;
+		if (n > len)
+			n = len;
+		if (n > inode->i_size - pos)
+			n = inode->i_size - pos;
+		error = page_cache_read(inode, pos & PAGE_MASK, page);
+		if (error < 0) {
+			if (*page)
+				free_page(*page);
+			return error;
+		}
+		*flags = PIPE_BUF_SHARED;
+		in->f_pos = pos + n;
+		return n;
+	}
+	if (!in->f_op || !in->f_op->read)
+		return -EINVAL;
+	if (!(*page = __get_free_page(GFP_KERNEL)))
+		return -ENOMEM;
+	n = PAGE_SIZE;
+	if (n > len)
+		n = len;
+	fs = get_fs();
+	set_fs(get_ds());
+	n = in->f_op->read(inode, in, (char *) *page, n);
+	set_fs(fs);
+	if (n <= 0)
+		free_page(*page);
+	*offset = 0;
+	*flags = 0;
+	return n;
+}
+
+static int splice_to_pipe(struct file * in, struct inode * inode,
+	unsigned int len, int nonblock)
+{
+	unsigned long page;
+	unsigned int offset, flags;
+	int n, total = 0;
+
+	while (len > 0) {
+		while (PIPE_NRBUFS(*inode) == PIPE_BUFFERS(*inode) || PIPE_LOCK(*inode)) {
+			if (!PIPE_READERS(*inode)) {
+				send_sig(SIGPIPE,current,0);
+				return total? :-EPIPE;
+			}
+			if (total)
+				return total;
+			if (current->signal & ~current->blocked)
+				return -ERESTARTSYS;
+			if (nonblock)
+				return -EAGAIN;
+			interruptible_sleep_on(&PIPE_WAIT(*inode));
+		}
+		PIPE_LOCK(*inode)++;
+		n = splice_page_in(in, len, &page, &offset, &flags);
+		if (n > 0)
+			pipe_push(inode, page, offset, n, flags);
+		PIPE_LOCK(*inode)--;
+		wake_up_interruptible(&PIPE_WAIT(*inode));
+		if (n <= 0)
+			return total? :n;
+		total += n;
+		len -= n;
+	}
+	return total;
+}
+
+/*
+ * Hand the pipe's pages to the output file's write(). There is no page
+ * based write path in the filesystems or the network code, so this is
+ * the one copy left: from the pipe page into the buffer cache or the
+ * socket, without going through user space.
+ */
+static int splice_from_pipe(struct inode * inode, struct file * out,
+	unsigned int len, int nonblock)
+{
+	struct pipe_buffer * pb;
+	unsigned short fs;
+	int n, written, total = 0, error = 0;
+
+	if (!out->f_op || !out->f_op->write)
+		return -EINVAL;
+	while (PIPE_EMPTY(*inode) || PIPE_LOCK(*inode)) {
+		if (PIPE_EMPTY(*inode) && !PIPE_WRITERS(*inode))
+			return 0;
+		if (current->signal & ~current->blocked)
+			return -ERESTARTSYS;
+		if (nonblock)
+			return -EAGAIN;
+		interruptible_sleep_on(&PIPE_WAIT(*inode));
+	}
+	PIPE_LOCK(*inode)++;
+	while (len > 0 && PIPE_SIZE(*inode)) {
+		pb = &PIPE_FIRST(*inode);
+		n = pb->len;
+		if (n > len)
+			n = len;
+		fs = get_fs();
+		set_fs(get_ds());
+		written = out->f_op->write(out->f_inode, out, (char *) pb->page + pb->offset, n);
+		set_fs(fs);
+		if (written <= 0) {
+			error = written;
+			break;
+		}
+		pb->offset += written;
+		pb->len -= written;
+		PIPE_LEN(*inode) -= written;
+		if (!pb->len)
+			pipe_pop(inode);
+		total += written;
+		len -= written;
+		if (written < n)
+			break;
+	}
+	PIPE_LOCK(*inode)--;
+	wake_up_interruptible(&PIPE_WAIT(*inode));
+	return total? :error;
+}
+
+/*
+ * splice(fd_in, fd_out, len, flags) moves up to len bytes between a pipe
+ * and another file, at the files' current positions. One of the two
+ * must be a pipe (or an open fifo), and they can't be the same pipe.
+ */
+asmlinkage int sys_splice(unsigned int fd_in, unsigned int fd_out,
+	unsigned int len, unsigned int flags)
+{
+	struct file * in, * out;
+	struct inode * inode;
+	int nonblock = flags & SPLICE_F_NONBLOCK;
+
+	if (fd_in >= NR_OPEN || !(in = current->filp[fd_in]) || !in->f_inode)
+		return -EBADF;
+	if (fd_out >= NR_OPEN || !(out = current->filp[fd_out]) || !out->f_inode)
+		return -EBADF;
+	if (!(in->f_mode & 1) || !(out->f_mode & 2))
+		return -EBADF;
+	if (!len)
+		return 0;
+	if (in->f_inode == out->f_inode)
+		return -EINVAL;
+	inode = out->f_inode;
+	if (inode->i_pipe && PIPE_BUFS(*inode))
+		return splice_to_pipe(in, inode,
+			len, nonblock || (out->f_flags & O_NONBLOCK));
+	inode = in->f_inode;
+	if (inode->i_pipe && PIPE_BUFS(*inode))
+		return splice_from_pipe(inode, out,
+			len, nonblock || (in->f_flags & O_NONBLOCK));
+	return -EINVAL;
+}
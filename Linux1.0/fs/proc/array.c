@@ -128,17 +128,23 @@ static int get_uptime(char * buffer)
 		idle % HZ);
 }
 
+extern int get_page_cache_info(char *);
+
 static int get_meminfo(char * buffer)
 {
 	struct sysinfo i;
+	int len;
 
 	si_meminfo(&i);
 	si_swapinfo(&i);
-	return sprintf(buffer, "        total:   used:    free:   shared:  buffers:\n"
+	len = sprintf(buffer, "        total:   used:    free:   shared:  buffers:\n"
 		"Mem:  %8lu %8lu %8lu %8lu %8lu\n"
 		"Swap: %8lu %8lu %8lu\n",
 		i.totalram, i.totalram-i.freeram, i.freeram, i.sharedram, i.bufferram,
 		i.totalswap, i.totalswap-i.freeswap, i.freeswap);
+	len += get_page_cache_info(buffer + len);
+	len += get_swap_cache_info(buffer + len);
+	return len + get_reclaim_info(buffer + len);
 }
 
 static int get_version(char * buffer)
@@ -154,7 +160,7 @@ static struct task_struct ** get_task(pid_t pid)
 	struct task_struct ** p;
 
 	p = task;
-	while (++p < task+NR_TASKS) {
+	while (++p < task+nr_task_slots) {
 		if (*p && (*p)->pid == pid)
 			return p;
 	}
@@ -314,7 +320,7 @@ static int get_stat(int pid, char * buffer)
 		(*p)->priority, /* this is the nice value ---
 				   subtract 15 in your user-level program. */
 		(*p)->timeout,
-		(*p)->it_real_value,
+		it_real_remain(*p),
 		(*p)->start_time,
 		vsize,
 		(*p)->rss, /* you might want to shift this left 3 */
@@ -443,6 +449,9 @@ static int get_maps(int pid, char *buf)
 }
 
 extern int get_module_list(char *);
+extern int get_slabinfo(char *);
+extern int get_buffer_info(char *);
+extern int get_iostats(char *);
 
 static int array_read(struct inode * inode, struct file * file,char * buf, int count)
 {
@@ -500,6 +509,15 @@ static int array_read(struct inode * inode, struct file * file,char * buf, int c
 		case 17:
 			length = get_kstat(page);
 			break;
+		case 18:
+			length = get_slabinfo(page);
+			break;
+		case 19:
+			length = get_buffer_info(page);
+			break;
+		case 20:
+			length = get_iostats(page);
+			break;
 		default:
 			free_page((unsigned long) page);
 			return -EBADF;
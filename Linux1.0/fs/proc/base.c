@@ -114,10 +114,7 @@ static int proc_lookupbase(struct inode * dir,const char * name, int len,
 		ino = 1;
 	else
 		ino = (pid << 16) + base_dir[i].low_ino;
-	for (i = 0 ; i < NR_TASKS ; i++)
-		if (task[i] && task[i]->pid == pid)
-			break;
-	if (!pid || i >= NR_TASKS) {
+	if (!pid || !find_task_by_pid(pid)) {
 		iput(dir);
 		return -ENOENT;
 	}
@@ -140,10 +137,7 @@ static int proc_readbase(struct inode * inode, struct file * filp,
 		return -EBADF;
 	ino = inode->i_ino;
 	pid = ino >> 16;
-	for (i = 0 ; i < NR_TASKS ; i++)
-		if (task[i] && task[i]->pid == pid)
-			break;
-	if (!pid || i >= NR_TASKS)
+	if (!pid || !find_task_by_pid(pid))
 		return 0;
 	if (((unsigned) filp->f_pos) < NR_BASE_DIRENTRY) {
 		de = base_dir + filp->f_pos;
@@ -56,7 +56,6 @@ static int proc_lookupfd(struct inode * dir,const char * name, int len,
 	unsigned int ino, pid, fd, c;
 	struct task_struct * p;
 	struct super_block * sb;
-	int i;
 
 	*result = NULL;
 	ino = dir->i_ino;
@@ -99,10 +98,7 @@ static int proc_lookupfd(struct inode * dir,const char * name, int len,
 			break;
 		}
 	}
-	for (i = 0 ; i < NR_TASKS ; i++)
-		if ((p = task[i]) && p->pid == pid)
-			break;
-	if (!pid || i >= NR_TASKS)
+	if (!pid || !(p = find_task_by_pid(pid)))
 		return -ENOENT;
 	if (!ino) {
 		if (fd >= NR_OPEN || !p->filp[fd] || !p->filp[fd]->f_inode)
@@ -155,10 +151,7 @@ static int proc_readfd(struct inode * inode, struct file * filp,
 			return j;
 		}
 		fd -= 2;
-		for (i = 1 ; i < NR_TASKS ; i++)
-			if ((p = task[i]) && p->pid == pid)
-				break;
-		if (i >= NR_TASKS)
+		if (!pid || !(p = find_task_by_pid(pid)))
 			return 0;
 		if (!ino) {
 			if (fd >= NR_OPEN)
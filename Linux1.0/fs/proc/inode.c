@@ -78,7 +78,6 @@ void proc_read_inode(struct inode * inode)
 {
 	unsigned long ino, pid;
 	struct task_struct * p;
-	int i;
 	
 	inode->i_op = NULL;
 	inode->i_mode = 0;
@@ -92,21 +91,15 @@ void proc_read_inode(struct inode * inode)
 	ino = inode->i_ino;
         /* õ̵pidΪ˵õ */
 	pid = ino >> 16;
-	p = task[0];
         /* ҵӦĽ */
-	for (i = 0; i < NR_TASKS ; i++)
-		if ((p = task[i]) && (p->pid == pid))
-			break;
-	if (!p || i >= NR_TASKS)
+	p = pid ? find_task_by_pid(pid) : task[0];
+	if (!p)
 		return;
 
         /* procrootڵ */
 	if (ino == PROC_ROOT_INO) {
 		inode->i_mode = S_IFDIR | S_IRUGO | S_IXUGO;
-		inode->i_nlink = 2;
-		for (i = 1 ; i < NR_TASKS ; i++)
-			if (task[i])
-				inode->i_nlink++;
+		inode->i_nlink = 1 + nr_tasks;
 		inode->i_op = &proc_root_inode_operations;
 		return;
 	}
@@ -43,7 +43,6 @@ static int proc_follow_link(struct inode * dir, struct inode * inode,
 {
 	unsigned int pid, ino;
 	struct task_struct * p;
-	int i;
 
 	*res_inode = NULL;
 	if (dir)
@@ -58,10 +57,7 @@ static int proc_follow_link(struct inode * dir, struct inode * inode,
 	pid = ino >> 16;
 	ino &= 0x0000ffff;
 	iput(inode);
-	for (i = 0 ; i < NR_TASKS ; i++)
-		if ((p = task[i]) && p->pid == pid)
-			break;
-	if (i >= NR_TASKS)
+	if (!(p = find_task_by_pid(pid)))
 		return -ENOENT;
 	inode = NULL;
 	switch (ino) {
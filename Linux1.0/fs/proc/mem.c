@@ -25,6 +25,7 @@ static int mem_read(struct inode * inode, struct file * file,char * buf, int cou
 	unsigned long addr, pid, cr3;
 	char *tmp;
 	unsigned long pte, page;
+	struct task_struct * tsk;
 	int i;
 
 	if (count < 0)
@@ -32,11 +33,8 @@ static int mem_read(struct inode * inode, struct file * file,char * buf, int cou
 	pid = inode->i_ino;
 	pid >>= 16;
 	cr3 = 0;
-	for (i = 1 ; i < NR_TASKS ; i++)
-		if (task[i] && task[i]->pid == pid) {
-			cr3 = task[i]->tss.cr3;
-			break;
-		}
+	if (pid && (tsk = find_task_by_pid(pid)) != NULL)
+		cr3 = tsk->tss.cr3;
 	if (!cr3)
 		return -EACCES;
 	addr = file->f_pos;
@@ -73,6 +71,7 @@ static int mem_write(struct inode * inode, struct file * file,char * buf, int co
 	unsigned long addr, pid, cr3;
 	char *tmp;
 	unsigned long pte, page;
+	struct task_struct * tsk;
 	int i;
 
 	if (count < 0)
@@ -81,11 +80,8 @@ static int mem_write(struct inode * inode, struct file * file,char * buf, int co
 	pid = inode->i_ino;
 	pid >>= 16;
 	cr3 = 0;
-	for (i = 1 ; i < NR_TASKS ; i++)
-		if (task[i] && task[i]->pid == pid) {
-			cr3 = task[i]->tss.cr3;
-			break;
-		}
+	if (pid && (tsk = find_task_by_pid(pid)) != NULL)
+		cr3 = tsk->tss.cr3;
 	if (!cr3)
 		return -EACCES;
 	tmp = buf;
@@ -42,8 +42,10 @@ extern int tcp_get_info(char *);
 extern int udp_get_info(char *);
 extern int raw_get_info(char *);
 extern int arp_get_info(char *);
+extern int arp_stat_get_info(char *);
 extern int dev_get_info(char *);
 extern int rt_get_info(char *);
+extern int rt_stat_get_info(char *);
 #endif /* CONFIG_INET */
 
 
@@ -91,7 +93,9 @@ static struct proc_dir_entry net_dir[] = {
 	{ 131,3,"dev" },
 	{ 132,3,"raw" },
 	{ 133,3,"tcp" },
-	{ 134,3,"udp" }
+	{ 134,3,"udp" },
+	{ 135,8,"arp_stat" },
+	{ 136,7,"rt_stat" }
 #endif	/* CONFIG_INET */
 };
 
@@ -190,6 +194,12 @@ static int proc_readnet(struct inode * inode, struct file * file,
 		case 134:
 			length = udp_get_info(page);
 			break;
+		case 135:
+			length = arp_stat_get_info(page);
+			break;
+		case 136:
+			length = rt_stat_get_info(page);
+			break;
 #endif /* CONFIG_INET */
 		default:
 			free_page((unsigned long) page);
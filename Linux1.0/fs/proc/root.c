@@ -67,6 +67,9 @@ static struct proc_dir_entry root_dir[] = {
 	{14,5,"kcore" },
    	{16,7,"modules" },
    	{17,4,"stat" },
+	{18,8,"slabinfo" },
+	{19,7,"buffers" },
+	{20,7,"iostats" },
 };
 
 #define NR_ROOT_DIRENTRY ((sizeof (root_dir))/(sizeof (root_dir[0])))
@@ -111,10 +114,7 @@ static int proc_lookuproot(struct inode * dir,const char * name, int len,
 				break;
 			}
 		}
-		for (i = 0 ; i < NR_TASKS ; i++)
-			if (task[i] && task[i]->pid == pid)
-				break;
-		if (!pid || i >= NR_TASKS) {
+		if (!pid || !find_task_by_pid(pid)) {
 			iput(dir);
 			return -ENOENT;
 		}
@@ -153,7 +153,7 @@ repeat:
 		return j;
 	}
 	nr -= NR_ROOT_DIRENTRY;
-	if (nr >= NR_TASKS)
+	if (nr >= nr_task_slots)
 		return 0;
 	filp->f_pos++;
 	p = task[nr];
@@ -14,6 +14,8 @@
 #include <linux/stat.h>
 #include <linux/signal.h>
 #include <linux/errno.h>
+#include <linux/malloc.h>
+#include <linux/poll.h>
 
 #include <asm/segment.h>
 #include <asm/system.h>
@@ -38,15 +40,53 @@
  * Linus noticed.  -- jrs
  */
 
-static void free_wait(select_table * p)
+/*
+ * Called by select_wait() when the entry array is full: chain a new
+ * block of entries, remembering the old array so free_wait() can get
+ * back to it. We may be called with current->state already set to
+ * TASK_INTERRUPTIBLE, so we can't sleep here.
+ */
+struct select_table_entry * select_table_grow(select_table * p)
+{
+	struct select_table_more * more;
+
+	more = (struct select_table_more *) kmalloc(sizeof(*more), GFP_ATOMIC);
+	if (!more)
+		return NULL;
+	more->next = p->more;
+	more->prev_entry = p->entry;
+	more->prev_nr = p->nr;
+	more->prev_max = p->max;
+	p->more = more;
+	p->entry = more->entry;
+	p->max = SELECT_MORE_ENTRIES;
+	p->nr = 1;
+	return more->entry;
+}
+
+/* entryӵȴɾͷź飬
+ * ʱpָṩ
+ */
+void free_wait(select_table * p)
 {
-	struct select_table_entry * entry = p->entry + p->nr;
+	struct select_table_entry * entry;
+	struct select_table_more * more;
 
-	while (p->nr > 0) {
-		p->nr--;
-		entry--;
-		/* entryеwaitʵʵĵȴиɾ */
-		remove_wait_queue(entry->wait_address,&entry->wait);
+	for (;;) {
+		entry = p->entry + p->nr;
+		while (p->nr > 0) {
+			p->nr--;
+			entry--;
+			/* entryеwaitʵʵĵȴиɾ */
+			remove_wait_queue(entry->wait_address,&entry->wait);
+		}
+		if (!(more = p->more))
+			break;
+		p->more = more->next;
+		p->entry = more->prev_entry;
+		p->nr = more->prev_nr;
+		p->max = more->prev_max;
+		kfree_s(more, sizeof(*more));
 	}
 }
 
@@ -127,9 +167,13 @@ end_check:
 	FD_ZERO(res_out);
 	FD_ZERO(res_ex);
 	count = 0;
-	/* ʼȴб */
+	/* ʼȴбһҳselect_wait */
 	wait_table.nr = 0;
+	wait_table.max = __MAX_SELECT_TABLE_ENTRIES;
 	wait_table.entry = entry;
+	wait_table.more = NULL;
+	wait_table.func = NULL;
+	wait_table.data = NULL;
 	wait = &wait_table;
 repeat:
 	current->state = TASK_INTERRUPTIBLE;
@@ -299,3 +343,97 @@ asmlinkage int sys_select( unsigned long *buffer )
 	set_fd_set(n, exp, &res_ex);
 	return i;
 }
+
+/*
+ * poll() works like select(), but only on the fds in the array, so a
+ * few sparse, high numbered fds cost no more than low ones. The wait
+ * table and the double check are the same as in do_select().
+ */
+static int do_poll(unsigned int nfds, struct pollfd * fds)
+{
+	select_table wait_table, *wait;
+	struct select_table_entry *entry;
+	struct file * file;
+	unsigned int i;
+	int count, fd;
+	short events, revents;
+
+	if(!(entry = (struct select_table_entry*) __get_free_page(GFP_KERNEL)))
+		return -ENOMEM;
+	wait_table.nr = 0;
+	wait_table.max = __MAX_SELECT_TABLE_ENTRIES;
+	wait_table.entry = entry;
+	wait_table.more = NULL;
+	wait_table.func = NULL;
+	wait_table.data = NULL;
+	wait = &wait_table;
+repeat:
+	current->state = TASK_INTERRUPTIBLE;
+	count = 0;
+	for (i = 0 ; i < nfds ; i++) {
+		revents = 0;
+		if ((fd = fds[i].fd) >= 0) {
+			events = fds[i].events;
+			if (fd >= NR_OPEN || !(file = current->filp[fd]) || !file->f_inode)
+				revents = POLLNVAL;
+			else {
+				if ((events & POLLIN) && check(SEL_IN,wait,file))
+					revents |= POLLIN;
+				if ((events & POLLOUT) && check(SEL_OUT,wait,file))
+					revents |= POLLOUT;
+				if ((events & POLLPRI) && check(SEL_EX,wait,file))
+					revents |= POLLPRI;
+			}
+		}
+		fds[i].revents = revents;
+		if (revents) {
+			count++;
+			wait = NULL;
+		}
+	}
+	wait = NULL;
+	if (!count && current->timeout && !(current->signal & ~current->blocked)) {
+		schedule();
+		goto repeat;
+	}
+	free_wait(&wait_table);
+	free_page((unsigned long) entry);
+	current->state = TASK_RUNNING;
+	return count;
+}
+
+/*
+ * timeout is in milliseconds; a negative one waits forever.
+ */
+asmlinkage int sys_poll(struct pollfd * ufds, unsigned int nfds, int timeout)
+{
+	struct pollfd * fds;
+	unsigned int i;
+	int error;
+
+	if (nfds > POLL_MAX_FDS)
+		return -EINVAL;
+	error = verify_area(VERIFY_WRITE, ufds, nfds * sizeof(struct pollfd));
+	if (error)
+		return error;
+	if (!(fds = (struct pollfd *) __get_free_page(GFP_KERNEL)))
+		return -ENOMEM;
+	memcpy_fromfs(fds, ufds, nfds * sizeof(struct pollfd));
+	current->timeout = ~0UL;
+	if (timeout >= 0) {
+		current->timeout = (timeout / 1000) * HZ
+			+ ROUND_UP((timeout % 1000) * HZ, 1000);
+		if (current->timeout)
+			current->timeout += jiffies + 1;
+	}
+	error = do_poll(nfds, fds);
+	current->timeout = 0;
+	/* ֻдrevents */
+	if (error >= 0)
+		for (i = 0 ; i < nfds ; i++)
+			put_fs_word(fds[i].revents, &ufds[i].revents);
+	free_page((unsigned long) fds);
+	if (!error && (current->signal & ~current->blocked))
+		return -ERESTARTNOHAND;
+	return error;
+}
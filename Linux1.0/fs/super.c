@@ -165,6 +165,7 @@ static struct super_block * read_super(dev_t dev,char *name,int flags,
 	}
 	s->s_dev = dev;
 	s->s_flags = flags;
+	s->s_type = type;
 	/* ȻͨӦļϵͳ͵ĳȡȡ
 	 */
 	if (!type->read_super(s,data, silent)) {
@@ -254,6 +255,7 @@ static int do_umount(dev_t dev)
 	if (sb->s_op && sb->s_op->write_super && sb->s_dirt)
 		sb->s_op->write_super(sb);
 	put_super(dev);
+	dcache_invalidate(dev);
 	return 0;
 }
 
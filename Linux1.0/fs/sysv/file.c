@@ -23,6 +23,7 @@
 #include <linux/stat.h>
 #include <linux/string.h>
 #include <linux/locks.h>
+#include <linux/pagemap.h>
 
 #define	NBUF	32
 
@@ -299,6 +300,7 @@ static int sysv_file_write(struct inode * inode, struct file * filp, char * buf,
 		}
 		written += c;
 		memcpy_fromfs(p,buf,c);
+		update_page_cache(inode,pos-c,p,c);
 		buf += c;
 		bh->b_uptodate = 1;
 		bh->b_dirt = 1;
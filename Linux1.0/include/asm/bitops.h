@@ -41,6 +41,16 @@ extern __inline__ int clear_bit(int nr, void * addr)
 	return oldbit;
 }
 
+extern __inline__ int change_bit(int nr, void * addr)
+{
+	int oldbit;
+
+	__asm__ __volatile__("btcl %2,%1\n\tsbbl %0,%0"
+		:"=r" (oldbit),"=m" (ADDR)
+		:"r" (nr));
+	return oldbit;
+}
+
 /*
  * This routine doesn't need to be atomic, but it's faster to code it
  * this way.
@@ -100,6 +110,19 @@ extern __inline__ int clear_bit(int nr, int * addr)
 	return retval;
 }
 
+extern __inline__ int change_bit(int nr, int * addr)
+{
+	int	mask, retval;
+
+	addr += nr >> 5;
+	mask = 1 << (nr & 0x1f);
+	cli();
+	retval = (mask & *addr) != 0;
+	*addr ^= mask;
+	sti();
+	return retval;
+}
+
 extern __inline__ int test_bit(int nr, int * addr)
 {
 	int	mask;
@@ -0,0 +1,62 @@
+#ifndef _LINUX_EVENTPOLL_H
+#define _LINUX_EVENTPOLL_H
+
+/*
+ * Persistent readiness sets: epoll_create(), epoll_ctl() and
+ * epoll_wait(). See fs/eventpoll.c.
+ */
+
+#define EPOLL_CTL_ADD	1
+#define EPOLL_CTL_DEL	2
+#define EPOLL_CTL_MOD	3
+
+/* one event per select() class: SEL_IN, SEL_EX and SEL_OUT */
+#define EPOLLIN		0x0001
+#define EPOLLPRI	0x0002
+#define EPOLLOUT	0x0004
+
+/*
+ * Edge triggered: report an item once per wakeup on its queues, instead
+ * of every time epoll_wait() finds it still ready.
+ */
+#define EPOLLET		0x80000000
+
+struct epoll_event {
+	unsigned long events;
+	unsigned long data;		/* handed back as is by epoll_wait() */
+};
+
+#ifdef __KERNEL__
+
+#include <linux/wait.h>
+
+#define EP_HASH_SIZE	32		/* must be a power of two */
+#define EP_NR_WAIT	2		/* waits kept inside the item */
+#define EP_MAX_EVENTS	(4096 / sizeof (struct epoll_event))
+
+struct epitem {
+	struct epitem * next;		/* hash chain of the set */
+	struct epitem * rdnext;		/* ready list of the set */
+	struct epitem * f_next;		/* other items for the same file */
+	struct eventpoll * ep;
+	struct file * file;
+	int fd;
+	int ready;			/* on the ready list */
+	struct epoll_event event;
+	select_table wait;
+	struct select_table_entry entry[EP_NR_WAIT];
+};
+
+struct eventpoll {
+	struct wait_queue * wait;	/* epoll_wait() and select() on the set */
+	struct epitem * ready;
+	struct epitem ** ready_tail;
+	int nr_items;
+	struct epitem * hash[EP_HASH_SIZE];
+};
+
+extern void eventpoll_release(struct file * file);
+
+#endif /* __KERNEL__ */
+
+#endif
@@ -27,6 +27,12 @@
 #define F_SETOWN	8	/*  for sockets. */
 #define F_GETOWN	9	/*  for sockets. */
 
+#define F_SETPIPE_SZ	1031	/* pipe buffer size, in bytes */
+#define F_GETPIPE_SZ	1032
+
+/* for splice() */
+#define SPLICE_F_NONBLOCK	2
+
 /* for F_[GET|SET]FL */
 #define FD_CLOEXEC	1	/* actually anything with low bit set goes */
 
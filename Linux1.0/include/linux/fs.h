@@ -139,6 +139,9 @@ struct buffer_head {
 	unsigned char b_dirt;		/* 0-clean,1-dirty */
 	unsigned char b_lock;		/* 0 - ok, 1 -locked */
 	unsigned char b_req;		/* 0 if the buffer has been invalidated */
+	unsigned char b_list;		/* lru list the buffer was last filed on */
+	unsigned char b_reada;		/* read ahead, not yet asked for */
+	unsigned long b_flushtime;	/* when a dirty buffer should be written */
 	struct wait_queue * b_wait;
 	struct buffer_head * b_prev;		/* doubly linked list of hash-queue */
 	struct buffer_head * b_next;
@@ -189,10 +192,12 @@ struct inode {
 	struct wait_queue * i_wait;		/* inodeĵȴ */
 	struct file_lock * i_flock;	    /* ļṹͬ */
 	struct vm_area_struct * i_mmap; /* ļӳ䵽ַεĵַ */
+	struct page_cache * i_pages;	/* ļҳеҳ */
 	struct inode * i_next, * i_prev;     /*˫*/
 	struct inode * i_hash_next, * i_hash_prev; /*hash˫*/
 	struct inode * i_bound_to, * i_bound_by;
 	struct inode * i_mount;		/* inodeļϵͳĹص */
+	unsigned long i_version;	/* Ŀ¼ݵİ汾ֻжϻǷʱ */
 	struct socket * i_socket;  /*inodeָ*/
 	unsigned short i_count;
 	unsigned short i_flags;
@@ -215,6 +220,7 @@ struct inode {
 		struct nfs_inode_info nfs_i;
 		struct xiafs_inode_info xiafs_i;
 		struct sysv_inode_info sysv_i;
+		struct eventpoll * eventpoll_i;
 	} u;
 };
 
@@ -225,9 +231,13 @@ struct file {
 	unsigned short f_flags; /* ʲôķʽļֻֻдȵ */
 	unsigned short f_count;  /*ļü*/
 	unsigned short f_reada;
+	unsigned short f_rawin;		/* readahead window, in pages */
+	off_t f_ralast;			/* where the last read() ended */
+	unsigned long f_raend;		/* first page not read ahead yet */
 	struct file *f_next, *f_prev;
 	struct inode * f_inode;		/* ļӦinode */
 	struct file_operations * f_op;
+	struct epitem * f_ep;		/* epoll sets watching this file */
 };
 
 /* ļṹýṹļֽеĳһ */
@@ -274,6 +284,7 @@ struct super_block {
 	  */
 	struct inode * s_covered;    
 	struct inode * s_mounted;   /*ļϵͳĹص㣬Ǹļϵͳ/,ǹصinode */
+	struct file_system_type * s_type;
 	struct wait_queue * s_wait; /* ȴĽ̶ */
 	/* עⲿϢǳϢ */
 	union {
@@ -339,8 +350,17 @@ struct file_system_type {
 	struct super_block *(*read_super) (struct super_block *, void *, int);
 	char *name;
 	int requires_dev;
+	int fs_flags;
 };
 
+/*
+ * fs_flags: how the name cache in fs/dcache.c may be used. Positive
+ * entries are turned back into inodes with iget(), which only works if
+ * the inode number is all the filesystem needs to read the inode.
+ */
+#define FS_NO_DCACHE	1	/* names change without going through namei.c */
+#define FS_DCACHE_NEG	2	/* only remember names that don't exist */
+
 #ifdef __KERNEL__
 
 asmlinkage int sys_open(const char *, int, int);
@@ -362,6 +382,9 @@ extern struct file_operations def_chr_fops;
 extern struct inode_operations chrdev_inode_operations;
 
 extern void init_fifo(struct inode * inode);
+extern int pipe_alloc(struct inode * inode);
+extern void pipe_free(struct inode * inode);
+extern int pipe_fcntl(struct inode * inode, unsigned int cmd, unsigned long arg);
 
 extern struct file_operations connecting_fifo_fops;
 extern struct file_operations read_fifo_fops;
@@ -397,6 +420,14 @@ extern int fsync_dev(dev_t dev);
 extern void sync_supers(dev_t dev);
 extern int bmap(struct inode * inode,int block);
 extern int notify_change(int flags, struct inode * inode);
+extern unsigned long event;
+extern int dcache_lookup(struct inode * dir, const char * name, int len,
+	unsigned long * ino);
+extern void dcache_add(struct inode * dir, const char * name, int len,
+	unsigned long ino, unsigned long version);
+extern void dcache_invalidate(dev_t dev);
+/* Ŀ¼޸ĹˣĿ¼Ч */
+#define dcache_changed(dir)	((dir)->i_version = ++event)
 extern int namei(const char * pathname, struct inode ** res_inode);
 extern int lnamei(const char * pathname, struct inode ** res_inode);
 extern int permission(struct inode * inode,int mask);
@@ -415,6 +446,7 @@ extern struct buffer_head * get_hash_table(dev_t dev, int block, int size);
 extern struct buffer_head * getblk(dev_t dev, int block, int size);
 extern void ll_rw_block(int rw, int nr, struct buffer_head * bh[]);
 extern void ll_rw_page(int rw, int dev, int nr, char * buffer);
+extern void ll_rw_pages(int rw, int dev, int nr, char ** buffers, int count);
 extern void ll_rw_swap_file(int rw, int dev, unsigned int *b, int nb, char *buffer);
 extern void brelse(struct buffer_head * buf);
 extern void set_blocksize(dev_t dev, int size);
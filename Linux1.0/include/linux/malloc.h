@@ -27,4 +27,22 @@ void kfree_s(void * obj, int size);
 
 #endif
 
+/*
+ * Object caches: fixed-size objects carved out of whole pages. The
+ * constructor runs once per object when its page is added to the cache,
+ * not on every allocation, so an object should be handed back in its
+ * constructed state. kfree_s() recognises cache objects and returns them
+ * to their cache.
+ */
+struct kmem_cache;
+
+#define KMEM_NOREAP	1	/* never give free pages back */
+
+struct kmem_cache * kmem_cache_create(const char * name, int size, int align,
+	int flags, void (*ctor)(void *));
+void * kmem_cache_alloc(struct kmem_cache * cachep, int priority);
+void kmem_cache_free(struct kmem_cache * cachep, void * obj);
+int kmem_cache_shrink(struct kmem_cache * cachep);
+int kmem_cache_reap(void);
+
 #endif /* _LINUX_MALLOC_H */
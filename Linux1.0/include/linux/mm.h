@@ -77,18 +77,20 @@ extern volatile short free_page_ptr; /* used by malloc and tcp/ip. */
 
 extern int nr_swap_pages;
 extern int nr_free_pages;
-extern unsigned long free_page_list;
-extern int nr_secondary_pages;
-extern unsigned long secondary_page_list;
 
+/* free pages kept back for GFP_ATOMIC and last-resort allocations */
 #define MAX_SECONDARY_PAGES 20
 
+/* the buddy allocator hands out blocks of 1 << 0 .. 1 << 5 pages */
+#define NR_MEM_LISTS 6
+
 /*
  * This is timing-critical - most of the time in getting a new page
  * goes to clearing the page. If you want a page without the clearing
  * overhead, just use __get_free_page() directly..
  */
-extern unsigned long __get_free_page(int priority);
+extern unsigned long __get_free_pages(int priority, unsigned long order);
+#define __get_free_page(priority) __get_free_pages((priority),0)
 
 /* úõҳ0 */
 extern inline unsigned long get_free_page(int priority)
@@ -107,13 +109,16 @@ extern inline unsigned long get_free_page(int priority)
 
 /* memory.c */
 
-extern void free_page(unsigned long addr);
+extern void free_pages(unsigned long addr, unsigned long order);
+#define free_page(addr) free_pages((addr),0)
 extern unsigned long put_dirty_page(struct task_struct * tsk,unsigned long page,
 	unsigned long address);
 extern void free_page_tables(struct task_struct * tsk);
 extern void clear_page_tables(struct task_struct * tsk);
+extern int share_page_tables;
 extern int copy_page_tables(struct task_struct * to);
 extern int clone_page_tables(struct task_struct * to);
+extern unsigned long unshare_page_table(struct task_struct * tsk, unsigned long * page_dir);
 extern int unmap_page_range(unsigned long from, unsigned long size);
 extern int remap_page_range(unsigned long from, unsigned long to, unsigned long size, int mask);
 extern int zeromap_page_range(unsigned long from, unsigned long size, int mask);
@@ -143,6 +148,34 @@ extern unsigned long swap_duplicate(unsigned long page_nr);
 extern void swap_in(unsigned long *table_ptr);
 extern void si_swapinfo(struct sysinfo * val);
 extern void rw_swap_page(int rw, unsigned long nr, char * buf);
+extern void rw_swap_pages(int rw, unsigned long nr, char ** bufs, int count);
+extern unsigned long free_area_init(unsigned long start_mem, unsigned long end_mem);
+extern unsigned long * swap_cache;
+extern void swap_cache_dirty(unsigned long page);
+extern unsigned long swap_cache_init(unsigned long start_mem, unsigned long end_mem);
+extern int get_swap_cache_info(char * buffer);
+
+/*
+ * What try_to_free_page() looked at and got back, by where it got it
+ * from. Pages counted as young were looked at but left alone because
+ * they had been used lately.
+ */
+#define RECLAIM_SLAB		0
+#define RECLAIM_SWAP_CACHE	1
+#define RECLAIM_PAGE_CACHE	2
+#define RECLAIM_BUFFERS		3
+#define RECLAIM_SHM		4
+#define RECLAIM_ANON		5
+#define NR_RECLAIM		6
+
+struct reclaim_stat {
+	unsigned long scan;
+	unsigned long young;
+	unsigned long steal;
+};
+
+extern struct reclaim_stat reclaim_stat[NR_RECLAIM];
+extern int get_reclaim_info(char * buffer);
 
 /* mmap.c */
 extern int do_mmap(struct file * file, unsigned long addr, unsigned long len,
@@ -171,6 +204,39 @@ extern unsigned long high_memory;
 
 extern unsigned short * mem_map;
 
+/*
+ * Page ages, by MAP_NR: a page is given PAGE_AGE_INITIAL when it is
+ * allocated, the reclaimer makes it PAGE_AGE_ADVANCE younger each time it
+ * finds it referenced and one step older each time it doesn't, and only
+ * takes it once it has got to 0.
+ */
+#define PAGE_AGE_INITIAL	3
+#define PAGE_AGE_ADVANCE	3
+#define PAGE_AGE_MAX		20
+
+extern unsigned char * page_age;
+
+extern inline void touch_page(unsigned long page)
+{
+	unsigned char * age = page_age + MAP_NR(page);
+
+	if (*age < PAGE_AGE_MAX - PAGE_AGE_ADVANCE)
+		*age += PAGE_AGE_ADVANCE;
+	else
+		*age = PAGE_AGE_MAX;
+}
+
+/* Nonzero if the page was still too young to be taken */
+extern inline int age_page(unsigned long page)
+{
+	unsigned char * age = page_age + MAP_NR(page);
+
+	if (!*age)
+		return 0;
+	--*age;
+	return 1;
+}
+
 #define PAGE_PRESENT	0x001                /* ڴ */
 #define PAGE_RW		0x002
 #define PAGE_USER	0x004
@@ -187,11 +253,11 @@ extern unsigned short * mem_map;
 #define PAGE_TABLE	(PAGE_PRESENT | PAGE_RW | PAGE_USER | PAGE_ACCESSED)
 
 /* ȡڴȼ */
-/* free_page_listûпҳ򷵻ʧ
+/* ˱ҳ֮ûпҳ򷵻ʧ
  */
 #define GFP_BUFFER	0x00
-/* ʾһҪõڴ棬бfree_page_list꣬
- * ں˱ڴsecondary_page_list룬
+/* ʾһҪõڴ棬ҳ꣬
+ * ʹں˱MAX_SECONDARY_PAGESҳ
  * Ȼû뵽򷵻ؿգرںлжҪʱ
  */
 #define GFP_ATOMIC	0x01
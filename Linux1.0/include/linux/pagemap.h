@@ -0,0 +1,25 @@
+#ifndef _LINUX_PAGEMAP_H
+#define _LINUX_PAGEMAP_H
+
+/*
+ * Page cache: whole pages of regular file data, looked up by inode and
+ * page aligned file offset. See mm/filemap.c.
+ */
+
+#include <linux/fs.h>
+
+extern unsigned long page_cache_size;	/* pages in the cache */
+extern unsigned long reada_pages, reada_blocks, reada_hits, reada_wasted;
+
+extern void page_cache_init(void);
+extern int page_cache_read(struct inode * inode, unsigned long offset,
+	unsigned long * page);
+extern void update_page_cache(struct inode * inode, unsigned long pos,
+	const char * data, int count);
+extern void truncate_page_cache(struct inode * inode, unsigned long size);
+extern int shrink_page_cache(unsigned int priority);
+extern int generic_file_read(struct inode * inode, struct file * filp,
+	char * buf, int count);
+extern int get_page_cache_info(char * buffer);
+
+#endif
@@ -1,11 +1,31 @@
 #ifndef _LINUX_PIPE_FS_I_H
 #define _LINUX_PIPE_FS_I_H
 
+/*
+ * A pipe is a ring of page sized buffers. Pages written by the pipe
+ * itself can take more data at their end; pages splice() took from the
+ * page cache are only lent to the pipe and must not be written to.
+ */
+struct pipe_buffer {
+	unsigned long page;
+	unsigned short offset;		/* ҳеʼλ */
+	unsigned short len;
+	unsigned int flags;
+};
+
+#define PIPE_BUF_SHARED		1	/* ҳڹܵд */
+
+#define PIPE_DEF_BUFFERS	4	/* Ĭ16KB */
+#define PIPE_MAX_BUFFERS	16	/* F_SETPIPE_SZõ64KB */
+
 /* ܵļinodeṹ */
 struct pipe_inode_info {
 	struct wait_queue * wait;
-	char * base;                      /* ܵӦڴ */
-	unsigned int start;
+	struct pipe_buffer * bufs;        /* ܵӦĻ */
+	unsigned int curbuf;            /* һݵĻ */
+	unsigned int nrbufs;            /* ݵĻ */
+	unsigned int buffers;           /* ĴС2 */
+	unsigned long tmp_page;         /* պһҳ´д */
 	unsigned int len;               /* ܵݳ */
 	unsigned int lock;              /*  */
 	unsigned int rd_openers;
@@ -15,8 +35,11 @@ struct pipe_inode_info {
 };
 
 #define PIPE_WAIT(inode)	((inode).u.pipe_i.wait)
-#define PIPE_BASE(inode)	((inode).u.pipe_i.base)
-#define PIPE_START(inode)	((inode).u.pipe_i.start)
+#define PIPE_BUFS(inode)	((inode).u.pipe_i.bufs)
+#define PIPE_CURBUF(inode)	((inode).u.pipe_i.curbuf)
+#define PIPE_NRBUFS(inode)	((inode).u.pipe_i.nrbufs)
+#define PIPE_BUFFERS(inode)	((inode).u.pipe_i.buffers)
+#define PIPE_TMP_PAGE(inode)	((inode).u.pipe_i.tmp_page)
 #define PIPE_LEN(inode)		((inode).u.pipe_i.len)
 #define PIPE_RD_OPENERS(inode)	((inode).u.pipe_i.rd_openers)
 #define PIPE_WR_OPENERS(inode)	((inode).u.pipe_i.wr_openers)
@@ -25,12 +48,17 @@ struct pipe_inode_info {
 #define PIPE_LOCK(inode)	((inode).u.pipe_i.lock)
 #define PIPE_SIZE(inode)	PIPE_LEN(inode)
 
+/* һһݵĻ */
+#define PIPE_FIRST(inode)	(PIPE_BUFS(inode)[PIPE_CURBUF(inode)])
+#define PIPE_LAST(inode)	(PIPE_BUFS(inode)[(PIPE_CURBUF(inode)+PIPE_NRBUFS(inode)-1)&\
+							   (PIPE_BUFFERS(inode)-1)])
+/* һҳлд */
+#define PIPE_ROOM(inode)	((PIPE_NRBUFS(inode) && !(PIPE_LAST(inode).flags & PIPE_BUF_SHARED)) ?\
+				 PAGE_SIZE - PIPE_LAST(inode).offset - PIPE_LAST(inode).len : 0)
+
 #define PIPE_EMPTY(inode)	(PIPE_SIZE(inode)==0)
-#define PIPE_FULL(inode)	(PIPE_SIZE(inode)==PIPE_BUF)
-#define PIPE_FREE(inode)	(PIPE_BUF - PIPE_LEN(inode))
-#define PIPE_END(inode)		((PIPE_START(inode)+PIPE_LEN(inode))&\
-							   (PIPE_BUF-1))
-#define PIPE_MAX_RCHUNK(inode)	(PIPE_BUF - PIPE_START(inode))
-#define PIPE_MAX_WCHUNK(inode)	(PIPE_BUF - PIPE_END(inode))
+#define PIPE_FREE(inode)	((PIPE_BUFFERS(inode)-PIPE_NRBUFS(inode))*PAGE_SIZE +\
+				 PIPE_ROOM(inode))
+#define PIPE_FULL(inode)	(PIPE_FREE(inode)==0)
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef _LINUX_POLL_H
+#define _LINUX_POLL_H
+
+/*
+ * poll() takes an array of these instead of select()'s fd_set bitmaps,
+ * so only the fds that are asked about cost anything. See fs/select.c.
+ */
+
+struct pollfd {
+	int fd;			/* negative fds are skipped */
+	short events;
+	short revents;
+};
+
+/* the first three match the select() classes SEL_IN, SEL_EX and SEL_OUT */
+#define POLLIN		0x0001
+#define POLLPRI		0x0002
+#define POLLOUT		0x0004
+#define POLLNVAL	0x0020		/* fd not open: always reported */
+
+#ifdef __KERNEL__
+
+#define POLL_MAX_FDS	(4096 / sizeof (struct pollfd))
+
+#endif
+
+#endif
@@ -70,9 +70,10 @@ extern unsigned long avenrun[];		/* Load averages */
 #define CT_TO_USECS(x)	(((x) % HZ) * 1000000/HZ)
 
 #define FIRST_TASK task[0]
-#define LAST_TASK task[NR_TASKS-1]
+#define LAST_TASK task[nr_task_slots-1]
 
 #include <linux/head.h>
+#include <linux/ldt.h>
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/signal.h>
@@ -81,6 +82,7 @@ extern unsigned long avenrun[];		/* Load averages */
 #include <linux/resource.h>
 #include <linux/vm86.h>
 #include <linux/math_emu.h>
+#include <linux/timer.h>
 
 #define TASK_RUNNING		0
 #define TASK_INTERRUPTIBLE	1
@@ -307,6 +309,15 @@ struct task_struct {
 	short swap_page;		/* current page */ /* ǰҪ̶ҳ */
 #endif NEW_SWAP
 	struct vm_area_struct *stk_vma;
+/* run queue links - NULL when the task isn't on the run queue */
+	struct task_struct *next_run, *prev_run;
+	short run_array, run_level;
+	unsigned long run_epoch;	/* run queue epoch of last recharge */
+	struct timer_list real_timer;	/* ITIMER_REAL */
+/* pid, pgrp and session hash chains, see kernel/fork.c */
+	struct task_struct *pidhash_next, **pidhash_pprev;
+	struct task_struct *pgrp_next, **pgrp_pprev;
+	struct task_struct *session_next, **session_pprev;
 };
 
 /*
@@ -316,6 +327,8 @@ struct task_struct {
 					/* Not implemented yet, only for 486*/
 #define PF_PTRACED	0x00000010	/* set if ptrace (0) has been called. */
 #define PF_TRACESYS	0x00000020	/* tracing system calls */
+#define PF_VFORK	0x00000040	/* vfork() child still using its parent's memory */
+#define PF_VFORKWAIT	0x00000080	/* waiting for such a child to exec or exit */
 
 /*
  * cloning flags:
@@ -323,6 +336,7 @@ struct task_struct {
 #define CSIGNAL		0x000000ff	/* signal mask to be sent at exit */
 #define COPYVM		0x00000100	/* set if VM copy desired (like normal fork()) */
 #define COPYFD		0x00000200	/* set if fd's should be copied, not shared (NI) */
+#define VFORK		0x00000400	/* parent sleeps until the child execs or exits */
 
 /*
  *  INIT_TASK is used to set up the first task table, touch at
@@ -369,12 +383,40 @@ struct task_struct {
 }
 
 extern struct task_struct init_task;
-extern struct task_struct *task[NR_TASKS];
+extern struct task_struct **task;
+extern int nr_task_slots;
+
+/*
+ * Every task but task[0] is on three hash chains: by pid, by pgrp and by
+ * session. A chain holds all tasks whose key hashes to it, so walkers
+ * still have to compare the key. task_slot_map has a bit for each used
+ * task[] slot.
+ */
+#define PIDHASH_SZ	64
+#define pid_hashfn(x)	((((x) >> 6) ^ (x)) & (PIDHASH_SZ - 1))
+
+extern struct task_struct *pidhash[PIDHASH_SZ];
+extern struct task_struct *pgrphash[PIDHASH_SZ];
+extern struct task_struct *sesshash[PIDHASH_SZ];
+extern unsigned long task_slot_map[];
+extern int nr_tasks;
+
+extern void hash_task(struct task_struct * p);
+extern void unhash_task(struct task_struct * p);
+extern void set_pgrp_session(struct task_struct * p, int pgrp, int session);
+
+extern inline struct task_struct * find_task_by_pid(int pid)
+{
+	struct task_struct * p;
+
+	for (p = pidhash[pid_hashfn(pid)] ; p ; p = p->pidhash_next)
+		if (p->pid == pid)
+			break;
+	return p;
+}
 extern struct task_struct *last_task_used_math;
 extern struct task_struct *current;
 extern unsigned long volatile jiffies;
-extern unsigned long itimer_ticks;
-extern unsigned long itimer_next;
 extern struct timeval xtime;
 extern int need_resched;
 
@@ -384,6 +426,10 @@ extern void sleep_on(struct wait_queue ** p);
 extern void interruptible_sleep_on(struct wait_queue ** p);
 extern void wake_up(struct wait_queue ** p);
 extern void wake_up_interruptible(struct wait_queue ** p);
+extern void wake_up_process(struct task_struct * p);
+extern void vfork_release(struct task_struct * tsk);
+extern void it_real_fn(unsigned long);
+extern unsigned long it_real_remain(struct task_struct * p);
 
 extern void notify_parent(struct task_struct * tsk);
 extern int send_sig(unsigned long sig,struct task_struct * p,int priv);
@@ -402,20 +448,22 @@ extern int irqaction(unsigned int irq,struct sigaction * sa);
  *   4 - user data segment
  * ...
  *   8 - TSS #0
- *   9 - LDT #0
+ *   9 - LDT
  *  10 - TSS #1
- *  11 - LDT #1
- */
-/* ϵͳΪÿ̱ν棬nΪtask_structе
- * ÿռ8byteÿռn<<4,ȻҪǰ
- * ʼλõƫҲ_TSS(n)ȡĵַ
+ *
+ * The descriptors no longer belong to a task. switch_to() writes the
+ * next task's TSS into whichever of the two TSS entries the current
+ * task isn't running on (the other one is busy), and its LDT into the
+ * single LDT entry, just before jumping to it.
  */
+/* nֻ01ʾʹõTSS */
 #define FIRST_TSS_ENTRY 8
 #define FIRST_LDT_ENTRY (FIRST_TSS_ENTRY+1)
 #define _TSS(n) ((((unsigned long) n)<<4)+(FIRST_TSS_ENTRY<<3))
 #define _LDT(n) ((((unsigned long) n)<<4)+(FIRST_LDT_ENTRY<<3))
 #define load_TR(n) __asm__("ltr %%ax": /* no output */ :"a" (_TSS(n)))
 #define load_ldt(n) __asm__("lldt %%ax": /* no output */ :"a" (_LDT(n)))
+/* n is which of the two TSS entries the CPU is running on, 0 or 1 */
 #define store_TR(n) \
 __asm__("str %%ax\n\t" \
 	"subl %2,%%eax\n\t" \
@@ -423,28 +471,48 @@ __asm__("str %%ax\n\t" \
 	:"=a" (n) \
 	:"0" (0),"i" (FIRST_TSS_ENTRY<<3))
 /*
- *	switch_to(n) should switch tasks to task nr n, first
- * checking that n isn't the current task, in which case it does nothing.
+ *	switch_to(tsk) should switch tasks to task tsk, first
+ * checking that tsk isn't the current task, in which case it does nothing.
  * This also clears the TS-flag if the task we switched to has used
  * tha math co-processor latest.
  */
 /* currentʱ򱻸ı䣬Ҳлtsk
  */
 #define switch_to(tsk) \
-__asm__("cmpl %%ecx,_current\n\t" \
-	"je 1f\n\t" \
-	"cli\n\t" \
-	"xchgl %%ecx,_current\n\t" \
-	"ljmp %0\n\t" \
-	"sti\n\t" \
-	"cmpl %%ecx,_last_task_used_math\n\t" \
-	"jne 1f\n\t" \
-	"clts\n" \
-	"1:" \
-	: /* no output */ \
-	:"m" (*(((char *)&tsk->tss.tr)-4)), \
-	 "c" (tsk) \
-	:"cx")
+do { \
+	if ((tsk) != current) { \
+		cli(); \
+		set_task_desc(tsk); \
+		__asm__("xchgl %%ecx,_current\n\t" \
+			"ljmp %0\n\t" \
+			"sti\n\t" \
+			"cmpl %%ecx,_last_task_used_math\n\t" \
+			"jne 1f\n\t" \
+			"clts\n" \
+			"1:" \
+			: /* no output */ \
+			:"m" (*(((char *)&(tsk)->tss.tr)-4)), \
+			 "c" (tsk) \
+			:"cx"); \
+	} \
+} while (0)
+
+/* ѽ̵LDTдGDTеLDT֮lldtлŻõ */
+#define set_task_ldt(tsk) \
+do { \
+	if ((tsk)->ldt) \
+		set_ldt_desc(gdt+FIRST_LDT_ENTRY,(tsk)->ldt,LDT_ENTRIES); \
+	else \
+		set_ldt_desc(gdt+FIRST_LDT_ENTRY,&default_ldt,1); \
+} while (0)
+
+/* ڹжϵµãcurrentõTSSæģһ */
+#define set_task_desc(tsk) \
+do { \
+	(tsk)->tss.tr = (current->tss.tr == _TSS(0)) ? _TSS(1) : _TSS(0); \
+	set_tss_desc(gdt+((tsk)->tss.tr>>3),&(tsk)->tss); \
+	set_task_ldt(tsk); \
+} while (0)
 
 #define _set_base(addr,base) \
 __asm__("movw %%dx,%0\n\t" \
@@ -555,6 +623,9 @@ extern inline void remove_wait_queue(struct wait_queue ** p, struct wait_queue *
 #endif
 }
 
+extern struct select_table_entry * select_table_grow(select_table * p);
+extern void free_wait(select_table * p);
+
 extern inline void select_wait(struct wait_queue ** wait_address, select_table * p)
 {
 	struct select_table_entry * entry;
@@ -562,18 +633,18 @@ extern inline void select_wait(struct wait_queue ** wait_address, select_table *
 	/* һָΪNULL,򷵻أ */
 	if (!p || !wait_address)
 		return;
-	/* ܳ */
-	if (p->nr >= __MAX_SELECT_TABLE_ENTRIES)
+	/* ǰʱµһʹ */
+	if (p->nr < p->max)
+		entry = p->entry + p->nr++;
+	else if (!(entry = select_table_grow(p)))
 		return;
-	/* ȡǰentryĵַ */
- 	entry = p->entry + p->nr;
 	/* עطҪҲҪ¼waitǵȴĸ */
 	entry->wait_address = wait_address;
 	entry->wait.task = current;
 	entry->wait.next = NULL;
+	entry->wait.func = p->func;
+	entry->data = p->data;
 	add_wait_queue(wait_address,&entry->wait);
-	/* nr */
-	p->nr++;
 }
 
 extern void __down(struct semaphore * sem);
@@ -5,6 +5,7 @@
  */
 
 #define sys_clone sys_fork
+#define sys_vfork sys_fork
 
 #ifdef __cplusplus
 extern "C" {
@@ -145,6 +146,11 @@ extern int sys_quotactl();
 extern int sys_getpgid();
 extern int sys_fchdir();
 extern int sys_bdflush();
+extern int sys_epoll_create();
+extern int sys_epoll_ctl();
+extern int sys_epoll_wait();
+extern int sys_poll();
+extern int sys_splice();
 
 /*
  * These are system calls that will be removed at some time
@@ -168,7 +174,6 @@ extern int sys_bdflush();
  */
 
 #define sys_quotactl	sys_ni_syscall
-#define sys_bdflush	sys_ni_syscall
 
 typedef int (*fn_ptr)();
 
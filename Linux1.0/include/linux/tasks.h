@@ -2,8 +2,11 @@
 #define _LINUX_TASKS_H
 
 /*
- * This is the maximum nr of tasks - change it if you need to
+ * This is the maximum nr of tasks - change it if you need to.
+ * task[] starts out with INIT_TASKS slots and fork() grows it on
+ * demand, so only the limit costs nothing.
  */
-#define NR_TASKS	128
+#define NR_TASKS	4096
+#define INIT_TASKS	128
 
 #endif
@@ -72,6 +72,12 @@ extern struct timer_struct timer_table[32];
  * The "data" field is in case you want to use the same
  * timeout function for several timeouts. You can use this
  * to distinguish between the different invocations.
+ *
+ * "expires" is relative (in ticks from now) when passed to
+ * add_timer(), and del_timer() leaves the remaining time in it.
+ * A timer must be cleared with init_timer() (or be a zeroed static)
+ * before it is first used: add_timer() and del_timer() use the
+ * list pointers to tell whether it is pending.
  */
 struct timer_list {
 	struct timer_list *next;  /* עtimerһ˫ʵʹõʱΪһ */
@@ -81,7 +87,17 @@ struct timer_list {
 	void (*function)(unsigned long);
 };
 
+#ifndef NULL
+#define NULL ((void *) 0)
+#endif
+
 extern void add_timer(struct timer_list * timer);
 extern int  del_timer(struct timer_list * timer);
 
+extern inline void init_timer(struct timer_list * timer)
+{
+	timer->next = NULL;
+	timer->prev = NULL;
+}
+
 #endif
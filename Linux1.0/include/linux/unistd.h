@@ -141,6 +141,12 @@
 #define __NR_getpgid		132
 #define __NR_fchdir		133
 #define __NR_bdflush		134
+#define __NR_vfork		135
+#define __NR_epoll_create	136
+#define __NR_epoll_ctl		137
+#define __NR_epoll_wait		138
+#define __NR_poll		139
+#define __NR_splice		140
 
 extern int errno;
 
@@ -9,6 +9,7 @@
 struct wait_queue {
 	struct task_struct * task;
 	struct wait_queue * next;
+	void (*func)(struct wait_queue *);	/* ΪNULLʱwake_upǻtask */
 };
 
 struct semaphore {
@@ -21,14 +22,33 @@ struct semaphore {
 struct select_table_entry {
 	struct wait_queue wait;			/* ʵӵȴеı */
 	struct wait_queue ** wait_address;  /* ָʵʵȴײwait_addressɾwait */
+	void * data;			/* wait.funcصʱʹ */
 };
 
+/*
+ * The entry array is supplied by the caller. When it fills up,
+ * select_wait() chains more entries from kmalloc() instead of
+ * dropping the wait, so the number of waits is not limited.
+ */
 typedef struct select_table_struct {
-	int nr;
+	int nr;					/* ǰʹõentry */
+	int max;				/* ǰĴС */
 	struct select_table_entry * entry;
+	struct select_table_more * more;	/*  */
+	void (*func)(struct wait_queue *);	/* Ƶÿentrywait.func */
+	void * data;
 } select_table;
 
-/* һselect_tableֻռһҳڴСselect_table_entry */
+#define SELECT_MORE_ENTRIES 32
+
+struct select_table_more {
+	struct select_table_more * next;
+	struct select_table_entry * prev_entry;	/* һ֮ǰ */
+	int prev_nr, prev_max;
+	struct select_table_entry entry[SELECT_MORE_ENTRIES];
+};
+
+/* ṩһҳڴɵselect_table_entry */
 #define __MAX_SELECT_TABLE_ENTRIES (4096 / sizeof (struct select_table_entry))
 
 #endif
@@ -19,10 +19,12 @@
 #include <linux/string.h>
 #include <linux/timer.h>
 #include <linux/fs.h>
+#include <linux/pagemap.h>
 #include <linux/ctype.h>
 #include <linux/delay.h>
 #include <linux/utsname.h>
 #include <linux/ioport.h>
+#include <linux/poll.h>
 
 extern unsigned long * prof_buffer;
 extern unsigned long prof_len;
@@ -57,12 +59,35 @@ static inline _syscall3(int,open,const char *,file,int,flag,int,mode)
 static inline _syscall1(int,close,int,fd)
 static inline _syscall1(int,_exit,int,exitcode)
 static inline _syscall3(pid_t,waitpid,pid_t,pid,int *,wait_stat,int,options)
+static inline _syscall2(int,bdflush,int,func,long,data)
 
 static inline pid_t wait(int * wait_stat)
 {
 	return waitpid(-1,wait_stat,0);
 }
 
+#ifdef CONFIG_FORK_BENCH
+static inline _syscall0(int,vfork)
+#endif
+#ifdef CONFIG_POLL_BENCH
+static inline _syscall1(int,pipe,unsigned long *,fildes)
+static inline _syscall1(int,select,unsigned long *,buffer)
+static inline _syscall3(int,poll,struct pollfd *,ufds,unsigned int,nfds,int,timeout)
+#endif
+#if defined(CONFIG_FORK_BENCH) || defined(CONFIG_POLL_BENCH)
+static inline _syscall1(long,times,void *,tbuf)
+
+/* wait for the next tick and return it, to time from */
+static long bench_tick(void)
+{
+	long start = times(NULL);
+
+	while (times(NULL) == start)
+		/* nothing */;
+	return times(NULL);
+}
+#endif
+
 static char printbuf[1024];
 
 extern int console_loglevel;
@@ -94,6 +119,7 @@ extern void sound_setup(char *str, int *ints);
 #ifdef CONFIG_SBPCD
 extern void sbpcd_setup(char *str, int *ints);
 #endif CONFIG_SBPCD
+extern void elevator_setup(char *str, int *ints);
 
 #ifdef CONFIG_SYSVIPC
 extern void ipc_init(void);
@@ -101,6 +127,12 @@ extern void ipc_init(void);
 #ifdef CONFIG_SCSI
 extern unsigned long scsi_dev_init(unsigned long, unsigned long);
 #endif
+#ifdef CONFIG_TIMER_STRESS
+extern void timer_stress(void);
+#endif
+#ifdef CONFIG_SOCK_BENCH
+extern void sock_bench(void);
+#endif
 
 /*
  * This is set up by the setup-routine at boot-time
@@ -178,6 +210,7 @@ struct {
 	void (*setup_func)(char *, int *);
 } bootsetups[] = {
 	{ "reserve=", reserve_setup },
+	{ "elevator=", elevator_setup },
 #ifdef CONFIG_INET
 	{ "ether=", eth_setup },
 #endif
@@ -431,6 +464,7 @@ asmlinkage void start_kernel(void)
 	memory_start = file_table_init(memory_start,memory_end);
 	mem_init(low_memory_start,memory_start,memory_end);
 	buffer_init();
+	page_cache_init();
 	time_init();
 	floppy_init();
 	sock_init();
@@ -439,6 +473,12 @@ asmlinkage void start_kernel(void)
 	ipc_init();
 #endif
 	sti();
+#ifdef CONFIG_TIMER_STRESS
+	timer_stress();
+#endif
+#ifdef CONFIG_SOCK_BENCH
+	sock_bench();
+#endif
 	
 	/*
 	 * check if exception 16 works correctly.. This is truly evil
@@ -511,15 +551,121 @@ static int printf(const char *fmt, ...)
  * ¼shelḷȻ1̵ȴ¼̽¼֮
  * ûնˣûɽв
  */
+#ifdef CONFIG_FORK_BENCH
+/*
+ * Boot-time fork+exec benchmark, run by init before it starts
+ * /etc/init: for a second each, fork a child that exec()s /bin/true
+ * (or just exits, if there isn't one) and wait for it. This is done
+ * with page tables copied at fork, with them shared until the first
+ * write, and with vfork().
+ */
+static char * argv_true[] = { "/bin/true", NULL };
+
+static void fork_bench(void)
+{
+	static char * mode_name[3] = {
+		"fork, page tables copied", "fork, page tables shared", "vfork" };
+	int mode, pid, i, n;
+	long start;
+
+	for (mode = 0 ; mode < 3 ; mode++) {
+		share_page_tables = (mode != 0);
+		start = bench_tick();
+		n = 0;
+		do {
+			pid = (mode == 2) ? vfork() : fork();
+			if (!pid) {
+				execve("/bin/true",argv_true,envp_init);
+				_exit(0);
+			}
+			if (pid < 0)
+				break;
+			while (pid != wait(&i))
+				/* nothing */;
+			n++;
+		} while (times(NULL) - start < HZ);
+		printf("%s: %d fork+exec a second\n\r", mode_name[mode], n);
+	}
+	share_page_tables = 1;
+}
+#endif
+
+#ifdef CONFIG_POLL_BENCH
+/*
+ * Boot-time select() against poll() benchmark, run by init before it
+ * starts /etc/init: with 10, 100 and 250 pipe fds open, none of them
+ * readable, count how many select() and poll() calls with a zero
+ * timeout for readability of all of them go through in a second.
+ */
+static struct pollfd bench_pfd[250];
+
+static void poll_bench(void)
+{
+	static int sizes[3] = { 10, 100, 250 };
+	unsigned long fds[2], sel[5];
+	fd_set in, tmp;
+	struct timeval tv;
+	int s, i, nfds, maxfd, nsel, npoll;
+	long start;
+
+	for (s = 0 ; s < 3 ; s++) {
+		FD_ZERO(&in);
+		maxfd = 0;
+		for (nfds = 0 ; nfds < sizes[s] ; nfds += 2) {
+			if (pipe(fds) < 0)
+				break;
+			for (i = 0 ; i < 2 ; i++) {
+				bench_pfd[nfds+i].fd = fds[i];
+				bench_pfd[nfds+i].events = POLLIN;
+				FD_SET(fds[i], &in);
+				if (fds[i] > maxfd)
+					maxfd = fds[i];
+			}
+		}
+		sel[0] = maxfd + 1;
+		sel[1] = (unsigned long) &tmp;
+		sel[2] = sel[3] = 0;
+		sel[4] = (unsigned long) &tv;
+		start = bench_tick();
+		nsel = 0;
+		do {
+			tmp = in;
+			tv.tv_sec = tv.tv_usec = 0;
+			select(sel);
+			nsel++;
+		} while (times(NULL) - start < HZ);
+		start = bench_tick();
+		npoll = 0;
+		do {
+			poll(bench_pfd, nfds, 0);
+			npoll++;
+		} while (times(NULL) - start < HZ);
+		printf("%d fds: %d select() and %d poll() calls a second\n\r",
+			nfds, nsel, npoll);
+		for (i = 0 ; i < nfds ; i++)
+			close(bench_pfd[i].fd);
+	}
+}
+#endif
+
 void init(void)
 {
 	int pid,i;
 	/*˸ļϵͳ*/
 	setup((void *) &drive_info);
+	/* дֻ̣յźʱŻ᷵ */
+	if (!fork())
+		_exit(bdflush(0,0));
 	sprintf(term, "TERM=con%dx%d", ORIG_VIDEO_COLS, ORIG_VIDEO_LINES);
 	(void) open("/dev/tty1",O_RDWR,0);
 	(void) dup(0);
 	(void) dup(0);
+#ifdef CONFIG_POLL_BENCH
+	poll_bench();
+#endif
+#ifdef CONFIG_FORK_BENCH
+	fork_bench();
+#endif
 
 	execve("/etc/init",argv_init,envp_init);
 	execve("/bin/init",argv_init,envp_init);
@@ -355,6 +355,9 @@ static int shm_map (struct shm_desc *shmd, int remap)
 		/* ȡҳĿ¼е */
 		page_table = PAGE_DIR_OFFSET(page_dir,tmp);
 		if (*page_table & PAGE_PRESENT) {
+			if (!(*page_table & PAGE_RW) &&
+			    !unshare_page_table(shmd->task, page_table))
+				return -ENOMEM;
 			page_table = (ulong *) (PAGE_MASK & *page_table);
 			page_table += ((tmp >> PAGE_SHIFT) & (PTRS_PER_PAGE-1));
 			if (*page_table) {
@@ -727,6 +730,11 @@ int shm_swap (int prio)
 		swap_free (swap_nr);
 		return 0;
 	}
+	reclaim_stat[RECLAIM_SHM].scan++;
+	if (age_page(page)) {
+		reclaim_stat[RECLAIM_SHM].young++;
+		goto check_table;
+	}
 	for (shmd = shp->attaches; shmd; shmd = shmd->seg_next) {
 		unsigned long tmp, *pte;
 		if ((shmd->shm_sgn >> SHM_ID_SHIFT & SHM_ID_MASK) != id) {
@@ -752,6 +760,7 @@ int shm_swap (int prio)
 			continue;
 		if (tmp & PAGE_ACCESSED) {
 			*pte &= ~PAGE_ACCESSED;
+			touch_page(page);
 			continue;  
 		}
 		tmp = shmd->shm_sgn | idx << SHM_IDX_SHIFT;
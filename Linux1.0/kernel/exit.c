@@ -17,6 +17,7 @@
 #include <linux/malloc.h>
 
 #include <asm/segment.h>
+#include <asm/bitops.h>
 extern void shm_exit (void);
 extern void sem_exit (void);
 
@@ -65,7 +66,7 @@ int send_sig(unsigned long sig,struct task_struct * p,int priv)
 		return 0;
 	if ((sig == SIGKILL) || (sig == SIGCONT)) {
 		if (p->state == TASK_STOPPED)
-			p->state = TASK_RUNNING;
+			wake_up_process(p);
 		p->exit_code = 0;
 		p->signal &= ~( (1<<(SIGSTOP-1)) | (1<<(SIGTSTP-1)) |
 				(1<<(SIGTTIN-1)) | (1<<(SIGTTOU-1)) );
@@ -75,6 +76,9 @@ int send_sig(unsigned long sig,struct task_struct * p,int priv)
 		p->signal &= ~(1<<(SIGCONT-1));
 	/* Actually generate the signal */
 	generate(sig,p);
+	/* schedule() no longer looks at sleeping tasks: wake it up here */
+	if (p->state == TASK_INTERRUPTIBLE && (p->signal & ~p->blocked))
+		wake_up_process(p);
 	return 0;
 }
 
@@ -98,9 +102,12 @@ void release(struct task_struct * p)
 		printk("task releasing itself\n");
 		return;
 	}
-	for (i=1 ; i<NR_TASKS ; i++)
+	for (i=1 ; i<nr_task_slots ; i++)
 		if (task[i] == p) {
 			task[i] = NULL;
+			clear_bit(i, task_slot_map);
+			nr_tasks--;
+			unhash_task(p);
 			REMOVE_LINKS(p);
 			free_page(p->kernel_stack_page);
 			free_page((long) p);
@@ -120,7 +127,7 @@ int bad_task_ptr(struct task_struct *p)
 
 	if (!p)
 		return 0;
-	for (i=0 ; i<NR_TASKS ; i++)
+	for (i=0 ; i<nr_task_slots ; i++)
 		if (task[i] == p)
 			return 0;
 	return 1;
@@ -139,7 +146,7 @@ void audit_ptree(void)
 {
 	int	i;
 
-	for (i=1 ; i<NR_TASKS ; i++) {
+	for (i=1 ; i<nr_task_slots ; i++) {
 		if (!task[i])
 			continue;
 		if (bad_task_ptr(task[i]->p_pptr))
@@ -215,14 +222,14 @@ int session_of_pgrp(int pgrp)
 	int fallback;
 
 	fallback = -1;
-	for_each_task(p) {
+	for (p = pgrphash[pid_hashfn(pgrp)] ; p ; p = p->pgrp_next) {
  		if (p->session <= 0)
  			continue;
 		if (p->pgrp == pgrp)
 			return p->session;
-		if (p->pid == pgrp)
-			fallback = p->session;
 	}
+	if ((p = find_task_by_pid(pgrp)) != NULL && p->session > 0)
+		fallback = p->session;
 	return fallback;
 }
 
@@ -240,7 +247,7 @@ int kill_pg(int pgrp, int sig, int priv)
 
 	if (sig<0 || sig>32 || pgrp<=0)
 		return -EINVAL;
-	for_each_task(p) {
+	for (p = pgrphash[pid_hashfn(pgrp)] ; p ; p = p->pgrp_next) {
         /* ͬ */
 		if (p->pgrp == pgrp) {
 			if ((err = send_sig(sig,p,priv)) != 0)
@@ -268,7 +275,7 @@ int kill_sl(int sess, int sig, int priv)
 
 	if (sig<0 || sig>32 || sess<=0)
 		return -EINVAL;
-	for_each_task(p) {
+	for (p = sesshash[pid_hashfn(sess)] ; p ; p = p->session_next) {
         /* һỰдڶ飬ÿһ쵼 */
 		if (p->session == sess && p->leader) {
 			if ((err = send_sig(sig,p,priv)) != 0)
@@ -287,10 +294,8 @@ int kill_proc(int pid, int sig, int priv)
 
 	if (sig<0 || sig>32)
 		return -EINVAL;
-	for_each_task(p) {
-		if (p && p->pid == pid)
-			return send_sig(sig,p,priv);
-	}
+	if ((p = find_task_by_pid(pid)) != NULL)
+		return send_sig(sig,p,priv);
 	return(-ESRCH);
 }
 
@@ -336,7 +341,7 @@ int is_orphaned_pgrp(int pgrp)
 {
 	struct task_struct *p;
 
-	for_each_task(p) {
+	for (p = pgrphash[pid_hashfn(pgrp)] ; p ; p = p->pgrp_next) {
 		if ((p->pgrp != pgrp) || 
 		    (p->state == TASK_ZOMBIE) ||
 		    (p->p_pptr->pid == 1))
@@ -352,7 +357,7 @@ static int has_stopped_jobs(int pgrp)
 {
 	struct task_struct * p;
 
-	for_each_task(p) {
+	for (p = pgrphash[pid_hashfn(pgrp)] ; p ; p = p->pgrp_next) {
 		if (p->pgrp != pgrp)
 			continue;
 		if (p->state == TASK_STOPPED)
@@ -381,11 +386,13 @@ NORET_TYPE void do_exit(long code)
 	int i;
 
 fake_volatile:
+	del_timer(&current->real_timer);
 	if (current->semun)
 		sem_exit();
 	if (current->shm)
 		shm_exit();
 	free_page_tables(current);
+	vfork_release(current);
 	for (i=0 ; i<NR_OPEN ; i++)
 		if (current->filp[i])
 			sys_close(i);
@@ -414,12 +421,8 @@ fake_volatile:
 	if (current->ldt) {
 		vfree(current->ldt);
 		current->ldt = NULL;
-		for (i=1 ; i<NR_TASKS ; i++) {
-			if (task[i] == current) {
-				set_ldt_desc(gdt+(i<<1)+FIRST_LDT_ENTRY, &default_ldt, 1);
-				load_ldt(i);
-			}
-		}
+		set_task_ldt(current);
+		load_ldt(0);
 	}
 
 	current->state = TASK_ZOMBIE;
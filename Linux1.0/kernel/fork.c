@@ -20,10 +20,12 @@
 #include <linux/segment.h>
 #include <linux/ptrace.h>
 #include <linux/malloc.h>
+#include <linux/string.h>
 #include <linux/ldt.h>
 
 #include <asm/segment.h>
 #include <asm/system.h>
+#include <asm/bitops.h>
 
 asmlinkage void ret_from_sys_call(void) __asm__("ret_from_sys_call");
 
@@ -35,44 +37,179 @@ asmlinkage void ret_from_sys_call(void) __asm__("ret_from_sys_call");
 extern int shm_fork(struct task_struct *, struct task_struct *);
 long last_pid=0;
 
-//Ѱҿеtask_struct,
-static int find_empty_process(void)
+struct task_struct * pidhash[PIDHASH_SZ];
+struct task_struct * pgrphash[PIDHASH_SZ];
+struct task_struct * sesshash[PIDHASH_SZ];
+unsigned long task_slot_map[(NR_TASKS+31)/32] = { 1, };	/* task[0] */
+int nr_tasks = 1;
+
+#define hash_in(p,table,key,next,pprev) do { \
+	struct task_struct ** __h = &(table)[pid_hashfn(key)]; \
+	if (((p)->next = *__h) != NULL) \
+		(*__h)->pprev = &(p)->next; \
+	*__h = (p); \
+	(p)->pprev = __h; \
+	} while (0)
+
+#define hash_out(p,next,pprev) do { \
+	if ((p)->next) \
+		(p)->next->pprev = (p)->pprev; \
+	*(p)->pprev = (p)->next; \
+	} while (0)
+
+/*
+ * The tty code sends signals to process groups from interrupts, so the
+ * chains are only changed with interrupts off.
+ */
+void hash_task(struct task_struct * p)
 {
-	int free_task;
-	int i, tasks_free;
-	int this_user_tasks;
+	unsigned long flags;
 
-repeat:
-	//޶̺ŵֵ
-	if ((++last_pid) & 0xffff8000)
-		last_pid=1;
-	this_user_tasks = 0;
-	tasks_free = 0;
-	free_task = -EAGAIN;
-	i = NR_TASKS;
-	//ӷʼѰ
-	while (--i > 0) {
-		if (!task[i]) {
-			//ҵһеģֹͣѰ
-			free_task = i;
-			tasks_free++;
-			continue;
+	save_flags(flags);
+	cli();
+	hash_in(p, pidhash, p->pid, pidhash_next, pidhash_pprev);
+	hash_in(p, pgrphash, p->pgrp, pgrp_next, pgrp_pprev);
+	hash_in(p, sesshash, p->session, session_next, session_pprev);
+	restore_flags(flags);
+}
+
+void unhash_task(struct task_struct * p)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	hash_out(p, pidhash_next, pidhash_pprev);
+	hash_out(p, pgrp_next, pgrp_pprev);
+	hash_out(p, session_next, session_pprev);
+	restore_flags(flags);
+}
+
+/* setpgid()setsid()ͨ޸ĽͻỰ */
+void set_pgrp_session(struct task_struct * p, int pgrp, int session)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	hash_out(p, pgrp_next, pgrp_pprev);
+	hash_out(p, session_next, session_pprev);
+	p->pgrp = pgrp;
+	p->session = session;
+	hash_in(p, pgrphash, p->pgrp, pgrp_next, pgrp_pprev);
+	hash_in(p, sesshash, p->session, session_next, session_pprev);
+	restore_flags(flags);
+}
+
+/* ̺ŲܺеĽ̺šŻ߻Ựͬ */
+static int pid_in_use(int pid)
+{
+	struct task_struct * p;
+
+	if (find_task_by_pid(pid))
+		return 1;
+	for (p = pgrphash[pid_hashfn(pid)] ; p ; p = p->pgrp_next)
+		if (p->pgrp == pid)
+			return 1;
+	for (p = sesshash[pid_hashfn(pid)] ; p ; p = p->session_next)
+		if (p->session == pid)
+			return 1;
+	return 0;
+}
+
+/* λͼҵһеλ */
+static int find_free_slot(void)
+{
+	unsigned long word;
+	int i, nr;
+
+	for (i = 0 ; i < (nr_task_slots+31)/32 ; i++) {
+		if ((word = ~task_slot_map[i]) != 0) {
+			__asm__("bsfl %1,%0":"=r" (word):"r" (word));
+			nr = (i << 5) + word;
+			return nr < nr_task_slots ? nr : -1;
 		}
-		//ǵǰûḶ̌ӵǰûĽ
-		if (task[i]->uid == current->uid)
-			this_user_tasks++;
-		if (task[i]->pid == last_pid || task[i]->pgrp == last_pid ||
-		    task[i]->session == last_pid)
-			goto repeat;
 	}
+	return -1;
+}
+
+/*
+ * task[] is full: move it to a table twice the size (the static boot
+ * table goes straight to a page). We may sleep for the pages, so the
+ * caller has to look for a free slot again either way.
+ */
+static int grow_task_table(void)
+{
+	struct task_struct ** new, ** old;
+	unsigned long flags;
+	int size, old_size, order;
+
+	old_size = nr_task_slots;
+	if (old_size >= NR_TASKS)
+		return -EAGAIN;
+	size = old_size << 1;
+	if (size < PAGE_SIZE / sizeof(struct task_struct *))
+		size = PAGE_SIZE / sizeof(struct task_struct *);
+	if (size > NR_TASKS)
+		size = NR_TASKS;
+	for (order = 0 ; (PAGE_SIZE << order) < size * sizeof(struct task_struct *) ; order++)
+		/* nothing */;
+	new = (struct task_struct **) __get_free_pages(GFP_KERNEL, order);
+	if (!new)
+		return -EAGAIN;
+	if (nr_task_slots != old_size) {
+		free_pages((unsigned long) new, order);
+		return 0;
+	}
+	memcpy(new, task, old_size * sizeof(struct task_struct *));
+	memset(new + old_size, 0, (size - old_size) * sizeof(struct task_struct *));
+	save_flags(flags);
+	cli();
+	old = task;
+	task = new;
+	nr_task_slots = size;
+	restore_flags(flags);
+	if (old_size == INIT_TASKS)
+		return 0;
+	for (order = 0 ; (PAGE_SIZE << order) < old_size * sizeof(struct task_struct *) ; order++)
+		/* nothing */;
+	free_pages((unsigned long) old, order);
+	return 0;
+}
+
+//Ѱҿеtask_struct,
+static int find_empty_process(void)
+{
+	struct task_struct * p;
+	int nr, this_user_tasks;
+
+	if (nr_tasks >= NR_TASKS)
+		return -EAGAIN;
 	/*ʣµḺ̌root˻ĽҪ
 	 *˻ԿٵܳMAX_TASKS_PER_USER 
 	 */
-	if (tasks_free <= MIN_TASKS_LEFT_FOR_ROOT ||
-	    this_user_tasks > MAX_TASKS_PER_USER)
-		if (current->uid)
+	if (current->uid) {
+		if (NR_TASKS - nr_tasks <= MIN_TASKS_LEFT_FOR_ROOT)
 			return -EAGAIN;
-	return free_task;
+		/* nobody can be over the limit while there are this few tasks */
+		if (nr_tasks > MAX_TASKS_PER_USER) {
+			this_user_tasks = 0;
+			for_each_task(p)
+				if (p->uid == current->uid)
+					this_user_tasks++;
+			if (this_user_tasks > MAX_TASKS_PER_USER)
+				return -EAGAIN;
+		}
+	}
+	while ((nr = find_free_slot()) < 0)
+		if (grow_task_table())
+			return -EAGAIN;
+	//޶̺ŵֵ
+	do {
+		if ((++last_pid) & 0xffff8000)
+			last_pid=1;
+	} while (pid_in_use(last_pid));
+	return nr;
 }
 
 static struct file * copy_fd(struct file * old_file)
@@ -121,7 +258,25 @@ int dup_mmap(struct task_struct * tsk)
 	return 0;
 }
 
+/*
+ * A vfork() child is done with its parent's memory: it has exec'd or is
+ * on its way out. Let the parent, asleep in sys_fork(), carry on.
+ */
+void vfork_release(struct task_struct * tsk)
+{
+	struct task_struct * p = tsk->p_opptr;
+
+	if (!(tsk->flags & PF_VFORK))
+		return;
+	tsk->flags &= ~PF_VFORK;
+	if (p && (p->flags & PF_VFORKWAIT)) {
+		p->flags &= ~PF_VFORKWAIT;
+		wake_up_process(p);
+	}
+}
+
 #define IS_CLONE (regs.orig_eax == __NR_clone)
+#define IS_VFORK (regs.orig_eax == __NR_vfork)
 #define copy_vm(p) ((clone_flags & COPYVM)?copy_page_tables(p):clone_page_tables(p))
 
 /*
@@ -144,11 +299,14 @@ asmlinkage int sys_fork(struct pt_regs regs)
 	if (nr < 0)
 		goto bad_fork_free;
 	task[nr] = p;
+	set_bit(nr, task_slot_map);
+	nr_tasks++;
 	*p = *current;
+	p->next_run = p->prev_run = NULL;	/* not on the run queue yet */
 	p->did_exec = 0;    /* Ĭûбexecve庯ִ */
 	p->kernel_stack_page = 0;
 	p->state = TASK_UNINTERRUPTIBLE;
-	p->flags &= ~(PF_PTRACED|PF_TRACESYS);
+	p->flags &= ~(PF_PTRACED|PF_TRACESYS|PF_VFORK|PF_VFORKWAIT);
 	p->pid = last_pid;
 	p->swappable = 1;
 	/*ձʱ̺ʹý̵Ľͬһ̣ΪɶҪֿΪ
@@ -157,9 +315,13 @@ asmlinkage int sys_fork(struct pt_regs regs)
 	p->p_cptr = NULL;
 	//task_struct̵ϵ
 	SET_LINKS(p);
+	hash_task(p);
 	p->signal = 0;
 	p->it_real_value = p->it_virt_value = p->it_prof_value = 0;
 	p->it_real_incr = p->it_virt_incr = p->it_prof_incr = 0;
+	init_timer(&p->real_timer);
+	p->real_timer.data = (unsigned long) p;
+	p->real_timer.function = it_real_fn;
     /* ӽ̵Ľ쵼Բ̳ */
 	p->leader = 0;		/* process leadership doesn't inherit */
 	p->utime = p->stime = 0;
@@ -180,7 +342,6 @@ asmlinkage int sys_fork(struct pt_regs regs)
 	p->tss.gs = KERNEL_DS;
 	p->tss.ss0 = KERNEL_DS;
 	p->tss.esp0 = p->kernel_stack_page + PAGE_SIZE;
-	p->tss.tr = _TSS(nr);
 	childregs = ((struct pt_regs *) (p->kernel_stack_page + PAGE_SIZE)) - 1;
 	p->tss.esp = (unsigned long) childregs;
 	p->tss.eip = (unsigned long) ret_from_sys_call;
@@ -195,8 +356,13 @@ asmlinkage int sys_fork(struct pt_regs regs)
 		if (childregs->esp == regs.esp)
 			clone_flags |= COPYVM;
 	}
+	/* the child runs on our memory, stack and all, until it execs or exits */
+	if (IS_VFORK)
+		clone_flags = VFORK | SIGCHLD;
+	if (clone_flags & VFORK)
+		clone_flags &= ~COPYVM;
 	p->exit_signal = clone_flags & CSIGNAL;
-	p->tss.ldt = _LDT(nr);
+	p->tss.ldt = _LDT(0);
 	if (p->ldt) {
 		p->ldt = (struct desc_struct*) vmalloc(LDT_ENTRIES*LDT_ENTRY_SIZE);
 		if (p->ldt != NULL)
@@ -231,17 +397,24 @@ asmlinkage int sys_fork(struct pt_regs regs)
 	if (current->executable)
 		current->executable->i_count++;
 	dup_mmap(p);
-	set_tss_desc(gdt+(nr<<1)+FIRST_TSS_ENTRY,&(p->tss));
-	if (p->ldt)
-		set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY,p->ldt, 512);
-	else
-		set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY,&default_ldt, 1);
 
 	p->counter = current->counter >> 1;
-	p->state = TASK_RUNNING;	/* do this last, just in case */
-	return p->pid;
+	if (clone_flags & VFORK) {
+		p->flags |= PF_VFORK;
+		current->flags |= PF_VFORKWAIT;
+	}
+	wake_up_process(p);	/* do this last, just in case */
+	i = p->pid;		/* the child may be gone by the time we wake */
+	while (current->flags & PF_VFORKWAIT) {
+		current->state = TASK_UNINTERRUPTIBLE;
+		schedule();
+	}
+	return i;
 bad_fork_cleanup:
 	task[nr] = NULL;
+	clear_bit(nr, task_slot_map);
+	nr_tasks--;
+	unhash_task(p);
 	REMOVE_LINKS(p);
 	free_page(p->kernel_stack_page);
 bad_fork_free:
@@ -12,6 +12,7 @@
 #include <linux/errno.h>
 #include <linux/time.h>
 
+#include <asm/system.h>
 #include <asm/segment.h>
 
 static unsigned long tvtojiffies(struct timeval *value)
@@ -28,13 +29,46 @@ static void jiffiestotv(unsigned long jiffies, struct timeval *value)
 	return;
 }
 
+/*
+ * ITIMER_REAL is a kernel timer of its own for every task, so it
+ * expires on time instead of waiting for schedule() to notice.
+ */
+void it_real_fn(unsigned long __data)
+{
+	struct task_struct * p = (struct task_struct *) __data;
+
+	send_sig(SIGALRM, p, 1);
+	if (p->it_real_incr) {
+		p->real_timer.expires = p->it_real_incr;
+		add_timer(&p->real_timer);
+	}
+}
+
+/*
+ * Jiffies left before p's ITIMER_REAL fires, 0 if it isn't armed. A
+ * pending timer holds an absolute time in 'expires'.
+ */
+unsigned long it_real_remain(struct task_struct * p)
+{
+	unsigned long flags, val = 0;
+
+	save_flags(flags);
+	cli();
+	if (p->real_timer.prev) {
+		val = p->real_timer.expires;
+		val = (val > jiffies) ? val - jiffies : 1;
+	}
+	restore_flags(flags);
+	return val;
+}
+
 int _getitimer(int which, struct itimerval *value)
 {
 	register unsigned long val, interval;
 
 	switch (which) {
 	case ITIMER_REAL:
-		val = current->it_real_value;
+		val = it_real_remain(current);
 		interval = current->it_real_incr;
 		break;
 	case ITIMER_VIRTUAL:
@@ -81,13 +115,13 @@ int _setitimer(int which, struct itimerval *value, struct itimerval *ovalue)
 		return k;
 	switch (which) {
 		case ITIMER_REAL:
-			if (j) {
-				j += 1+itimer_ticks;
-				if (j < itimer_next)
-					itimer_next = j;
-			}
+			del_timer(&current->real_timer);
 			current->it_real_value = j;
 			current->it_real_incr = i;
+			if (j) {
+				current->real_timer.expires = j;
+				add_timer(&current->real_timer);
+			}
 			break;
 		case ITIMER_VIRTUAL:
 			if (j)
@@ -39,7 +39,7 @@ static int write_ldt(void * ptr, unsigned long bytecount)
 	struct modify_ldt_ldt_s ldt_info;
 	unsigned long *lp;
 	unsigned long base, limit;
-	int error, i;
+	int error;
 
 	if (bytecount != sizeof(ldt_info))
 		return -EINVAL;
@@ -62,14 +62,10 @@ static int write_ldt(void * ptr, unsigned long bytecount)
 		return -EINVAL;
 
 	if (!current->ldt) {
-		for (i=1 ; i<NR_TASKS ; i++) {
-			if (task[i] == current) {
-				if (!(current->ldt = (struct desc_struct*) vmalloc(LDT_ENTRIES*LDT_ENTRY_SIZE)))
-					return -ENOMEM;
-				set_ldt_desc(gdt+(i<<1)+FIRST_LDT_ENTRY, current->ldt, LDT_ENTRIES);
-				load_ldt(i);
-			}
-		}
+		if (!(current->ldt = (struct desc_struct*) vmalloc(LDT_ENTRIES*LDT_ENTRY_SIZE)))
+			return -ENOMEM;
+		set_task_ldt(current);
+		load_ldt(0);
 	}
 	
 	lp = (unsigned long *) &current->ldt[ldt_info.entry_number];
@@ -35,13 +35,7 @@
 /* change a pid into a task struct. */
 static inline struct task_struct * get_task(int pid)
 {
-	int i;
-
-	for (i = 1; i < NR_TASKS; i++) {
-		if (task[i] != NULL && (task[i]->pid == pid))
-			return task[i];
-	}
-	return NULL;
+	return find_task_by_pid(pid);
 }
 
 /*
@@ -127,6 +121,10 @@ static void put_long(struct task_struct * tsk, unsigned long addr,
 repeat:
 	page = *PAGE_DIR_OFFSET(tsk->tss.cr3,addr);
 	if (page & PAGE_PRESENT) {
+		/* we write behind the page tables' back: no sharing since fork() */
+		if (!(page & PAGE_RW) &&
+		    !(page = unshare_page_table(tsk, PAGE_DIR_OFFSET(tsk->tss.cr3,addr))))
+			return;
 		page &= PAGE_MASK;
 		page += PAGE_PTR(addr);
 		pte = page;
@@ -401,7 +399,7 @@ asmlinkage int sys_ptrace(long request, long pid, long addr, long data)
 			else
 				child->flags &= ~PF_TRACESYS;
 			child->exit_code = data;
-			child->state = TASK_RUNNING;
+			wake_up_process(child);
 	/* make sure the single step bit is not set. */
 			tmp = get_stack_long(child, sizeof(long)*EFL-MAGICNUMBER) & ~TRAP_FLAG;
 			put_stack_long(child, sizeof(long)*EFL-MAGICNUMBER,tmp);
@@ -416,7 +414,7 @@ asmlinkage int sys_ptrace(long request, long pid, long addr, long data)
 		case PTRACE_KILL: {
 			long tmp;
 
-			child->state = TASK_RUNNING;
+			wake_up_process(child);
 			child->exit_code = SIGKILL;
 	/* make sure the single step bit is not set. */
 			tmp = get_stack_long(child, sizeof(long)*EFL-MAGICNUMBER) & ~TRAP_FLAG;
@@ -432,7 +430,7 @@ asmlinkage int sys_ptrace(long request, long pid, long addr, long data)
 			child->flags &= ~PF_TRACESYS;
 			tmp = get_stack_long(child, sizeof(long)*EFL-MAGICNUMBER) | TRAP_FLAG;
 			put_stack_long(child, sizeof(long)*EFL-MAGICNUMBER,tmp);
-			child->state = TASK_RUNNING;
+			wake_up_process(child);
 			child->exit_code = data;
 	/* give it a chance to run. */
 			return 0;
@@ -444,7 +442,7 @@ asmlinkage int sys_ptrace(long request, long pid, long addr, long data)
 			if ((unsigned long) data > NSIG)
 				return -EIO;
 			child->flags &= ~(PF_PTRACED|PF_TRACESYS);
-			child->state = TASK_RUNNING;
+			wake_up_process(child);
 			child->exit_code = data;
 			REMOVE_LINKS(child);
 			child->p_pptr = child->p_opptr;
@@ -27,6 +27,7 @@
 #include <linux/interrupt.h>
 
 #include <asm/system.h>
+#include <asm/bitops.h>
 #include <asm/io.h>
 #include <asm/segment.h>
 
@@ -97,7 +98,10 @@ unsigned long volatile jiffies=0;
 struct task_struct *current = &init_task;
 struct task_struct *last_task_used_math = NULL;
 
-struct task_struct * task[NR_TASKS] = {&init_task, };
+/* task[]ʼʱ̬ıʱfork()ɸı */
+static struct task_struct * init_task_table[INIT_TASKS] = {&init_task, };
+struct task_struct ** task = init_task_table;
+int nr_task_slots = INIT_TASKS;
 
 long user_stack [ PAGE_SIZE>>2 ] ;
 
@@ -147,7 +151,8 @@ sys_wait4, sys_swapoff, sys_sysinfo, sys_ipc, sys_fsync, sys_sigreturn,
 sys_clone, sys_setdomainname, sys_newuname, sys_modify_ldt,
 sys_adjtimex, sys_mprotect, sys_sigprocmask, sys_create_module,
 sys_init_module, sys_delete_module, sys_get_kernel_syms, sys_quotactl,
-sys_getpgid, sys_fchdir, sys_bdflush };
+sys_getpgid, sys_fchdir, sys_bdflush, sys_vfork, sys_epoll_create,
+sys_epoll_ctl, sys_epoll_wait, sys_poll, sys_splice };
 
 /* So we don't have to do any more manual updating.... */
 int NR_syscalls = sizeof(sys_call_table)/sizeof(fn_ptr);
@@ -196,9 +201,163 @@ asmlinkage void math_emulate(long arg)
 
 #endif /* CONFIG_MATH_EMULATION */
 
-unsigned long itimer_ticks = 0;
-unsigned long itimer_next = ~0;
-static unsigned long lost_ticks = 0;
+/*
+ * The run queue. Runnable tasks sit on circular lists indexed by their
+ * counter, with a bitmap of the non-empty levels, so that schedule()
+ * never has to look at a task that can't run. There are two arrays:
+ * 'active' holds the tasks that still have some of their timeslice
+ * left, 'expired' the ones that used it up and have already been
+ * recharged. When the active array runs dry the two are swapped, which
+ * replaces the old "recalculate every counter" loop.
+ *
+ * Sleeping tasks aren't on the run queue, so they miss the recharge:
+ * run_epoch counts the array swaps, and a task that slept through some
+ * of them gets the same (counter >> 1) + priority treatment when it is
+ * woken up. The series converges after a few rounds, so that's bounded
+ * too.
+ *
+ * The idle task (task[0]) is never on the run queue.
+ */
+#define RUNQ_LEVELS	128
+#define RUNQ_WORDS	(RUNQ_LEVELS/32)
+#define RUNQ_MAX_RECHARGE	8
+
+struct run_queue {
+	unsigned long bitmap[RUNQ_WORDS];
+	struct task_struct * queue[RUNQ_LEVELS];
+	int nr_running;
+};
+
+static struct run_queue runq_array[2];
+static struct run_queue * runq_active = runq_array+0;
+static struct run_queue * runq_expired = runq_array+1;
+static unsigned long runq_epoch = 0;
+
+/* all the run queue helpers must be called with interrupts off */
+static inline void enqueue_task(struct task_struct * p, struct run_queue * rq)
+{
+	struct task_struct ** q;
+	int level = p->counter;
+
+	if (level < 0)
+		level = 0;
+	if (level >= RUNQ_LEVELS)
+		level = RUNQ_LEVELS-1;
+	q = rq->queue + level;
+	if (!*q) {
+		p->next_run = p->prev_run = p;
+		*q = p;
+		set_bit(level, rq->bitmap);
+	} else {
+		/* add at the tail: equal counters get round-robin */
+		p->next_run = *q;
+		p->prev_run = (*q)->prev_run;
+		(*q)->prev_run->next_run = p;
+		(*q)->prev_run = p;
+	}
+	p->run_array = rq - runq_array;
+	p->run_level = level;
+	rq->nr_running++;
+}
+
+static inline void dequeue_task(struct task_struct * p)
+{
+	struct run_queue * rq = runq_array + p->run_array;
+	struct task_struct ** q = rq->queue + p->run_level;
+
+	if (p->next_run == p) {
+		*q = NULL;
+		clear_bit(p->run_level, rq->bitmap);
+	} else {
+		p->next_run->prev_run = p->prev_run;
+		p->prev_run->next_run = p->next_run;
+		if (*q == p)
+			*q = p->next_run;
+	}
+	p->next_run = p->prev_run = NULL;
+	rq->nr_running--;
+}
+
+/*
+ * Put a runnable task on the run queue. A task that has used up its
+ * timeslice is recharged right away and goes to the expired array:
+ * it belongs to the next epoch.
+ */
+static inline void add_to_runqueue(struct task_struct * p)
+{
+	long missed = runq_epoch - p->run_epoch;
+
+	if (missed > RUNQ_MAX_RECHARGE)
+		missed = RUNQ_MAX_RECHARGE;
+	while (missed-- > 0)
+		p->counter = (p->counter >> 1) + p->priority;
+	if (p->counter > 0) {
+		p->run_epoch = runq_epoch;
+		enqueue_task(p, runq_active);
+		return;
+	}
+	p->counter = p->priority;
+	p->run_epoch = runq_epoch+1;
+	enqueue_task(p, runq_expired);
+}
+
+/* highest non-empty level of a run queue array, or -1 */
+static inline int runq_highest(struct run_queue * rq)
+{
+	int i;
+	unsigned long word;
+
+	for (i = RUNQ_WORDS-1 ; i >= 0 ; i--) {
+		if ((word = rq->bitmap[i]) != 0) {
+			__asm__("bsrl %1,%0":"=r" (word):"r" (word));
+			return (i << 5) + word;
+		}
+	}
+	return -1;
+}
+
+static inline struct task_struct * pick_next_task(void)
+{
+	struct run_queue * tmp;
+	struct task_struct * p;
+	int level;
+
+	for (;;) {
+		level = runq_highest(runq_active);
+		if (level < 0) {
+			if (!runq_expired->nr_running)
+				return &init_task;
+			tmp = runq_active;
+			runq_active = runq_expired;
+			runq_expired = tmp;
+			runq_epoch++;
+			continue;
+		}
+		p = runq_active->queue[level];
+		if (p->state == TASK_RUNNING)
+			return p;
+		/* somebody changed the state behind our back (ptrace etc) */
+		dequeue_task(p);
+	}
+}
+
+/*
+ * Make a task runnable and put it on the run queue. This is the only
+ * correct way to wake up somebody else: setting p->state directly
+ * is only ok for 'current', which stays on the run queue until it
+ * calls schedule().
+ */
+void wake_up_process(struct task_struct * p)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	p->state = TASK_RUNNING;
+	if (!p->next_run && p != &init_task)
+		add_to_runqueue(p);
+	restore_flags(flags);
+}
 
 /*
  *  'schedule()' is the scheduler function. It's a very simple and nice
@@ -213,104 +372,65 @@ static unsigned long lost_ticks = 0;
  * Djikstra probably hates me.
  */
 
+/*
+ * A task sleeping with a timeout has a timer on the stack of its
+ * schedule() call: this is what it runs when the timeout expires.
+ */
+static void process_timeout(unsigned long __data)
+{
+	struct task_struct * p = (struct task_struct *) __data;
+
+	p->timeout = 0;
+	wake_up_process(p);
+}
+
 /* ̵Ⱥ
  */
 asmlinkage void schedule(void)
 {
-	int c;
-	struct task_struct * p;
+	struct task_struct * prev;
 	struct task_struct * next;
-	unsigned long ticks;
-
-/* check alarm, wake up any interruptible tasks that have got a signal */
+	unsigned long timeout = 0;
+	struct timer_list timer;
 
-	cli();
-	ticks = itimer_ticks;
-	itimer_ticks = 0;
-	itimer_next = ~0;
-	sti();
 	need_resched = 0;
-	p = &init_task;
-	/* ѭǽԵеĽΪ̬
-	 * ȴһνоѡ
-	 * лݽеʱ̷صź 
-	 */
-	for (;;) {
-        /* ֻ֤ɨһȦ */
-		if ((p = p->next_task) == &init_task)
-			goto confuse_gcc1;
-		if (ticks && p->it_real_value) {
-			/* ticksit_real_valueΪ0̷SIGALRMź */
-			if (p->it_real_value <= ticks) {
-				send_sig(SIGALRM, p, 1);
-				if (!p->it_real_incr) {
-					p->it_real_value = 0;
-					goto end_itimer;
-				}
-				/* it_real_incrΪ0ʹit_real_valueֵӵticksΪֹ
-				 */
-				do {
-					p->it_real_value += p->it_real_incr;
-				} while (p->it_real_value <= ticks);
+	cli();
+	prev = current;
+	if (prev != &init_task && prev->state == TASK_INTERRUPTIBLE) {
+		/* a pending signal keeps an interruptible task runnable */
+		if (prev->signal & ~prev->blocked)
+			prev->state = TASK_RUNNING;
+		/* timeoutḶ̌Լtimerʱ */
+		else if ((timeout = prev->timeout) != 0) {
+			if (timeout <= jiffies) {
+				prev->timeout = 0;
+				timeout = 0;
+				prev->state = TASK_RUNNING;
+			} else {
+				init_timer(&timer);
+				timer.expires = timeout - jiffies;
+				timer.data = (unsigned long) prev;
+				timer.function = process_timeout;
+				add_timer(&timer);
 			}
-			/* ʹit_real_valueֵСticks */
-			p->it_real_value -= ticks;
-			if (p->it_real_value < itimer_next)
-				itimer_next = p->it_real_value;
-		}
-end_itimer:
-        /* Ƿǿж״̬ѡȵĳʱǸỵ́
-           * һֲжϵ˯״̬ʱȳ򲻿ɵȸý
-           */
-		if (p->state != TASK_INTERRUPTIBLE)
-			continue;
-        /* ̽յźţý̵״̬Ϊ̬
-           */
-		if (p->signal & ~p->blocked) {
-			p->state = TASK_RUNNING;
-			continue;
-		}
-		/* ˽̱»ѵʱ䣬򽫽̻
-		 * timeoutָú󽫽» 
-		 */
-		if (p->timeout && p->timeout <= jiffies) {
-			p->timeout = 0;
-			p->state = TASK_RUNNING;
 		}
 	}
-confuse_gcc1:
-
-/* this is the scheduler proper: */
-#if 0
-	/* give processes that go to sleep a bit higher priority.. */
-	/* This depends on the values for TASK_XXX */
-	/* This gives smoother scheduling for some things, but */
-	/* can be very unfair under some circumstances, so.. */
- 	if (TASK_UNINTERRUPTIBLE >= (unsigned) current->state &&
-	    current->counter < current->priority*2) {
-		++current->counter;
-	}
-#endif
-	c = -1;
-	next = p = &init_task;
-	/* ѡһʵĽУͨswitch_toл */
-	for (;;) {
-		if ((p = p->next_task) == &init_task)
-			goto confuse_gcc2;
-		/* ֻTASK_RUNNING̬̣Ҷ̬ȼ֮ǰҪ 
-		 */
-		if (p->state == TASK_RUNNING && p->counter > c)
-			c = p->counter, next = p;
-	}
-confuse_gcc2:
-	/* ˴̬ȼcΪ0ʾн̵Ķ̬ȼΪ0 */
-	if (!c) {
-		for_each_task(p)
-			p->counter = (p->counter >> 1) + p->priority;
+	if (prev != &init_task) {
+		/* requeue it according to the counter it has left */
+		if (prev->next_run)
+			dequeue_task(prev);
+		if (prev->state == TASK_RUNNING)
+			add_to_runqueue(prev);
 	}
+	/* жѡ̬ȼߵḶ̌ͨswitch_toл */
+	next = pick_next_task();
+	sti();
 	if(current != next)
 		kstat.context_swtch++; /* ں˽л */
 	switch_to(next);
+	/* back again: the timeout timer may or may not have run */
+	if (timeout)
+		del_timer(&timer);
 	/* Now maybe reload the debug registers */
 	if(current->debugreg[7]){
 		loaddebug(0);
@@ -344,10 +464,13 @@ void wake_up(struct wait_queue **q)
 	if (!q || !(tmp = *q))
 		return;
 	do {
-		if ((p = tmp->task) != NULL) {
+		/* صĵȴ(epoll)ɻصԼô */
+		if (tmp->func)
+			tmp->func(tmp);
+		else if ((p = tmp->task) != NULL) {
 			if ((p->state == TASK_UNINTERRUPTIBLE) ||
 			    (p->state == TASK_INTERRUPTIBLE)) {   /*Ψһwake_up_interruptible*/
-				p->state = TASK_RUNNING;
+				wake_up_process(p);
 				if (p->counter > current->counter)
 					need_resched = 1;
 			}
@@ -371,12 +494,14 @@ void wake_up_interruptible(struct wait_queue **q)
 	if (!q || !(tmp = *q))
 		return;
 	do {
-		if ((p = tmp->task) != NULL) {
+		if (tmp->func)
+			tmp->func(tmp);
+		else if ((p = tmp->task) != NULL) {
 			/* ȴ״̬ΪTASK_INTERRUPTIBLEн״̬ΪTASK_RUNNING
-			 * ȴȳִ
+			 * жеȴȳִ
 			 */
 			if (p->state == TASK_INTERRUPTIBLE) {
-				p->state = TASK_RUNNING;
+				wake_up_process(p);
 				/*p̵ȼڵǰ̵ȼһʱӣµȽ*/
 				if (p->counter > current->counter)
 					need_resched = 1;
@@ -437,66 +562,280 @@ void sleep_on(struct wait_queue **p)
 	__sleep_on(p,TASK_UNINTERRUPTIBLE);
 }
 
-/* next_timerΪںʱӣעnext_timerĲǳɣ
- * £4ʱӽڵ㣬ʱֱΪ1,2,4,5
- * expireʵֵΪ 1,1,2,1ҲǴʱǰexpireĺ
+/*
+ * The timer lists are kept in a cascading timer wheel: tv1 has a slot
+ * for every one of the next 256 ticks, and each of tv2..tv5 covers 64
+ * times the range of the level below it. A timer lives in the slot
+ * of the coarsest level that still resolves its expiry time, and is
+ * moved ("cascaded") down one level whenever the level below wraps
+ * around. add_timer() and del_timer() are O(1) with interrupts off,
+ * and timer_bh() runs all the timers of a slot in one go.
+ *
+ * The callers still pass a relative 'expires' (ticks from now), and
+ * del_timer() still leaves the time that was left in it: the
+ * absolute value is only used while the timer is on the wheel.
  */
-static struct timer_list * next_timer = NULL;
+#define TVN_BITS 6
+#define TVR_BITS 8
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVR_MASK (TVR_SIZE - 1)
+
+struct timer_vec {
+	int index;
+	struct timer_list *vec[TVN_SIZE];
+};
+
+struct timer_vec_root {
+	int index;
+	struct timer_list *vec[TVR_SIZE];
+};
+
+static struct timer_vec tv5 = { 0 };
+static struct timer_vec tv4 = { 0 };
+static struct timer_vec tv3 = { 0 };
+static struct timer_vec tv2 = { 0 };
+static struct timer_vec_root tv1 = { 0 };
+
+static struct timer_vec * const tvecs[] = {
+	(struct timer_vec *)&tv1, &tv2, &tv3, &tv4, &tv5
+};
+
+#define NOOF_TVECS (sizeof(tvecs) / sizeof(tvecs[0]))
+
+/* the wheel has run all the timers up to (but not including) this */
+static unsigned long timer_jiffies = 0;
 
-/* ʱӵб */
+/*
+ * The slot lists are NULL-terminated, and the 'prev' of the first
+ * timer points at the slot itself: 'next' is the first member of
+ * struct timer_list, so the slot works as a fake list head. A timer
+ * that isn't on the wheel has prev == NULL.
+ */
+static inline void insert_timer(struct timer_list *timer,
+				struct timer_list **vec, int idx)
+{
+	if ((timer->next = vec[idx]) != NULL)
+		vec[idx]->prev = timer;
+	vec[idx] = timer;
+	timer->prev = (struct timer_list *) &vec[idx];
+}
+
+static inline void internal_add_timer(struct timer_list *timer)
+{
+	unsigned long expires = timer->expires;
+	unsigned long idx = expires - timer_jiffies;
+
+	if (idx < TVR_SIZE) {
+		insert_timer(timer, tv1.vec, expires & TVR_MASK);
+	} else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
+		insert_timer(timer, tv2.vec, (expires >> TVR_BITS) & TVN_MASK);
+	} else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
+		insert_timer(timer, tv3.vec,
+			(expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK);
+	} else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
+		insert_timer(timer, tv4.vec,
+			(expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK);
+	} else if ((long) idx < 0) {
+		/* already due: timer_bh() hasn't caught up with jiffies yet */
+		insert_timer(timer, tv1.vec, tv1.index);
+	} else {
+		insert_timer(timer, tv5.vec,
+			(expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK);
+	}
+}
+
+static inline int detach_timer(struct timer_list *timer)
+{
+	struct timer_list *prev = timer->prev;
+
+	if (prev) {
+		struct timer_list *next = timer->next;
+		prev->next = next;
+		if (next)
+			next->prev = prev;
+		timer->next = timer->prev = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+/* ʱӵʱֵ */
 void add_timer(struct timer_list * timer)
 {
 	unsigned long flags;
-	struct timer_list ** p;
 
 	if (!timer)
 		return;
-	timer->next = NULL;
-	p = &next_timer;
 	save_flags(flags);
 	cli();
-	while (*p) {
-		/* timerǰexpiresСδС */
-		if ((*p)->expires > timer->expires) {
-			(*p)->expires -= timer->expires;
-			timer->next = *p;
-			break;
-		}
-		/* ûҵλãexpiresһֱС */
-		timer->expires -= (*p)->expires;
-		p = &(*p)->next;
+	if (timer->prev) {
+		printk("add_timer: timer %p already pending\n", timer);
+		restore_flags(flags);
+		return;
 	}
-	*p = timer;
+	if (!timer->expires)
+		mark_bh(TIMER_BH);
+	/* the wheel couldn't tell a "negative" timeout from one in the past */
+	if (timer->expires > LONG_MAX)
+		timer->expires = LONG_MAX;
+	timer->expires += jiffies;
+	internal_add_timer(timer);
 	restore_flags(flags);
 }
 
-/* ɾʱ */
+/* ʱɾʱӣexpiresʣʱ */
 int del_timer(struct timer_list * timer)
 {
 	unsigned long flags;
-	unsigned long expires = 0;
-	struct timer_list **p;
+	int ret;
 
-	p = &next_timer;
 	save_flags(flags);
 	cli();
-	/* ɨnext_timerΪ׵ */
-	while (*p) {
-		/* netxt_timerҵýڵ */
-		if (*p == timer) {
-			/* رע仰ʹɾtimerڵ */
-			if ((*p = timer->next) != NULL)
-				(*p)->expires += timer->expires;
-			timer->expires += expires;
-			restore_flags(flags);
-			return 1;
-		}
-		expires += (*p)->expires;
-		p = &(*p)->next;
+	ret = detach_timer(timer);
+	if (ret) {
+		if (timer->expires > jiffies)
+			timer->expires -= jiffies;
+		else
+			timer->expires = 0;
 	}
 	restore_flags(flags);
-	return 0;
+	return ret;
+}
+
+static inline void cascade_timers(struct timer_vec *tv)
+{
+	/* cascade all the timers from tv up one level */
+	struct timer_list *timer;
+
+	timer = tv->vec[tv->index];
+	/*
+	 * We are removing _all_ timers from the list, so we don't have to
+	 * detach them individually, just clear the list afterwards.
+	 */
+	while (timer) {
+		struct timer_list *tmp = timer;
+		timer = timer->next;
+		internal_add_timer(tmp);
+	}
+	tv->vec[tv->index] = NULL;
+	tv->index = (tv->index + 1) & TVN_MASK;
+}
+
+/* ʱеڵʱӣÿڵslotһδ */
+static inline void run_timer_list(void)
+{
+	struct timer_list *timer;
+	void (*fn)(unsigned long);
+	unsigned long data;
+
+	cli();
+	while ((long)(jiffies - timer_jiffies) >= 0) {
+		if (!tv1.index) {
+			int n = 1;
+			do {
+				cascade_timers(tvecs[n]);
+			} while (tvecs[n]->index == 1 && ++n < NOOF_TVECS);
+		}
+		while ((timer = tv1.vec[tv1.index]) != NULL) {
+			fn = timer->function;
+			data = timer->data;
+			detach_timer(timer);
+			timer->expires = 0;
+			sti();
+			fn(data);
+			cli();
+		}
+		++timer_jiffies;
+		tv1.index = (tv1.index + 1) & TVR_MASK;
+	}
+	sti();
+}
+
+/*
+ * Called from do_timer() with interrupts off: does timer_bh() have
+ * anything to do this tick? It has if the current slot isn't empty,
+ * or if tv1 wraps around and the upper levels need to be cascaded.
+ */
+static inline int timer_wheel_due(void)
+{
+	return tv1.vec[jiffies & TVR_MASK] || !(jiffies & TVR_MASK);
+}
+
+#ifdef CONFIG_TIMER_STRESS
+/*
+ * Boot-time stress test of the timer wheel: add and delete a few
+ * thousand timers spread over all the levels, and report how long
+ * add_timer() and del_timer() keep interrupts disabled. The time is
+ * read from the 8253 counter, so it has a resolution of ~0.84us.
+ */
+#define STRESS_TIMERS	4096
+
+static struct timer_list stress_timer[STRESS_TIMERS];
+static unsigned long stress_fired = 0;
+
+static void stress_timer_fn(unsigned long data)
+{
+	stress_fired++;
+}
+
+/* read the 8253 channel 0 counter: it counts down from LATCH-1 to 0 */
+static inline unsigned long pit_count(void)
+{
+	unsigned long count;
+
+	outb_p(0x00, 0x43);	/* latch the count */
+	count = inb_p(0x40);
+	count |= inb(0x40) << 8;
+	return count;
+}
+
+#define PIT_TO_USEC(x)	((x) * tick / LATCH)
+
+void timer_stress(void)
+{
+	unsigned long seed = 1;
+	unsigned long start, t, flags;
+	unsigned long add_max = 0, add_sum = 0, del_max = 0, del_sum = 0;
+	int i, j;
+
+	save_flags(flags);
+	for (i = 0 ; i < STRESS_TIMERS ; i++) {
+		seed = seed * 1103515245 + 12345;
+		stress_timer[i].next = stress_timer[i].prev = NULL;
+		stress_timer[i].function = stress_timer_fn;
+		stress_timer[i].data = i;
+		/* spread the expiry times over the wheel levels */
+		stress_timer[i].expires = 1 + ((seed >> 8) >> ((seed >> 4) & 15));
+		cli();
+		start = pit_count();
+		add_timer(stress_timer+i);
+		t = (start + LATCH - pit_count()) % LATCH;
+		restore_flags(flags);
+		add_sum += t;
+		if (t > add_max)
+			add_max = t;
+	}
+	for (i = 0 ; i < STRESS_TIMERS ; i++) {
+		j = (i * 2654435761UL) % STRESS_TIMERS;
+		cli();
+		start = pit_count();
+		del_timer(stress_timer+j);
+		t = (start + LATCH - pit_count()) % LATCH;
+		restore_flags(flags);
+		del_sum += t;
+		if (t > del_max)
+			del_max = t;
+	}
+	printk("Timer stress: %d timers, %lu fired early\n",
+		STRESS_TIMERS, stress_fired);
+	printk("  add_timer: avg %luus max %luus with interrupts off\n",
+		PIT_TO_USEC(add_sum / STRESS_TIMERS), PIT_TO_USEC(add_max));
+	printk("  del_timer: avg %luus max %luus with interrupts off\n",
+		PIT_TO_USEC(del_sum / STRESS_TIMERS), PIT_TO_USEC(del_max));
 }
+#endif /* CONFIG_TIMER_STRESS */
 
 unsigned long timer_active = 0;
 struct timer_struct timer_table[32];
@@ -618,19 +957,10 @@ static void timer_bh(void * unused)
 	unsigned long mask;
 	struct timer_struct *tp;
 
-	cli();
-	/* ѭʱбеtimer,ͬʱexpiresΪ0timer */
-	while (next_timer && next_timer->expires == 0) {
-		void (*fn)(unsigned long) = next_timer->function;
-		unsigned long data = next_timer->data;
-		next_timer = next_timer->next;
-		sti();
-		fn(data);
-		cli();
-	}
-	sti();
+	/* ʱѾڵtimer */
+	run_timer_list();
 
-	/* עtimer_tablenext_timer */
+	/* עtimer_tableʱֵ */
 	for (mask = 1, tp = timer_table+0 ; mask ; tp++,mask += mask) {
 		if (mask > timer_active)
 			break;
@@ -754,21 +1084,9 @@ static void do_timer(struct pt_regs * regs)
 		mark_bh(TIMER_BH);
 	}
 	cli();
-	itimer_ticks++;
-	if (itimer_ticks > itimer_next)
-		need_resched = 1;
-	/* ʱʼnext_timerб */
-	if (next_timer) {
-		if (next_timer->expires) {
-			/* next_timerexpiresСΪʲôֻеһС? */
-			next_timer->expires--;
-			if (!next_timer->expires)
-				mark_bh(TIMER_BH);
-		} else {
-			lost_ticks++;
-			mark_bh(TIMER_BH);
-		}
-	}
+	/* ʱеڵtimerʱҪ°벿 */
+	if (timer_wheel_due())
+		mark_bh(TIMER_BH);
 	sti();
 }
 
@@ -867,7 +1185,7 @@ void show_state(void)
 
 	printk("                         free                        sibling\n");
 	printk("  task             PC    stack   pid father child younger older\n");
-	for (i=0 ; i<NR_TASKS ; i++)
+	for (i=0 ; i<nr_task_slots ; i++)
 		if (task[i])
 			show_task(i,task[i]);
 }
@@ -875,24 +1193,15 @@ void show_state(void)
 /* ȵĳʼ */
 void sched_init(void)
 {
-	int i;
-	struct desc_struct * p;
-
 	/* ʼʱӵ°벿 */
 	bh_base[TIMER_BH].routine = timer_bh;
+	init_task.real_timer.data = (unsigned long) &init_task;
+	init_task.real_timer.function = it_real_fn;
 	if (sizeof(struct sigaction) != 16)
 		panic("Struct sigaction MUST be 16 bytes");
 	set_tss_desc(gdt+FIRST_TSS_ENTRY,&init_task.tss);
 	set_ldt_desc(gdt+FIRST_LDT_ENTRY,&default_ldt,1);
 	set_system_gate(0x80,&system_call);
-	p = gdt+2+FIRST_TSS_ENTRY;
-	for(i=1 ; i<NR_TASKS ; i++) {
-		task[i] = NULL;
-		p->a=p->b=0;
-		p++;
-		p->a=p->b=0;
-		p++;
-	}
 /* Clear NT, so that we won't have troubles with that later on */
 	__asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
 	load_TR(0);
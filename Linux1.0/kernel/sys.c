@@ -149,6 +149,8 @@ static void mark_screen_rdonly(struct task_struct * tsk)
 
 	if ((tmp = tsk->tss.cr3) != 0) {
 		tmp = *(unsigned long *) tmp;
+		if ((tmp & PAGE_PRESENT) && !(tmp & PAGE_RW))
+			tmp = unshare_page_table(tsk, (unsigned long *) tsk->tss.cr3);
 		if (tmp & PAGE_PRESENT) {
 			tmp &= PAGE_MASK;
 			pg_table = (0xA0000 >> PAGE_SHIFT) + (unsigned long *) tmp;
@@ -496,13 +498,9 @@ asmlinkage int sys_setpgid(pid_t pid, pid_t pgid)
 		pgid = pid;
 	if (pgid < 0)
 		return -EINVAL;
-	for_each_task(p) {
-		if (p->pid == pid)
-			goto found_task;
-	}
-	return -ESRCH;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
 
-found_task:
 	/* ̵ĸ̻ߴpĽǵǰ */
 	if (p->p_pptr == current || p->p_opptr == current) {
 		/* ҵḺ̌͵ǰĽͬһỰ */
@@ -518,7 +516,7 @@ found_task:
 		return -EPERM;
 	if (pgid != pid) {
 		struct task_struct * tmp;
-		for_each_task (tmp) {
+		for (tmp = pgrphash[pid_hashfn(pgid)] ; tmp ; tmp = tmp->pgrp_next) {
             /* ڽΪpgidҺ͵ǰͬһỰڵĽ */
 			if (tmp->pgrp == pgid &&
 			 tmp->session == current->session)
@@ -528,7 +526,7 @@ found_task:
 	}
 
 ok_pgid:
-	p->pgrp = pgid;
+	set_pgrp_session(p, pgid, p->session);
 	return 0;
 }
 
@@ -540,10 +538,8 @@ asmlinkage int sys_getpgid(pid_t pid)
 	/* 0򷵻صǰ̵id */
 	if (!pid)
 		return current->pgrp;
-	for_each_task(p) {
-		if (p->pid == pid)
-			return p->pgrp;
-	}
+	if ((p = find_task_by_pid(pid)) != NULL)
+		return p->pgrp;
 	/* 򷵻ûĽ*/
 	return -ESRCH;
 }
@@ -564,7 +560,7 @@ asmlinkage int sys_setsid(void)
     /* õǰΪ쵼 */
 	current->leader = 1;
     /* ͬʱµĻỰidµĽidΪǰ̵id */
-	current->session = current->pgrp = current->pid;
+	set_pgrp_session(current, current->pid, current->pid);
     /* ûпն */
 	current->tty = -1;
 	return current->pgrp;
@@ -101,7 +101,7 @@ asmlinkage void alignment_check(void);
 	printk("ds: %04x   es: %04x   fs: %04x   gs: %04x   ss: %04x\n",
 		regs->ds, regs->es, regs->fs, regs->gs, ss);
 	store_TR(i);
-	printk("Pid: %d, process nr: %d (%s)\nStack: ", current->pid, 0xffff & i, current->comm);
+	printk("Pid: %d, TSS #%d (%s)\nStack: ", current->pid, 0xffff & i, current->comm);
 	for(i=0;i<5;i++)
 		printk("%08lx ", get_seg_long(ss,(i+(unsigned long *)esp)));
 	printk("\nCode: ");
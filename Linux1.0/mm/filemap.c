@@ -0,0 +1,449 @@
+/*
+ *  linux/mm/filemap.c
+ *
+ * The page cache. Regular file data is kept in whole pages, hashed on
+ * (inode, page aligned offset), so that read() on the filesystems that
+ * can bmap() and page faults on generic file mmaps find the same
+ * physical page instead of each copying the blocks out of the buffer
+ * cache again. The cache holds one reference to each of its pages;
+ * mappings take their own, and shrink_page_cache() only lets go of
+ * pages nobody else is using.
+ *
+ * Writes still go through the buffer cache: the filesystems call
+ * update_page_cache() with the data they just put into a buffer, and
+ * truncate_page_cache() drops what lies beyond a new end of file.
+ * Entries are keyed on the in-core inode, so clear_inode() throws away
+ * all pages of an inode before the slot can be reused for another file.
+ *
+ * Each open file keeps its own readahead window. A read() that starts
+ * where the previous one ended is taken as part of a stream: the window
+ * doubles, up to MAX_READAHEAD pages, and the blocks of the pages in it
+ * are queued with READA once the reader gets within half a window of
+ * where the last readahead stopped. A read anywhere else halves the
+ * window, so an occasional seek doesn't lose a stream but random access
+ * soon stops reading ahead altogether.
+ */
+
+#include <linux/config.h>
+#include <linux/errno.h>
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/stat.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/malloc.h>
+#include <linux/pagemap.h>
+#include <linux/locks.h>
+
+#include <asm/system.h>
+#include <asm/segment.h>
+
+struct page_cache {
+	struct inode * inode;
+	unsigned long offset;		/* page aligned offset in the file */
+	unsigned long page;		/* the data */
+	struct page_cache * next_hash, * prev_hash;
+	struct page_cache * next_inode, * prev_inode;
+	struct page_cache * next_lru, * prev_lru;
+};
+
+#define PAGE_HASH_SIZE 509
+#define page_hashfn(inode,offset) \
+	((((unsigned long) (inode) >> 5) ^ ((offset) >> PAGE_SHIFT)) % PAGE_HASH_SIZE)
+#define page_hash(inode,offset) page_hash_table[page_hashfn(inode,offset)]
+
+static struct page_cache * page_hash_table[PAGE_HASH_SIZE];
+static struct page_cache * page_lru = NULL;	/* least recently used first */
+static struct kmem_cache * page_cachep = NULL;
+
+unsigned long page_cache_size = 0;
+static unsigned long page_cache_hits = 0;
+static unsigned long page_cache_misses = 0;
+
+#define MIN_READAHEAD	2	/* pages */
+#define MAX_READAHEAD	16
+
+unsigned long reada_pages = 0;		/* pages read ahead */
+unsigned long reada_blocks = 0;		/* blocks queued for them */
+unsigned long reada_hits = 0;		/* of those, later read by fill_page() */
+unsigned long reada_wasted = 0;		/* thrown away unused, see buffer.c */
+
+static struct page_cache * find_page(struct inode * inode, unsigned long offset)
+{
+	struct page_cache * pc;
+
+	for (pc = page_hash(inode, offset) ; pc ; pc = pc->next_hash)
+		if (pc->inode == inode && pc->offset == offset)
+			return pc;
+	return NULL;
+}
+
+static inline void remove_from_lru(struct page_cache * pc)
+{
+	if (pc->next_lru == pc)
+		page_lru = NULL;
+	else {
+		pc->next_lru->prev_lru = pc->prev_lru;
+		pc->prev_lru->next_lru = pc->next_lru;
+		if (page_lru == pc)
+			page_lru = pc->next_lru;
+	}
+}
+
+static inline void add_to_lru(struct page_cache * pc)
+{
+	if (!page_lru) {
+		page_lru = pc->next_lru = pc->prev_lru = pc;
+		return;
+	}
+	pc->next_lru = page_lru;
+	pc->prev_lru = page_lru->prev_lru;
+	page_lru->prev_lru->next_lru = pc;
+	page_lru->prev_lru = pc;
+}
+
+static void add_page(struct page_cache * pc)
+{
+	struct page_cache ** p = &page_hash(pc->inode, pc->offset);
+
+	pc->prev_hash = NULL;
+	if ((pc->next_hash = *p) != NULL)
+		pc->next_hash->prev_hash = pc;
+	*p = pc;
+	pc->prev_inode = NULL;
+	if ((pc->next_inode = pc->inode->i_pages) != NULL)
+		pc->next_inode->prev_inode = pc;
+	pc->inode->i_pages = pc;
+	add_to_lru(pc);
+	page_cache_size++;
+}
+
+/* Unlink the entry and drop the cache's reference to its page */
+static void remove_page(struct page_cache * pc)
+{
+	if (pc->next_hash)
+		pc->next_hash->prev_hash = pc->prev_hash;
+	if (pc->prev_hash)
+		pc->prev_hash->next_hash = pc->next_hash;
+	else
+		page_hash(pc->inode, pc->offset) = pc->next_hash;
+	if (pc->next_inode)
+		pc->next_inode->prev_inode = pc->prev_inode;
+	if (pc->prev_inode)
+		pc->prev_inode->next_inode = pc->next_inode;
+	else
+		pc->inode->i_pages = pc->next_inode;
+	remove_from_lru(pc);
+	page_cache_size--;
+	free_page(pc->page);
+	kmem_cache_free(page_cachep, pc);
+}
+
+#define PAGE_BLOCKS (PAGE_SIZE/512)
+
+/*
+ * Read the blocks backing one page of the file into "page". Holes, and
+ * blocks past the end of the file, read as zeroes. Nothing is copied
+ * until every block is in, and the buffers are handed back still held
+ * in bh[]: the caller gets the page into the cache before releasing
+ * them, so there is no point at which we can sleep between copying the
+ * data and a write to it finding the page through update_page_cache().
+ */
+static int fill_page(struct inode * inode, unsigned long offset,
+	unsigned long page, struct buffer_head * bh[])
+{
+	struct buffer_head * bhreq[PAGE_BLOCKS];
+	int i, n, nreq, block, size = inode->i_sb->s_blocksize;
+	int error = 0;
+
+	block = offset >> inode->i_sb->s_blocksize_bits;
+	n = PAGE_SIZE / size;
+	for (i = 0, nreq = 0 ; i < n ; i++) {
+		int nr = bmap(inode, block + i);
+
+		bh[i] = nr ? getblk(inode->i_dev, nr, size) : NULL;
+		if (bh[i] && !bh[i]->b_uptodate)
+			bhreq[nreq++] = bh[i];
+	}
+	if (nreq)
+		ll_rw_block(READ, nreq, bhreq);
+	for (i = 0 ; i < n ; i++) {
+		if (!bh[i])
+			continue;
+		if (bh[i]->b_reada) {
+			if (bh[i]->b_uptodate || bh[i]->b_lock)
+				reada_hits++;
+			bh[i]->b_reada = 0;
+		}
+		wait_on_buffer(bh[i]);
+	}
+	for (i = 0 ; i < n ; i++) {
+		if (!bh[i])
+			continue;
+		if (bh[i]->b_uptodate)
+			memcpy((char *) page + i*size, bh[i]->b_data, size);
+		else
+			error = -EIO;
+	}
+	return error;
+}
+
+static void release_blocks(struct buffer_head * bh[], int n)
+{
+	while (n-- > 0)
+		brelse(bh[n]);
+}
+
+/*
+ * Get the page of the file at "offset" (page aligned) into *page, with a
+ * reference held for the caller, reading it in on a miss. Returns 1 if
+ * it was cached already and 0 if it had to be read. Returns -ENOMEM with
+ * *page == 0 if no page could be had, and -EIO on a read error, in which
+ * case *page is still valid but is not cached.
+ */
+int page_cache_read(struct inode * inode, unsigned long offset, unsigned long * page)
+{
+	struct page_cache * pc;
+	struct buffer_head * bh[PAGE_BLOCKS];
+	unsigned long new_page;
+	int error, n = PAGE_SIZE / inode->i_sb->s_blocksize;
+
+repeat:
+	*page = 0;
+	pc = find_page(inode, offset);
+	if (pc) {
+		page_cache_hits++;
+		remove_from_lru(pc);
+		add_to_lru(pc);
+		mem_map[MAP_NR(pc->page)]++;
+		*page = pc->page;
+		return 1;
+	}
+	new_page = get_free_page(GFP_KERNEL);
+	if (!new_page)
+		return -ENOMEM;
+	pc = (struct page_cache *) kmem_cache_alloc(page_cachep, GFP_KERNEL);
+	/* allocating may have slept: somebody else could have read it in */
+	if (find_page(inode, offset)) {
+		if (pc)
+			kmem_cache_free(page_cachep, pc);
+		free_page(new_page);
+		goto repeat;
+	}
+	page_cache_misses++;
+	error = fill_page(inode, offset, new_page, bh);
+	*page = new_page;
+	if (error || !pc || find_page(inode, offset)) {
+		release_blocks(bh, n);
+		if (pc)
+			kmem_cache_free(page_cachep, pc);
+		return error;
+	}
+	pc->inode = inode;
+	pc->offset = offset;
+	pc->page = new_page;
+	add_page(pc);
+	mem_map[MAP_NR(new_page)]++;
+	release_blocks(bh, n);
+	return 0;
+}
+
+/*
+ * The filesystem has just copied "count" bytes at file position "pos"
+ * from "data" (kernel memory) into a buffer: do the same to any cached
+ * page covering that range.
+ */
+void update_page_cache(struct inode * inode, unsigned long pos,
+	const char * data, int count)
+{
+	struct page_cache * pc;
+	unsigned long offset;
+	int len;
+
+	if (!inode->i_pages)
+		return;
+	while (count > 0) {
+		offset = pos & ~PAGE_MASK;
+		len = PAGE_SIZE - offset;
+		if (len > count)
+			len = count;
+		pc = find_page(inode, pos & PAGE_MASK);
+		if (pc)
+			memcpy((char *) pc->page + offset, data, len);
+		pos += len;
+		data += len;
+		count -= len;
+	}
+}
+
+/*
+ * Drop the cached pages that lie wholly past "size" and clear the tail
+ * of the one it ends in, so that extending the file again reads zeroes.
+ */
+void truncate_page_cache(struct inode * inode, unsigned long size)
+{
+	struct page_cache * pc, * next;
+	unsigned long offset;
+
+	for (pc = inode->i_pages ; pc ; pc = next) {
+		next = pc->next_inode;
+		if (pc->offset >= size) {
+			remove_page(pc);
+			continue;
+		}
+		offset = size - pc->offset;
+		if (offset < PAGE_SIZE)
+			memset((char *) pc->page + offset, 0, PAGE_SIZE - offset);
+	}
+}
+
+/*
+ * Give a page back to the free pool: the oldest cached page that isn't
+ * also mapped by a process. Pages still in use go to the back of the lru.
+ */
+int shrink_page_cache(unsigned int priority)
+{
+	struct page_cache * pc;
+	unsigned long i;
+
+	i = (page_cache_size >> priority) + 1;
+	while (i-- > 0 && (pc = page_lru) != NULL) {
+		reclaim_stat[RECLAIM_PAGE_CACHE].scan++;
+		if (mem_map[MAP_NR(pc->page)] == 1) {
+			remove_page(pc);
+			return 1;
+		}
+		page_lru = pc->next_lru;
+	}
+	return 0;
+}
+
+/*
+ * Start reading the blocks of the page at "offset" without waiting for
+ * them. Nothing is done if the page is cached already; blocks that are
+ * in the buffer cache or on their way there are left alone.
+ */
+static void readahead_page(struct inode * inode, unsigned long offset)
+{
+	struct buffer_head * bh, * bhreq[PAGE_BLOCKS];
+	int i, n, nreq, block, size = inode->i_sb->s_blocksize;
+
+	if (find_page(inode, offset))
+		return;
+	block = offset >> inode->i_sb->s_blocksize_bits;
+	n = PAGE_SIZE / size;
+	for (i = 0, nreq = 0 ; i < n ; i++) {
+		int nr = bmap(inode, block + i);
+
+		if (!nr)
+			continue;
+		bh = getblk(inode->i_dev, nr, size);
+		if (bh->b_uptodate || bh->b_lock) {
+			brelse(bh);
+			continue;
+		}
+		bh->b_reada = 1;
+		bhreq[nreq++] = bh;
+	}
+	if (!nreq)
+		return;
+	ll_rw_block(READA, nreq, bhreq);
+	release_blocks(bhreq, nreq);
+	reada_pages++;
+	reada_blocks += nreq;
+}
+
+/*
+ * A sequential read() just ended at "pos": if the reader has caught up
+ * with the second half of the window, open it wider and read ahead up
+ * to its new end.
+ */
+static void file_readahead(struct inode * inode, struct file * filp, unsigned long pos)
+{
+	unsigned long start, end, offset;
+
+	start = PAGE_ALIGN(pos);
+	if (filp->f_raend < start)
+		filp->f_raend = start;
+	if (filp->f_rawin && filp->f_raend - start > (filp->f_rawin << PAGE_SHIFT) / 2)
+		return;
+	if (!filp->f_rawin)
+		filp->f_rawin = MIN_READAHEAD;
+	else if (filp->f_rawin < MAX_READAHEAD)
+		filp->f_rawin <<= 1;
+	end = start + (filp->f_rawin << PAGE_SHIFT);
+	for (offset = filp->f_raend ; offset < end && offset < inode->i_size ; offset += PAGE_SIZE)
+		readahead_page(inode, offset);
+	filp->f_raend = offset;
+}
+
+/*
+ * read() for filesystems that can bmap() their files: everything goes
+ * through the page cache.
+ */
+int generic_file_read(struct inode * inode, struct file * filp, char * buf, int count)
+{
+	unsigned long pos, page;
+	int offset, nr, read = 0, error = 0;
+	int sequential;
+
+	pos = filp->f_pos;
+	if (pos >= inode->i_size || count <= 0)
+		return 0;
+	sequential = (pos == filp->f_ralast);
+	if (!sequential) {
+		filp->f_rawin >>= 1;
+		filp->f_raend = 0;
+	}
+	if (count > inode->i_size - pos)
+		count = inode->i_size - pos;
+	while (count > 0) {
+		offset = pos & ~PAGE_MASK;
+		nr = PAGE_SIZE - offset;
+		if (nr > count)
+			nr = count;
+		error = page_cache_read(inode, pos & PAGE_MASK, &page);
+		if (page) {
+			if (error >= 0)
+				memcpy_tofs(buf, (char *) page + offset, nr);
+			free_page(page);
+		}
+		if (error < 0)
+			break;
+		buf += nr;
+		pos += nr;
+		read += nr;
+		count -= nr;
+	}
+	filp->f_pos = pos;
+	filp->f_ralast = pos;
+	if (sequential && error >= 0 && read_ahead[MAJOR(inode->i_dev)])
+		file_readahead(inode, filp, pos);
+	if (!IS_RDONLY(inode)) {
+		inode->i_atime = CURRENT_TIME;
+		inode->i_dirt = 1;
+	}
+	return read ? read : (error < 0 ? error : 0);
+}
+
+/* The page cache lines of /proc/meminfo and show_mem() */
+int get_page_cache_info(char * buffer)
+{
+	return sprintf(buffer, "Cached: %8lu (%lu hits, %lu misses)\n"
+		"Readahead: %lu pages, %lu blocks, %lu hits, %lu wasted\n",
+		page_cache_size << PAGE_SHIFT, page_cache_hits, page_cache_misses,
+		reada_pages, reada_blocks, reada_hits, reada_wasted);
+}
+
+void page_cache_init(void)
+{
+	int i;
+
+	for (i = 0 ; i < PAGE_HASH_SIZE ; i++)
+		page_hash_table[i] = NULL;
+	page_cachep = kmem_cache_create("page_cache", sizeof(struct page_cache),
+		0, 0, NULL);
+	if (!page_cachep)
+		panic("Unable to create the page cache");
+}
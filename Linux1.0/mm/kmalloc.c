@@ -8,6 +8,7 @@
  */
 
 #include <linux/mm.h>
+#include <linux/malloc.h>
 #include <asm/system.h>
 #include <linux/delay.h>
 
@@ -17,7 +18,7 @@
    I want this number to be increased in the near future:
         loadable device drivers should use this function to get memory */
 
-#define MAX_KMALLOC_K 4
+#define MAX_KMALLOC_K ((PAGE_SIZE<<(NR_MEM_LISTS-1))/1024)
 
 
 /* This defines how many times we should try to allocate a free page before
@@ -78,6 +79,53 @@ struct page_descriptor {
 #define PAGE_DESC(p) ((struct page_descriptor *)(((unsigned long)(p)) & PAGE_MASK))
 
 
+/*
+ * Object caches.
+ *
+ * A cache hands out objects of one size. Every page it owns starts with a
+ * slab descriptor, followed by a one-byte "next free" index per object and
+ * then the objects themselves. Keeping the free chain out of the objects
+ * means whatever the constructor set up survives a free/alloc cycle.
+ * Pages with free objects are on the cache's partial list, completely
+ * unused ones on its free list; full pages are on no list at all.
+ */
+struct kmem_slab {
+	struct kmem_slab *next;
+	struct kmem_slab *prev;
+	int magic;		/* same place as page_descriptor.order */
+	struct kmem_cache *cache;
+	unsigned short inuse;
+	unsigned char firstfree;
+	unsigned char bufctl[0];
+};
+
+struct kmem_cache {
+	struct kmem_cache *next;	/* all caches, for /proc/slabinfo */
+	const char *name;
+	int size;			/* object size, rounded to the alignment */
+	int offset;			/* of the first object within a page */
+	int objs;			/* objects per page */
+	int flags;
+	void (*ctor)(void *);
+	struct kmem_slab *partial;
+	struct kmem_slab *free;
+
+	int npages;
+	int nfreepages;
+	int nactive;			/* objects handed out */
+	int nallocs;
+	int nfrees;
+};
+
+#define KMEM_SLAB_MAGIC	0x51ab51ab
+#define KMEM_END	0xff		/* end of a free chain */
+#define KMEM_KEEP_FREE	1		/* unused pages kept per cache */
+
+#define SLAB_DESC(p) ((struct kmem_slab *)(((unsigned long)(p)) & PAGE_MASK))
+
+static struct kmem_cache *kmem_cache_chain = NULL;
+
+
 /*
  * A size descriptor describes a specific class of malloc sizes.
  * Each class of sizes has its own freelist.
@@ -91,6 +139,7 @@ struct size_descriptor {
 	int nfrees;
 	int nbytesmalloced;                 /*ʵʷֽ*/
 	int npages;							/*ʹ˶ҳ*/
+	unsigned long gfporder;				/* each area is 2^gfporder pages */
 };
 
 /* kmallocڴԭһҳ4KBΪλһҳȫͬСsize
@@ -102,20 +151,26 @@ struct size_descriptor {
  */
 
 struct size_descriptor sizes[] = { 
-	{ NULL,  32,127, 0,0,0,0 },
-	{ NULL,  64, 63, 0,0,0,0 },
-	{ NULL, 128, 31, 0,0,0,0 },
-	{ NULL, 252, 16, 0,0,0,0 },
-	{ NULL, 508,  8, 0,0,0,0 },
-	{ NULL,1020,  4, 0,0,0,0 },
-	{ NULL,2040,  2, 0,0,0,0 },
-	{ NULL,4080,  1, 0,0,0,0 },
-	{ NULL,   0,  0, 0,0,0,0 }
+	{ NULL,  32,127, 0,0,0,0, 0 },
+	{ NULL,  64, 63, 0,0,0,0, 0 },
+	{ NULL, 128, 31, 0,0,0,0, 0 },
+	{ NULL, 252, 16, 0,0,0,0, 0 },
+	{ NULL, 508,  8, 0,0,0,0, 0 },
+	{ NULL,1020,  4, 0,0,0,0, 0 },
+	{ NULL,2040,  2, 0,0,0,0, 0 },
+	{ NULL,4096-16,  1, 0,0,0,0, 0 },
+	{ NULL,8192-16,  1, 0,0,0,0, 1 },
+	{ NULL,16384-16,  1, 0,0,0,0, 2 },
+	{ NULL,32768-16,  1, 0,0,0,0, 3 },
+	{ NULL,65536-16,  1, 0,0,0,0, 4 },
+	{ NULL,131072-16,  1, 0,0,0,0, 5 },
+	{ NULL,   0,  0, 0,0,0,0, 0 }
 };
 
 
 #define NBLOCKS(order)          (sizes[order].nblocks)
 #define BLOCKSIZE(order)        (sizes[order].size)
+#define AREASIZE(order)		(PAGE_SIZE<<(sizes[order].gfporder))
 
 
 
@@ -134,16 +189,20 @@ for (order = 0;BLOCKSIZE(order);order++)
     {
     /*˴һҳпķ*/
     if ((NBLOCKS (order)*BLOCKSIZE(order) + sizeof (struct page_descriptor)) >
-        PAGE_SIZE) 
+        AREASIZE(order)) 
         {
         printk ("Cannot use %d bytes out of %d in order = %d block mallocs\n",
                 NBLOCKS (order) * BLOCKSIZE(order) + 
                         sizeof (struct page_descriptor),
-                (int) PAGE_SIZE,
+                (int) AREASIZE(order),
                 BLOCKSIZE (order));
         panic ("This only happens if someone messes with kmalloc");
         }
     }
+/* kfree_s() tells cache pages from kmalloc pages by this field */
+if ((long) &((struct kmem_slab *) 0)->magic !=
+    (long) &((struct page_descriptor *) 0)->order)
+	panic ("kmem_slab and page_descriptor are out of step");
 return start_mem;
 }
 
@@ -177,10 +236,10 @@ void * kmalloc (size_t size, int priority)
 			((unsigned long *)&size)[-1]);
 		priority = GFP_ATOMIC;
 	}
-	/*ڴһƣܳһҳ*/
+	/*ڴһƣܳ*/
 if (size > MAX_KMALLOC_K * 1024) 
      {
-     printk ("kmalloc: I refuse to allocate %d bytes (for now max = %d).\n",
+     printk ("kmalloc: I refuse to allocate %u bytes (for now max = %lu).\n",
                 size,MAX_KMALLOC_K*1024);
      return (NULL);
      }
@@ -238,7 +297,7 @@ if (order < 0)
 	    sz = BLOCKSIZE(order); /* sz is the size of the blocks we're dealing with */
 
 	    /* This can be done with ints on: This is private to this invocation */
-	    page = (struct page_descriptor *) __get_free_page (priority & GFP_LEVEL_MASK);
+	    page = (struct page_descriptor *) __get_free_pages (priority & GFP_LEVEL_MASK, sizes[order].gfporder);
     	if (!page) {
         	printk ("Couldn't get a free page.....\n");
         	return NULL;
@@ -302,6 +361,10 @@ void kfree_s (void *ptr,int size)
 	register struct block_header *p=((struct block_header *)ptr) -1;
 	struct page_descriptor *page,*pg2;
 
+	if (SLAB_DESC(ptr)->magic == KMEM_SLAB_MAGIC) {
+		kmem_cache_free(SLAB_DESC(ptr)->cache, ptr);
+		return;
+	}
 	/*ȡַڵҳ׵ַ*/
 	page = PAGE_DESC (p);
 	order = page->order;
@@ -361,7 +424,8 @@ void kfree_s (void *ptr,int size)
 	        else
 	            printk ("Ooops. page %p doesn't show on freelist.\n", page);
         }
-    	free_page ((long)page);
+    	free_pages ((long)page, sizes[order].gfporder);
+    	sizes[order].npages--;
     }
 	restore_flags(flags);
 
@@ -369,3 +433,235 @@ void kfree_s (void *ptr,int size)
 	sizes[order].nfrees++;      /* Noncritical (monitoring) admin stuff */
 	sizes[order].nbytesmalloced -= size;
 }
+
+
+/*
+ * Create a cache of objects "size" bytes long, each aligned to "align"
+ * (a power of two, at least sizeof(long)). The cache descriptor itself
+ * comes from kmalloc, so this must not be called before kmalloc_init().
+ */
+struct kmem_cache * kmem_cache_create(const char * name, int size, int align,
+	int flags, void (*ctor)(void *))
+{
+	unsigned long eflags;
+	struct kmem_cache *cachep;
+	int objs, offset;
+
+	if (align < sizeof(long))
+		align = sizeof(long);
+	size = (size + align - 1) & ~(align - 1);
+	objs = (PAGE_SIZE - sizeof(struct kmem_slab)) / (size + 1);
+	if (objs > KMEM_END)
+		objs = KMEM_END;
+	for (; objs > 0; objs--) {
+		offset = (sizeof(struct kmem_slab) + objs + align - 1) & ~(align - 1);
+		if (offset + objs * size <= PAGE_SIZE)
+			break;
+	}
+	if (objs <= 0) {
+		printk ("kmem_cache_create: %d byte objects for %s don't fit a page\n",
+			size, name);
+		return NULL;
+	}
+	cachep = (struct kmem_cache *) kmalloc(sizeof(struct kmem_cache), GFP_KERNEL);
+	if (!cachep)
+		return NULL;
+	cachep->name = name;
+	cachep->size = size;
+	cachep->offset = offset;
+	cachep->objs = objs;
+	cachep->flags = flags;
+	cachep->ctor = ctor;
+	cachep->partial = NULL;
+	cachep->free = NULL;
+	cachep->npages = cachep->nfreepages = 0;
+	cachep->nactive = cachep->nallocs = cachep->nfrees = 0;
+
+	save_flags(eflags);
+	cli();
+	cachep->next = kmem_cache_chain;
+	kmem_cache_chain = cachep;
+	restore_flags(eflags);
+	return cachep;
+}
+
+static inline void slab_link(struct kmem_slab ** list, struct kmem_slab * slab)
+{
+	slab->prev = NULL;
+	if ((slab->next = *list) != NULL)
+		slab->next->prev = slab;
+	*list = slab;
+}
+
+static inline void slab_unlink(struct kmem_slab ** list, struct kmem_slab * slab)
+{
+	if (slab->next)
+		slab->next->prev = slab->prev;
+	if (slab->prev)
+		slab->prev->next = slab->next;
+	else
+		*list = slab->next;
+}
+
+/*
+ * Get a page for the cache and run the constructor over its objects.
+ * This is private to the caller until it is linked in, so it runs with
+ * interrupts enabled.
+ */
+static struct kmem_slab * kmem_cache_grow(struct kmem_cache * cachep, int priority)
+{
+	struct kmem_slab *slab;
+	char *obj;
+	int i;
+
+	slab = (struct kmem_slab *) __get_free_page(priority & GFP_LEVEL_MASK);
+	if (!slab)
+		return NULL;
+	slab->magic = KMEM_SLAB_MAGIC;
+	slab->cache = cachep;
+	slab->inuse = 0;
+	slab->firstfree = 0;
+	obj = (char *) slab + cachep->offset;
+	for (i = 0; i < cachep->objs; i++, obj += cachep->size) {
+		slab->bufctl[i] = i + 1;
+		if (cachep->ctor)
+			cachep->ctor(obj);
+	}
+	slab->bufctl[cachep->objs - 1] = KMEM_END;
+	return slab;
+}
+
+void * kmem_cache_alloc(struct kmem_cache * cachep, int priority)
+{
+	unsigned long flags;
+	struct kmem_slab *slab;
+	int i;
+	extern unsigned long intr_count;
+
+	if (intr_count && priority != GFP_ATOMIC) {
+		printk("kmem_cache_alloc called nonatomically from interrupt %08lx\n",
+			((unsigned long *)&cachep)[-1]);
+		priority = GFP_ATOMIC;
+	}
+	save_flags(flags);
+	cli();
+	if (!(slab = cachep->partial)) {
+		if ((slab = cachep->free) != NULL) {
+			slab_unlink(&cachep->free, slab);
+			cachep->nfreepages--;
+		} else {
+			restore_flags(flags);
+			if (!(slab = kmem_cache_grow(cachep, priority)))
+				return NULL;
+			cli();
+			cachep->npages++;
+		}
+		slab_link(&cachep->partial, slab);
+	}
+	i = slab->firstfree;
+	slab->firstfree = slab->bufctl[i];
+	if (++slab->inuse == cachep->objs)
+		slab_unlink(&cachep->partial, slab);
+	cachep->nactive++;
+	cachep->nallocs++;
+	restore_flags(flags);
+	return (char *) slab + cachep->offset + i * cachep->size;
+}
+
+void kmem_cache_free(struct kmem_cache * cachep, void * obj)
+{
+	unsigned long flags;
+	struct kmem_slab *slab = SLAB_DESC(obj);
+	unsigned long i = (unsigned long) obj - (unsigned long) slab - cachep->offset;
+
+	if (slab->magic != KMEM_SLAB_MAGIC || slab->cache != cachep ||
+	    i % cachep->size || (i /= cachep->size) >= cachep->objs) {
+		printk ("kmem_cache_free: %p isn't a %s object\n", obj, cachep->name);
+		return;
+	}
+	save_flags(flags);
+	cli();
+	slab->bufctl[i] = slab->firstfree;
+	slab->firstfree = i;
+	cachep->nactive--;
+	cachep->nfrees++;
+	if (slab->inuse-- == cachep->objs)
+		slab_link(&cachep->partial, slab);
+	if (!slab->inuse) {
+		slab_unlink(&cachep->partial, slab);
+		if (cachep->nfreepages >= KMEM_KEEP_FREE &&
+		    !(cachep->flags & KMEM_NOREAP)) {
+			cachep->npages--;
+			restore_flags(flags);
+			free_page((unsigned long) slab);
+			return;
+		}
+		slab_link(&cachep->free, slab);
+		cachep->nfreepages++;
+	}
+	restore_flags(flags);
+}
+
+/*
+ * Give the cache's unused pages back. Returns the number of pages freed.
+ */
+int kmem_cache_shrink(struct kmem_cache * cachep)
+{
+	unsigned long flags;
+	struct kmem_slab *slab;
+	int freed = 0;
+
+	if (cachep->flags & KMEM_NOREAP)
+		return 0;
+	save_flags(flags);
+	cli();
+	while ((slab = cachep->free) != NULL) {
+		slab_unlink(&cachep->free, slab);
+		cachep->nfreepages--;
+		cachep->npages--;
+		restore_flags(flags);
+		free_page((unsigned long) slab);
+		freed++;
+		cli();
+	}
+	restore_flags(flags);
+	return freed;
+}
+
+/*
+ * Called by try_to_free_page(): free one unused cache page, if any.
+ */
+int kmem_cache_reap(void)
+{
+	struct kmem_cache *cachep;
+
+	for (cachep = kmem_cache_chain; cachep; cachep = cachep->next)
+		if (cachep->nfreepages && kmem_cache_shrink(cachep))
+			return 1;
+	return 0;
+}
+
+int get_slabinfo(char * buffer)
+{
+	struct kmem_cache *cachep;
+	int order, len;
+
+	len = sprintf(buffer, "%-16s %5s %5s %7s %7s %5s %5s %9s\n",
+		"name", "size", "objs", "active", "total", "pages", "free", "allocs");
+	for (cachep = kmem_cache_chain; cachep; cachep = cachep->next) {
+		len += sprintf(buffer+len, "%-16s %5d %5d %7d %7d %5d %5d %9d\n",
+			cachep->name, cachep->size, cachep->objs,
+			cachep->nactive, cachep->npages * cachep->objs,
+			cachep->npages, cachep->nfreepages, cachep->nallocs);
+		if (len > PAGE_SIZE - 160)
+			return len;
+	}
+	for (order = 0; BLOCKSIZE(order); order++)
+		len += sprintf(buffer+len, "kmalloc-%-8d %5d %5d %7d %7d %5d %5d %9d\n",
+			BLOCKSIZE(order), BLOCKSIZE(order), NBLOCKS(order),
+			sizes[order].nmallocs - sizes[order].nfrees,
+			sizes[order].npages * NBLOCKS(order),
+			sizes[order].npages << sizes[order].gfporder, 0,
+			sizes[order].nmallocs);
+	return len;
+}
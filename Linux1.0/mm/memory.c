@@ -40,6 +40,7 @@
 #include <linux/types.h>
 #include <linux/ptrace.h>
 #include <linux/mman.h>
+#include <linux/pagemap.h>
 
 
 //mem_initдݵend_memںֵַ֧
@@ -54,18 +55,8 @@ extern void die_if_kernel(char *,struct pt_regs *,long);
 /* еҳ */
 int nr_swap_pages = 0;
 
-/* ں˿׺Ϳп*/
+/* ں˿ҳҳswap.cĻ */
 int nr_free_pages = 0;
-unsigned long free_page_list = 0;
-/*
- * The secondary free_page_list is used for malloc() etc things that
- * may need pages during interrupts etc. Normal get_free_page() operations
- * don't touch it, so it stays as a kind of "panic-list", that can be
- * accessed when all other mm tricks have failed.
- */
-int nr_secondary_pages = 0;
-/* ںΪԭڴԤĿҳ */
-unsigned long secondary_page_list = 0;
 
 #define copy_page(from,to) \
 __asm__("cld ; rep ; movsl": :"S" (from),"D" (to),"c" (1024):"cx","di","si")
@@ -105,6 +96,11 @@ static void free_one_table(unsigned long * page_dir)
 	/*Ǳҳ*/
 	if (mem_map[MAP_NR(pg_table)] & MAP_PAGE_RESERVED)
 		return;
+	/* still shared since fork(): only our reference to it goes */
+	if (mem_map[MAP_NR(pg_table)] > 1) {
+		free_page(PAGE_MASK & pg_table);
+		return;
+	}
 	/*ȡҳ׵ַѭҳеÿһ*/
 	page_table = (unsigned long *) (pg_table & PAGE_MASK);
 	for (j = 0 ; j < PTRS_PER_PAGE ; j++,page_table++) {
@@ -237,10 +233,56 @@ int clone_page_tables(struct task_struct * tsk)
 }
 
 /*
- * copy_page_tables() just copies the whole process memory range:
- * note the special handling of RESERVED (ie kernel) pages, which
+ * Copy the entries of one page table into another: the present pages
+ * become shared copy-on-write, the swapped out ones get another swap
+ * reference.
+ */
+static void copy_one_table(unsigned long * old_page_table, unsigned long * new_page_table)
+{
+	int j;
+
+	for (j = 0 ; j < PTRS_PER_PAGE ; j++,old_page_table++,new_page_table++) {
+		unsigned long pg;
+		pg = *old_page_table;
+		/* ǵ0˵ҳڴ滹ûбӳ䣬ҲͲڿ
+		 * һifڴӳˣǲڴ浱У˵
+		 * УôҪڽп
+		 */
+		if (!pg)
+			continue;
+		if (!(pg & PAGE_PRESENT)) {
+			*new_page_table = swap_duplicate(pg);
+			continue;
+		}
+		if ((pg & (PAGE_RW | PAGE_COW)) == (PAGE_RW | PAGE_COW))
+			pg &= ~PAGE_RW;
+		/* ˴ûȥһµڴ棬ʵǸ̺ӽڹڴ棬Ҫдȥ
+		 * Ҳдʱ(copy-on-write),ͬʱҳmem_mapü__verify_write
+		 * free_pageСü
+		 */
+		*new_page_table = pg;
+		if (mem_map[MAP_NR(pg)] & MAP_PAGE_RESERVED)
+			continue;
+		*old_page_table = pg;
+		mem_map[MAP_NR(pg)]++;
+	}
+}
+
+/*
+ * copy_page_tables() doesn't copy much at fork() time: each page table
+ * is shared by parent and child, write-protected in both page
+ * directories, and most children exec() long before either side gets
+ * round to changing it. unshare_page_table() makes the copy when one
+ * of them does. Only tasks with shm attached still get their tables
+ * copied straight away, as shm_swap() finds its pages through each
+ * attach and would see a shared entry twice. Clearing
+ * share_page_tables copies them all, for comparing the two.
+ *
+ * Note the special handling of RESERVED (ie kernel) pages, which
  * means that they are always shared by all processes.
  */
+int share_page_tables = 1;
+
 int copy_page_tables(struct task_struct * tsk)
 {
 	int i;
@@ -260,9 +302,8 @@ int copy_page_tables(struct task_struct * tsk)
 	/* ʼѭƽ̵ҳĿ¼Ϊÿҳ4kb,ÿҳ4byteܹ1024ҳ
 	 */
 	for (i = 0 ; i < PTRS_PER_PAGE ; i++,old_page_dir++,new_page_dir++) {
-		int j;
-		unsigned long old_pg_table, *old_page_table;
-		unsigned long new_pg_table, *new_page_table;
+		unsigned long old_pg_table;
+		unsigned long new_pg_table;
 
 		old_pg_table = *old_page_dir;
 		if (!old_pg_table)
@@ -279,45 +320,68 @@ int copy_page_tables(struct task_struct * tsk)
 			*new_page_dir = old_pg_table;
 			continue;
 		}
+		if (!current->shm && share_page_tables) {
+			old_pg_table &= ~PAGE_RW;
+			*old_page_dir = *new_page_dir = old_pg_table;
+			mem_map[MAP_NR(old_pg_table)]++;
+			continue;
+		}
 		/* һµҳ
 		 */
 		if (!(new_pg_table = get_free_page(GFP_KERNEL))) {
 			free_page_tables(tsk);
 			return -ENOMEM;
 		}
-		old_page_table = (unsigned long *) (PAGE_MASK & old_pg_table);
-		new_page_table = (unsigned long *) (PAGE_MASK & new_pg_table);
-		for (j = 0 ; j < PTRS_PER_PAGE ; j++,old_page_table++,new_page_table++) {
-			unsigned long pg;
-			pg = *old_page_table;
-			/* ǵ0˵ҳڴ滹ûбӳ䣬ҲͲڿ
-			 * һifڴӳˣǲڴ浱У˵
-			 * УôҪڽп
-			 */
-			if (!pg)
-				continue;
-			if (!(pg & PAGE_PRESENT)) {
-				*new_page_table = swap_duplicate(pg);
-				continue;
-			}
-			if ((pg & (PAGE_RW | PAGE_COW)) == (PAGE_RW | PAGE_COW))
-				pg &= ~PAGE_RW;
-			/* ˴ûȥһµڴ棬ʵǸ̺ӽڹڴ棬Ҫдȥ
-			 * Ҳдʱ(copy-on-write),ͬʱҳmem_mapü__verify_write
-			 * free_pageСü
-			 */
-			*new_page_table = pg;
-			if (mem_map[MAP_NR(pg)] & MAP_PAGE_RESERVED)
-				continue;
-			*old_page_table = pg;
-			mem_map[MAP_NR(pg)]++;
-		}
+		copy_one_table((unsigned long *) (PAGE_MASK & old_pg_table),
+			(unsigned long *) new_pg_table);
 		*new_page_dir = new_pg_table | PAGE_TABLE;
 	}
 	invalidate();
 	return 0;
 }
 
+/*
+ * Give "tsk" a page table of its own for the page directory entry at
+ * "page_dir", if fork() left it shared: this has to be done before
+ * anything in it is changed. If the others sharing it have gone, the
+ * table is simply made writable again. Returns the new directory entry,
+ * or 0 if we ran out of memory.
+ */
+unsigned long unshare_page_table(struct task_struct * tsk, unsigned long * page_dir)
+{
+	unsigned long pg_table;
+	unsigned long new_pg_table = 0;
+
+repeat:
+	pg_table = *page_dir;
+	if (!(pg_table & PAGE_PRESENT) || (pg_table & PAGE_RW))
+		goto done;
+	if (mem_map[MAP_NR(pg_table)] == 1) {
+		pg_table |= PAGE_RW;
+		*page_dir = pg_table;
+		invalidate();
+		goto done;
+	}
+	if (!new_pg_table) {
+		if (!(new_pg_table = get_free_page(GFP_KERNEL))) {
+			oom(tsk);
+			return 0;
+		}
+		/* we may have slept: look again */
+		goto repeat;
+	}
+	copy_one_table((unsigned long *) (PAGE_MASK & pg_table),
+		(unsigned long *) new_pg_table);
+	*page_dir = new_pg_table | PAGE_TABLE;
+	free_page(PAGE_MASK & pg_table);
+	invalidate();
+	return *page_dir;
+done:
+	if (new_pg_table)
+		free_page(new_pg_table);
+	return pg_table;
+}
+
 /*
  * a more complete version of free_page_tables which performs with page
  * granularity.
@@ -352,6 +416,18 @@ int unmap_page_range(unsigned long from, unsigned long size)
 			printk("unmap_page_range: bad page directory.");
 			continue;
 		}
+		if (!(page_dir & PAGE_RW)) {
+			/* a whole table still shared since fork(): let go of it */
+			if (pcnt == PTRS_PER_PAGE && mem_map[MAP_NR(page_dir)] > 1) {
+				*dir = 0;
+				free_page(PAGE_MASK & page_dir);
+				continue;
+			}
+			if (!(page_dir = unshare_page_table(current, dir))) {
+				poff = 0;
+				continue;
+			}
+		}
 		page_table = (unsigned long *)(PAGE_MASK & page_dir);
 		if (poff) {
 			page_table += poff;
@@ -423,6 +499,10 @@ int zeromap_page_range(unsigned long from, unsigned long size, int mask)
 			} else
 				*dir++ = ((unsigned long) page_table) | PAGE_TABLE;
 		} else {
+			if (!(PAGE_RW & *dir) && !unshare_page_table(current, dir)) {
+				invalidate();
+				return -ENOMEM;
+			}
 			/*ȡҳĿ¼ҳλ*/
 			page_table = (unsigned long *)(PAGE_MASK & *dir++);
 		}
@@ -483,8 +563,13 @@ int remap_page_range(unsigned long from, unsigned long to, unsigned long size, i
 			}
 			*dir++ = ((unsigned long) page_table) | PAGE_TABLE;
 		}
-		else
+		else {
+			if (!(PAGE_RW & *dir) && !unshare_page_table(current, dir)) {
+				invalidate();
+				return -1;
+			}
 			page_table = (unsigned long *)(PAGE_MASK & *dir++);
+		}
 		if (poff) {
 			page_table += poff;
 			poff = 0;
@@ -654,6 +739,9 @@ static void __do_wp_page(unsigned long error_code, unsigned long address,
 	/*дڴӦӳҳڴʱκδ*/
 	if (!(pte & PAGE_PRESENT))
 		goto end_wp_page;
+	/* shared by a fork() while we slept: do_wp_page() will sort it out */
+	if (!(pte & PAGE_RW))
+		goto end_wp_page;
 	if ((pte & PAGE_TABLE) != PAGE_TABLE || pte >= high_memory)
 		goto bad_wp_pagetable;
 	pte &= PAGE_MASK;
@@ -690,8 +778,9 @@ static void __do_wp_page(unsigned long error_code, unsigned long address,
 		invalidate();
 		return;
 	}
-	*(unsigned long *) pte |= PAGE_RW;
+	*(unsigned long *) pte |= PAGE_RW | PAGE_DIRTY;
 	invalidate();
+	swap_cache_dirty(old_page);
 	if (new_page)
 		free_page(new_page);
 	return;
@@ -727,6 +816,9 @@ void do_wp_page(unsigned long error_code, unsigned long address,
 	if (!page)
 		return;
 	if ((page & PAGE_PRESENT) && page < high_memory) {
+		/* the table itself may still be shared since fork() */
+		if (!(page & PAGE_RW) && !(page = unshare_page_table(tsk, pg_table)))
+			return;
 		/* PAGE_PTR(address)ҵԵַҳеƫ */
 		pg_table = (unsigned long *) ((page & PAGE_MASK) + PAGE_PTR(address));
 		page = *pg_table;
@@ -748,6 +840,7 @@ void do_wp_page(unsigned long error_code, unsigned long address,
 		if (mem_map[MAP_NR(page)] == 1) {
 			*pg_table |= PAGE_RW | PAGE_DIRTY;
 			invalidate();
+			swap_cache_dirty(page & PAGE_MASK);
 			return;
 		}
 		__do_wp_page(error_code, address, tsk, user_esp);
@@ -833,6 +926,9 @@ static int try_to_share(unsigned long address, struct task_struct * tsk,
 	/*Ҫҳڴ*/
 	if (mem_map[MAP_NR(from)] & MAP_PAGE_RESERVED)
 		return 0;
+	/* a clean page swapped back in isn't executable text */
+	if (swap_cache[MAP_NR(from)])
+		return 0;
 /* is the destination ok? */
 	to = *(unsigned long *) to_page;
 	if (!(to & PAGE_PRESENT))
@@ -933,7 +1029,7 @@ static inline unsigned long get_empty_pgtable(struct task_struct * tsk,unsigned
 
 	p = PAGE_DIR_OFFSET(tsk->tss.cr3,address);
 	if (PAGE_PRESENT & *p)
-		return *p;
+		return unshare_page_table(tsk, p);
 	if (*p) {
 		printk("get_empty_pgtable: bad page-directory entry \n");
 		*p = 0;
@@ -946,7 +1042,7 @@ static inline unsigned long get_empty_pgtable(struct task_struct * tsk,unsigned
 	 */
 	if (PAGE_PRESENT & *p) {
 		free_page(page);
-		return *p;
+		return unshare_page_table(tsk, p);
 	}
 	if (*p) {
 		printk("get_empty_pgtable: bad page-directory entry \n");
@@ -1142,7 +1238,6 @@ void show_mem(void)
 
 	printk("Mem-info:\n");
 	printk("Free pages:      %6dkB\n",nr_free_pages<<(PAGE_SHIFT-10));
-	printk("Secondary pages: %6dkB\n",nr_secondary_pages<<(PAGE_SHIFT-10));
 	printk("Free swap:       %6dkB\n",nr_swap_pages<<(PAGE_SHIFT-10));
 	i = high_memory >> PAGE_SHIFT;
 	while (i-- > 0) {
@@ -1158,6 +1253,12 @@ void show_mem(void)
 	printk("%d free pages\n",free);
 	printk("%d reserved pages\n",reserved);
 	printk("%d pages shared\n",shared);
+	{
+		char buf[160];
+
+		get_page_cache_info(buf);
+		printk("%s", buf);
+	}
 	show_buffers();
 }
 
@@ -1259,6 +1360,8 @@ void mem_init(unsigned long start_low_mem,
 	/*еڴҳ״̬ΪMAP_PAGE_RESERVEDӦúCOWй*/
 	while (p > mem_map)
 		*--p = MAP_PAGE_RESERVED;
+	start_mem = free_area_init(start_mem, end_mem);
+	start_mem = swap_cache_init(start_mem, end_mem);
 	start_low_mem = PAGE_ALIGN(start_low_mem);
 	start_mem = PAGE_ALIGN(start_mem);
 	/* start_low_memС1M640KB-1MBԴˡ0xA0000=640KB */
@@ -1278,11 +1381,10 @@ void mem_init(unsigned long start_low_mem,
 	sound_mem_init();
 #endif
 	/* ˶δǳҪ漰kamlloc
-	 * free_page_listΪҳ
+	 * пҳڵĿҳᱻϲɴ
 	 * nr_free_pagesҳ
 	 **/
 
-	free_page_list = 0;
 	nr_free_pages = 0;
 	for (tmp = 0 ; tmp < end_mem ; tmp += PAGE_SIZE) {
 		/*mem_mapıǴ0ʾҳѱʹ*/
@@ -1297,12 +1399,11 @@ void mem_init(unsigned long start_low_mem,
 				datapages++;
 			continue;
 		}
-		/* ҳǿеģ򽫸ÿҳӵfree_page_list
-		  * ףͬʱnr_free_pages
+		/* ҳǿеģͨfree_page
+		  * ͬʱnr_free_pages
 		  */
-		*(unsigned long *) tmp = free_page_list;
-		free_page_list = tmp;
-		nr_free_pages++;
+		mem_map[MAP_NR(tmp)] = 1;
+		free_page(tmp);
 	}
 	tmp = nr_free_pages << PAGE_SHIFT;
 	printk("Memory: %luk/%luk available (%dk kernel code, %dk reserved, %dk data)\n",
@@ -1350,6 +1451,46 @@ void si_meminfo(struct sysinfo *val)
 }
 
 
+/*
+ * Fault in a page of a page aligned file mapping from the page cache. A
+ * read fault maps the cached page itself read-only, so every process
+ * mapping the file shares it and a later write fault copies it. A write
+ * fault on a not-present page gets its private copy straight away.
+ */
+static void file_mmap_cached(int error_code, struct vm_area_struct * area,
+	unsigned long address)
+{
+	unsigned long page, new_page;
+	int prot = area->vm_page_prot;
+
+	if (page_cache_read(area->vm_inode, address - area->vm_start + area->vm_offset, &page) > 0)
+		++area->vm_task->min_flt;
+	else
+		++area->vm_task->maj_flt;
+	if (!page) {
+		oom(current);
+		put_page(area->vm_task, BAD_PAGE, address, PAGE_PRIVATE);
+		return;
+	}
+	if (error_code & PAGE_RW) {
+		new_page = __get_free_page(GFP_KERNEL);
+		if (!new_page) {
+			free_page(page);
+			oom(current);
+			put_page(area->vm_task, BAD_PAGE, address, PAGE_PRIVATE);
+			return;
+		}
+		copy_page(page, new_page);
+		free_page(page);
+		page = new_page;
+		prot |= PAGE_RW | PAGE_DIRTY;
+	}
+	if (put_page(area->vm_task, page, address, prot))
+		return;
+	free_page(page);
+	oom(current);
+}
+
 /* This handles a generic mmap of a disk file */
 void file_mmap_nopage(int error_code, struct vm_area_struct * area, unsigned long address)
 {
@@ -1371,6 +1512,12 @@ void file_mmap_nopage(int error_code, struct vm_area_struct * area, unsigned lon
 	 */
 	block >>= inode->i_sb->s_blocksize_bits;
 
+	/* page aligned mappings are served from the page cache */
+	if (!(area->vm_offset & ~PAGE_MASK)) {
+		file_mmap_cached(error_code, area, address);
+		return;
+	}
+
 	page = get_free_page(GFP_KERNEL);
 	if (share_page(area, area->vm_task, inode, address, error_code, page)) {
 		++area->vm_task->min_flt;
@@ -17,6 +17,8 @@
 #include <linux/errno.h>
 #include <linux/string.h>
 #include <linux/stat.h>
+#include <linux/malloc.h>
+#include <linux/pagemap.h>
 
 #include <asm/system.h> /* for cli()/sti() */
 #include <asm/bitops.h>
@@ -54,25 +56,152 @@ static struct swap_info_struct {
 	int highest_bit;
 	/*¼swap_lockmapһλͼΪ0λһλõ*/
 	unsigned long max;
+	int cluster_next;		/* where get_swap_page() looks first */
+	int cluster_nr;			/* slots left in the current cluster */
 } swap_info[MAX_SWAPFILES];
 
-extern unsigned long free_page_list;
 extern int shm_swap (int);
 
 /*
- * The following are used to make sure we don't thrash too much...
- * NOTE!! NR_LAST_FREE_PAGES must be a power of 2...
+ * The swap cache: pages holding the contents of a swap slot.
+ * swap_cache[MAP_NR(page)] is the swap entry a page holds, or 0, and the
+ * pages are hashed on their entries so swap_in() can find them. A page is
+ * in the cache for one of two reasons:
+ *
+ * - nobody has it mapped: it was read ahead of a fault, or it is on its
+ *   way to the disk. The cache holds a reference to the page but not to
+ *   the slot, and the page is dropped as soon as its slot is freed, so a
+ *   slot can never be found with stale data. These are marked with
+ *   SWAP_CACHE_UNMAPPED.
+ * - it was swapped in and hasn't been written to since. It is mapped
+ *   read-only, and the cache holds on to the slot for it in place of the
+ *   page tables: try_to_swap_out() can then put the entry back and drop
+ *   the page without writing it again. The first write goes through
+ *   do_wp_page(), which calls swap_cache_dirty() to let go of the slot.
  */
+#define SWAP_CACHE_UNMAPPED 1	/* never set in a swap entry */
+#define SWAP_CACHE_HASH 251
+#define swap_hashfn(entry) (((entry) >> PAGE_SHIFT) % SWAP_CACHE_HASH)
 
-/* ¼ȥĿڴ
- *
+unsigned long * swap_cache = NULL;
+static unsigned long * swap_cache_next = NULL;	/* hash chains, by MAP_NR */
+static unsigned long swap_cache_hash[SWAP_CACHE_HASH];	/* 0 ends a chain */
+
+unsigned long swap_cache_pages = 0;
+static unsigned long swap_ra_pages = 0;		/* read ahead of a fault */
+static unsigned long swap_cache_hits = 0;	/* faults that found the page */
+static unsigned long swap_writes_saved = 0;	/* clean pages dropped unwritten */
+
+static unsigned long lookup_swap_cache(unsigned long entry)
+{
+	unsigned long nr;
+
+	for (nr = swap_cache_hash[swap_hashfn(entry)] ; nr ; nr = swap_cache_next[nr])
+		if ((swap_cache[nr] & ~SWAP_CACHE_UNMAPPED) == entry)
+			return nr << PAGE_SHIFT;
+	return 0;
+}
+
+static void add_to_swap_cache(unsigned long page, unsigned long entry)
+{
+	unsigned long nr = MAP_NR(page);
+	unsigned long * p = swap_cache_hash + swap_hashfn(entry);
+
+	swap_cache[nr] = entry;
+	swap_cache_next[nr] = *p;
+	*p = nr;
+	swap_cache_pages++;
+}
+
+/* Unhash the page; the reference the cache held is the caller's now */
+static void delete_from_swap_cache(unsigned long page)
+{
+	unsigned long nr = MAP_NR(page);
+	unsigned long * p = swap_cache_hash + swap_hashfn(swap_cache[nr]);
+
+	while (*p != nr)
+		p = swap_cache_next + *p;
+	*p = swap_cache_next[nr];
+	swap_cache[nr] = 0;
+	swap_cache_pages--;
+}
+
+/* Unhash a swapped in page, and hand the slot it held to the caller */
+static inline unsigned long unhash_swap_page(unsigned long page)
+{
+	unsigned long entry = swap_cache[MAP_NR(page)];
+
+	if (!entry || (entry & SWAP_CACHE_UNMAPPED))
+		return 0;
+	delete_from_swap_cache(page);
+	return entry;
+}
+
+/*
+ * Called before a swapped in page is written to: it won't match its
+ * slot any more. The page table entry must be dirty by now, as we may
+ * sleep in swap_free().
+ */
+void swap_cache_dirty(unsigned long page)
+{
+	if (page < high_memory)
+		swap_free(unhash_swap_page(page));
+}
+
+/*
+ * Give back a cached page nobody has faulted in. The scan goes round
+ * mem_map from where it last stopped, further the more urgent it gets.
  */
-#define NR_LAST_FREE_PAGES 32
+static int shrink_swap_cache(unsigned int priority)
+{
+	static unsigned long hand = 0;
+	unsigned long limit = MAP_NR(high_memory);
+	unsigned long i;
 
-/* ¼ϵͳ󱻷ȥ32ڴ棬ڽڴʱж */
-static unsigned long last_free_pages[NR_LAST_FREE_PAGES] = {0,};
+	if (!swap_cache_pages)
+		return 0;
+	for (i = (limit >> priority) + 1 ; i > 0 ; i--) {
+		if (++hand >= limit)
+			hand = 0;
+		if (!(swap_cache[hand] & SWAP_CACHE_UNMAPPED))
+			continue;
+		reclaim_stat[RECLAIM_SWAP_CACHE].scan++;
+		if (mem_map[hand] == 1) {
+			delete_from_swap_cache(hand << PAGE_SHIFT);
+			free_page(hand << PAGE_SHIFT);
+			return 1;
+		}
+	}
+	return 0;
+}
 
-void rw_swap_page(int rw, unsigned long entry, char * buf)
+/* Called by mem_init(): the swap cache arrays come out of start_mem */
+unsigned long swap_cache_init(unsigned long start_mem, unsigned long end_mem)
+{
+	unsigned long size = MAP_NR(end_mem) * sizeof(unsigned long);
+	int i;
+
+	start_mem = (start_mem + 3) & ~3;
+	swap_cache = (unsigned long *) start_mem;
+	memset(swap_cache, 0, size);
+	start_mem += size;
+	swap_cache_next = (unsigned long *) start_mem;
+	start_mem += size;
+	for (i = 0 ; i < SWAP_CACHE_HASH ; i++)
+		swap_cache_hash[i] = 0;
+	return start_mem;
+}
+
+/* One line for /proc/meminfo */
+int get_swap_cache_info(char * buffer)
+{
+	return sprintf(buffer, "SwapCached: %8lu (%lu read ahead, %lu hits, %lu writes saved)\n",
+		swap_cache_pages << PAGE_SHIFT, swap_ra_pages, swap_cache_hits,
+		swap_writes_saved);
+}
+
+/* ҵentryʼnrҳڵĽϷ򷵻NULL */
+static struct swap_info_struct * swap_area(unsigned long entry, int nr)
 {
 	unsigned long type, offset;
 	struct swap_info_struct * p;
@@ -81,30 +210,70 @@ void rw_swap_page(int rw, unsigned long entry, char * buf)
 	type = SWP_TYPE(entry);
 	if (type >= nr_swapfiles) {
 		printk("Internal error: bad swap-device\n");
-		return;
+		return NULL;
 	}
 	p = &swap_info[type];
 	/* ȡӦƫ */
 	offset = SWP_OFFSET(entry);
 	/* ֵʧܷ */
-	if (offset >= p->max) {
+	if (offset + nr > p->max) {
 		printk("rw_swap_page: weirdness\n");
-		return;
+		return NULL;
 	}
 	if (!(p->flags & SWP_USED)) {
 		printk("Trying to swap to unused swap-device\n");
-		return;
+		return NULL;
 	}
+	return p;
+}
+
+/* סentryʼnrҳ0ʾentryϷ */
+static int lock_swap_pages(unsigned long entry, int nr)
+{
+	struct swap_info_struct * p;
+	unsigned long offset = SWP_OFFSET(entry);
+	int k;
+
+	if (!(p = swap_area(entry, nr)))
+		return 0;
 	/* ԭ1ʾѱռãҪȴ*/
-	while (set_bit(offset,p->swap_lockmap))
-		sleep_on(&lock_queue);
+	for (k = 0 ; k < nr ; k++)
+		while (set_bit(offset+k,p->swap_lockmap))
+			sleep_on(&lock_queue);
+	return 1;
+}
+
+static void unlock_swap_pages(unsigned long entry, int nr)
+{
+	struct swap_info_struct * p = &swap_info[SWP_TYPE(entry)];
+	unsigned long offset = SWP_OFFSET(entry);
+	int k;
+
+	for (k = 0 ; k < nr ; k++)
+		if (offset+k && !clear_bit(offset+k,p->swap_lockmap))
+			printk("rw_swap_page: lock already cleared\n");
+	wake_up(&lock_queue);
+}
+
+/*
+ * Read or write "nr" pages at consecutive slots of one swap area,
+ * starting at "entry", which the caller has locked. A swap device gets
+ * them all in one request; a swap file is done a page at a time, as its
+ * blocks are wherever bmap() put them.
+ */
+static void __rw_swap_pages(int rw, unsigned long entry, char ** bufs, int nr)
+{
+	struct swap_info_struct * p = &swap_info[SWP_TYPE(entry)];
+	unsigned long offset = SWP_OFFSET(entry);
+	int k;
+
 	if (rw == READ)
-		kstat.pswpin++;
+		kstat.pswpin += nr;
 	else
-		kstat.pswpout++;
+		kstat.pswpout += nr;
 	if (p->swap_device) {
-		ll_rw_page(rw,p->swap_device,offset,buf);
-	} else if (p->swap_file) {
+		ll_rw_pages(rw,p->swap_device,offset,bufs,nr);
+	} else if (p->swap_file) for (k = 0 ; k < nr ; k++) {
 		/* 豸߼ţ
 		  * ʹýļ߼ӳ
 		  */
@@ -113,20 +282,81 @@ void rw_swap_page(int rw, unsigned long entry, char * buf)
 		int i, j;
 
 		/* ȡļȡλõ߼*/
-		block = offset << (12 - p->swap_file->i_sb->s_blocksize_bits);
+		block = (offset+k) << (12 - p->swap_file->i_sb->s_blocksize_bits);
 
 		/* ΪPAGE_SIZEڴһҳСs_blocksizeǴ̿һĴС */
 		for (i=0, j=0; j< PAGE_SIZE ; i++, j +=p->swap_file->i_sb->s_blocksize)
 			if (!(zones[i] = bmap(p->swap_file,block++))) {
 				printk("rw_swap_page: bad swap file\n");
-				return;
+				break;
 			}
-		ll_rw_swap_file(rw,p->swap_file->i_dev, zones, i,buf);
+		if (j >= PAGE_SIZE)
+			ll_rw_swap_file(rw,p->swap_file->i_dev, zones, i,bufs[k]);
 	} else
 		printk("re_swap_page: no swap file or device\n");
-	if (offset && !clear_bit(offset,p->swap_lockmap))
-		printk("rw_swap_page: lock already cleared\n");
-	wake_up(&lock_queue);
+}
+
+void rw_swap_pages(int rw, unsigned long entry, char ** bufs, int nr)
+{
+	if (!lock_swap_pages(entry, nr))
+		return;
+	__rw_swap_pages(rw, entry, bufs, nr);
+	unlock_swap_pages(entry, nr);
+}
+
+void rw_swap_page(int rw, unsigned long entry, char * buf)
+{
+	rw_swap_pages(rw, entry, &buf, 1);
+}
+
+/*
+ * Slots are handed out in clusters: once one has been taken, the ones
+ * after it are used while they are free, up to SWAPFILE_CLUSTER of them,
+ * so the pages swap_out() gathers in one pass end up next to each other
+ * and go to the disk in one request. A new cluster starts at the first
+ * run of free slots long enough to hold a whole one, if there is any.
+ */
+#define SWAPFILE_CLUSTER 32
+
+static int scan_swap_map(struct swap_info_struct * p)
+{
+	int offset, run;
+
+	if (p->cluster_nr) {
+		while (p->cluster_next <= p->highest_bit) {
+			offset = p->cluster_next++;
+			if (p->swap_map[offset])
+				continue;
+			p->cluster_nr--;
+			goto got_slot;
+		}
+	}
+	p->cluster_nr = SWAPFILE_CLUSTER-1;
+	run = 0;
+	for (offset = p->lowest_bit ; offset <= p->highest_bit ; offset++) {
+		if (p->swap_map[offset]) {
+			run = 0;
+			continue;
+		}
+		if (++run == SWAPFILE_CLUSTER) {
+			offset -= SWAPFILE_CLUSTER-1;
+			goto got_slot;
+		}
+	}
+	/* too fragmented for a whole cluster: any free slot will do */
+	for (offset = p->lowest_bit ; offset <= p->highest_bit ; offset++)
+		if (!p->swap_map[offset])
+			goto got_slot;
+	return 0;
+got_slot:
+	p->swap_map[offset] = 1;
+	nr_swap_pages--;
+	if (offset == p->highest_bit)
+		p->highest_bit--;
+	if (offset == p->lowest_bit)
+		p->lowest_bit++;
+	p->cluster_next = offset+1;
+	return offset;
 }
 
 /* ȡһʵĽҳ */
@@ -140,17 +370,9 @@ unsigned int get_swap_page(void)
 		/* ҪǿдĽļSWP_USEDǣʾû׼ */
 		if ((p->flags & SWP_WRITEOK) != SWP_WRITEOK)
 			continue;
-		for (offset = p->lowest_bit; offset <= p->highest_bit ; offset++) {
-			if (p->swap_map[offset])
-				continue;
-			/* ҳıǣͬʱСܹҳ */
-			p->swap_map[offset] = 1;
-			nr_swap_pages--;
-			if (offset == p->highest_bit)
-				p->highest_bit--;
-			p->lowest_bit = offset;
+		offset = scan_swap_map(p);
+		if (offset)
 			return SWP_ENTRY(type,offset);
-		}
 	}
 	return 0;
 }
@@ -224,13 +446,63 @@ void swap_free(unsigned long entry)
 	if (!p->swap_map[offset])
 		printk("swap_free: swap-space map bad (entry %08lx)\n",entry);
 	else
-		if (!--p->swap_map[offset])
+		if (!--p->swap_map[offset]) {
+			unsigned long page = lookup_swap_cache(entry);
+
 			nr_swap_pages++;
+			if (page) {
+				delete_from_swap_cache(page);
+				free_page(page);
+			}
+		}
 	if (!clear_bit(offset,p->swap_lockmap))
 		printk("swap_free: lock already cleared\n");
 	wake_up(&lock_queue);
 }
 
+/*
+ * Up to SWAP_CLUSTER pages are read or written with one request.
+ */
+#define SWAP_CLUSTER 8
+
+/*
+ * Read the slot "entry" into "page", and the slots in use after it into
+ * the swap cache while the disk is at it: get_swap_page() put pages that
+ * were swapped out together next to each other, and they tend to be
+ * wanted back together too. The read ahead pages are only taken if they
+ * come without having to free anything.
+ */
+static void read_swap_cluster(unsigned long entry, unsigned long page)
+{
+	struct swap_info_struct * p = swap_info + SWP_TYPE(entry);
+	unsigned long offset = SWP_OFFSET(entry);
+	char * bufs[SWAP_CLUSTER];
+	int i, nr;
+
+	bufs[0] = (char *) page;
+	for (nr = 1 ; nr < SWAP_CLUSTER ; nr++) {
+		if (SWP_TYPE(entry) >= nr_swapfiles || offset + nr >= p->max)
+			break;
+		if (!p->swap_map[offset+nr] || p->swap_map[offset+nr] == 0x80)
+			break;
+		if (lookup_swap_cache(entry + SWP_ENTRY(0,nr)))
+			break;
+		if (!(bufs[nr] = (char *) __get_free_page(GFP_BUFFER)))
+			break;
+	}
+	rw_swap_pages(READ, entry, bufs, nr);
+	/* only now: a slot can't be freed while it's being read */
+	for (i = 1 ; i < nr ; i++) {
+		if (p->swap_map && p->swap_map[offset+i] &&
+		    !lookup_swap_cache(entry + SWP_ENTRY(0,i))) {
+			add_to_swap_cache((unsigned long) bufs[i],
+				(entry + SWP_ENTRY(0,i)) | SWAP_CACHE_UNMAPPED);
+			swap_ra_pages++;
+		} else
+			free_page((unsigned long) bufs[i]);
+	}
+}
+
 /* swap_out෴ӽаݽڴ浱 
  * table_ptrҳĵַ
  */
@@ -253,25 +525,109 @@ void swap_in(unsigned long *table_ptr)
 		return;
 	}
 	/* ΪʲôҪȥںҳ?*/
+	if ((page = lookup_swap_cache(entry)) != 0) {
+		swap_cache_hits++;
+		*table_ptr = page | PAGE_COPY;
+		if (swap_cache[MAP_NR(page)] & SWAP_CACHE_UNMAPPED) {
+			/* the cache's page is ours now, our slot the cache's */
+			swap_cache[MAP_NR(page)] = entry;
+			return;
+		}
+		/* somebody else has it mapped already */
+		mem_map[MAP_NR(page)]++;
+		swap_free(entry);
+		return;
+	}
 	if (!(page = get_free_page(GFP_KERNEL))) {
 		oom(current);
 		page = BAD_PAGE;
 	} else	
-		read_swap_page(entry, (char *) page);
+		read_swap_cluster(entry, page);
 	if (*table_ptr != entry) {
 		free_page(page);
 		return;
 	}
+	/* map it clean, so that it needn't be written out again */
+	if (page != BAD_PAGE && !lookup_swap_cache(entry)) {
+		add_to_swap_cache(page, entry);
+		*table_ptr = page | PAGE_COPY;
+		return;
+	}
 	/* ñڴҳӳϵ*/
 	*table_ptr = page | (PAGE_DIRTY | PAGE_PRIVATE);
 	swap_free(entry);
 }
 
 
+/*
+ * try_to_swap_out() only queues the dirty pages it takes, swap_out()
+ * sends them to the disk once it has gathered SWAP_CLUSTER of them or is
+ * done with the process.
+ */
+static unsigned long swap_batch_entry[SWAP_CLUSTER];
+static unsigned long swap_batch_page[SWAP_CLUSTER];
+static int swap_batch_nr = 0;
+
+/*
+ * Write out the queued pages, a run of consecutive slots at a time, and
+ * free them. The batch is emptied before we sleep, as somebody else may
+ * be swapping out meanwhile, and the pages go into the swap cache until
+ * they are on the disk: a fault on a slot we haven't got to yet finds the
+ * page there instead of reading a slot that hasn't been written.
+ *
+ * Every slot of the batch is locked before the first run goes out. If
+ * a slot is freed and handed out again while we sleep on an earlier run,
+ * its new owner waits for the lock, so its write lands after our stale
+ * one instead of being overwritten by it.
+ */
+static void swap_flush(void)
+{
+	unsigned long entry[SWAP_CLUSTER];
+	char * bufs[SWAP_CLUSTER];
+	unsigned long page;
+	int i, n, nr, run[SWAP_CLUSTER];
+
+	nr = swap_batch_nr;
+	for (i = 0 ; i < nr ; i++) {
+		entry[i] = swap_batch_entry[i];
+		bufs[i] = (char *) swap_batch_page[i];
+		/* a read ahead may have cached what the slot held before */
+		if ((page = lookup_swap_cache(entry[i])) != 0) {
+			delete_from_swap_cache(page);
+			free_page(page);
+		}
+		add_to_swap_cache(swap_batch_page[i], entry[i] | SWAP_CACHE_UNMAPPED);
+		mem_map[MAP_NR(swap_batch_page[i])]++;
+	}
+	swap_batch_nr = 0;
+	for (i = 0 ; i < nr ; i += n) {
+		for (n = 1 ; i + n < nr ; n++)
+			if (entry[i+n] != entry[i] + SWP_ENTRY(0,n))
+				break;
+		/* a run we couldn't lock is a bad entry, and isn't written */
+		run[i] = lock_swap_pages(entry[i], n) ? n : -n;
+	}
+	for (i = 0 ; i < nr ; i += n) {
+		if ((n = run[i]) < 0) {
+			n = -n;
+			continue;
+		}
+		__rw_swap_pages(WRITE, entry[i], bufs+i, n);
+		unlock_swap_pages(entry[i], n);
+	}
+	for (i = 0 ; i < nr ; i++) {
+		page = (unsigned long) bufs[i];
+		if (swap_cache[MAP_NR(page)] == (entry[i] | SWAP_CACHE_UNMAPPED)) {
+			delete_from_swap_cache(page);
+			free_page(page);
+		}
+		free_page(page);
+	}
+}
+
 /* table_ptrָҳȥ */
 static inline int try_to_swap_out(unsigned long * table_ptr)
 {
-	int i;
 	unsigned long page;
 	unsigned long entry;
 
@@ -282,15 +638,17 @@ static inline int try_to_swap_out(unsigned long * table_ptr)
 		return 0;
 	if (mem_map[MAP_NR(page)] & MAP_PAGE_RESERVED)
 		return 0;
+	reclaim_stat[RECLAIM_ANON].scan++;
 	if (PAGE_ACCESSED & page) {
 		*table_ptr &= ~PAGE_ACCESSED;
+		touch_page(page);
+		reclaim_stat[RECLAIM_ANON].young++;
+		return 0;
+	}
+	if (age_page(page)) {
+		reclaim_stat[RECLAIM_ANON].young++;
 		return 0;
 	}
-
-	/* ҳڴʱ32ڴ棬򲻽*/
-	for (i = 0; i < NR_LAST_FREE_PAGES; i++)
-		if (last_free_pages[i] == (page & PAGE_MASK))
-			return 0;
 
 	/* ҲģҳедеĽ,
 	 * ҳģֱӽҳͷŵӵ
@@ -300,6 +658,9 @@ static inline int try_to_swap_out(unsigned long * table_ptr)
 		page &= PAGE_MASK;
 		if (mem_map[MAP_NR(page)] != 1)
 			return 0;
+		/* dirtied by swapoff, which will drop the slot in a moment */
+		if (swap_cache[MAP_NR(page)])
+			return 0;
 		if (!(entry = get_swap_page()))
 			return 0;
 		/* עdo_no_pageлж϶ҳ
@@ -308,11 +669,19 @@ static inline int try_to_swap_out(unsigned long * table_ptr)
 		 */
 		*table_ptr = entry;
 		invalidate();
-		write_swap_page(entry, (char *) page);
-		free_page(page);
+		swap_batch_entry[swap_batch_nr] = entry;
+		swap_batch_page[swap_batch_nr++] = page;
 		return 1;
 	}
 	page &= PAGE_MASK;
+	/* swapped in and not written to since: the slot still has it */
+	if ((entry = swap_cache[MAP_NR(page)]) != 0) {
+		*table_ptr = swap_duplicate(entry);
+		invalidate();
+		free_page(page);
+		swap_writes_saved++;
+		return 1 + mem_map[MAP_NR(page)];
+	}
 	/* עһǳҪѽ̵ĶӦӦڴͷź
 	 * ҲӦĽҳֵҳΪ0ٴηʱ
 	 * ͻӳڴ 
@@ -368,10 +737,10 @@ static int swap_out(unsigned int priority)
     int page;
     long pg_table;
     int loop;
-    int counter = NR_TASKS * 2 >> priority;
+    int counter = nr_task_slots * 2 >> priority;
     struct task_struct *p;
 
-    counter = NR_TASKS * 2 >> priority;
+    counter = nr_task_slots * 2 >> priority;
 	/* ȼԽߣѭԵĴԽ */
     for(; counter >= 0; counter--, swap_task++) {
 	/*
@@ -380,7 +749,7 @@ static int swap_out(unsigned int priority)
 	 */
 		loop = 0;
 		while(1) {
-	    	if(swap_task >= NR_TASKS) {
+	    	if(swap_task >= nr_task_slots) {
 				swap_task = 1;
 				if(loop)
 		    		/* all processes are unswappable or already swapped out */
@@ -452,6 +821,10 @@ static int swap_out(unsigned int priority)
 						p->swap_page  = page + 1;
 						if((--p->swap_cnt) == 0)
 						    swap_task++;
+						/* a dirty page was only queued: gather some more */
+						else if (swap_batch_nr && swap_batch_nr < SWAP_CLUSTER)
+						    break;
+						swap_flush();
 						return 1;
 
 				    default:
@@ -467,6 +840,11 @@ static int swap_out(unsigned int priority)
 		 * directory.  Mark restart from the beginning the next time.
 		 */
 		p->swap_table = 0;
+		if (swap_batch_nr) {
+			swap_task++;
+			swap_flush();
+			return 1;
+		}
     }
     return 0;
 }
@@ -486,7 +864,7 @@ static int swap_out(unsigned int priority)
 	static int swap_task = 1;
 	static int swap_table = 0;
 	static int swap_page = 0;
-	int counter = NR_TASKS*8;
+	int counter = nr_task_slots*8;
 	int pg_table;
 	struct task_struct * p;
 
@@ -494,7 +872,7 @@ static int swap_out(unsigned int priority)
 check_task:
 	if (counter-- < 0)
 		return 0;
-	if (swap_task >= NR_TASKS) {
+	if (swap_task >= nr_task_slots) {
 		swap_task = 1;
 		goto check_task;
 	}
@@ -530,7 +908,7 @@ check_table:
 	}
 	switch (try_to_swap_out(swap_page + (unsigned long *) pg_table)) {
 		case 0: break;
-		case 1: p->rss--; return 1;
+		case 1: p->rss--; swap_flush(); return 1;
 		default: p->rss--;
 	}
 	swap_page++;
@@ -540,6 +918,32 @@ check_table:
 #endif
 
 
+/*
+ * Where try_to_free_page() starts looking: the source that gave it a
+ * page last time, so that it keeps taking from whatever has pages to
+ * spare and moves on to the next one when that runs dry.
+ */
+static int reclaim_next = RECLAIM_SWAP_CACHE;
+
+struct reclaim_stat reclaim_stat[NR_RECLAIM] = { {0,}, };
+
+static int shrink_source(int source, unsigned int priority)
+{
+	switch (source) {
+		case RECLAIM_SWAP_CACHE:
+			return shrink_swap_cache(priority);
+		case RECLAIM_PAGE_CACHE:
+			return shrink_page_cache(priority);
+		case RECLAIM_BUFFERS:
+			return shrink_buffers(priority);
+		case RECLAIM_SHM:
+			return shm_swap(priority);
+		case RECLAIM_ANON:
+			return swap_out(priority);
+	}
+	return 0;
+}
+
 /* úںͨ__get_free_pageڴʱ
  * ڴ治򽫲ڴ潻У
  * ע⽻ڴ˳
@@ -547,36 +951,121 @@ check_table:
 static int try_to_free_page(void)
 {
 	int i=6;
+	int n;
 
+	/* pages the object caches aren't using are the cheapest to get back */
+	if (kmem_cache_reap()) {
+		reclaim_stat[RECLAIM_SLAB].steal++;
+		return 1;
+	}
+	/* every source is asked once at each priority before the next */
 	while (i--) {
-		if (shrink_buffers(i))
-			return 1;
-		if (shm_swap(i))
-			return 1;
-		if (swap_out(i))
-			return 1;
+		for (n = RECLAIM_SWAP_CACHE ; n < NR_RECLAIM ; n++) {
+			if (shrink_source(reclaim_next, i)) {
+				reclaim_stat[reclaim_next].steal++;
+				return 1;
+			}
+			if (++reclaim_next >= NR_RECLAIM)
+				reclaim_next = RECLAIM_SWAP_CACHE;
+		}
 	}
 	return 0;
 }
 
+static char * reclaim_names[NR_RECLAIM] = {
+	"slab", "swapcache", "pagecache", "buffers", "shm", "anon"
+};
+
+/* Lines for /proc/meminfo */
+int get_reclaim_info(char * buffer)
+{
+	int i, len = 0;
+
+	for (i = 0 ; i < NR_RECLAIM ; i++)
+		len += sprintf(buffer + len,
+			"Reclaim:    %-9s %8lu scanned %8lu young %8lu stolen\n",
+			reclaim_names[i], reclaim_stat[i].scan,
+			reclaim_stat[i].young, reclaim_stat[i].steal);
+	return len;
+}
+
 /*
+ * Free memory is kept in buddy lists: free_area_list[order] holds blocks
+ * of 2^order pages, each aligned to its own size. Bit n of
+ * free_area_map[order] is set when exactly one of the two halves of
+ * block n of the next order up is free, so a single bit flip on
+ * free_pages() tells whether the buddy can be merged with.
+ *
  * Note that this must be atomic, or bad things will happen when
  * pages are requested in interrupts (as malloc can do). Thus the
  * cli/sti's.
  */
+struct mem_list {
+	struct mem_list * next;
+	struct mem_list * prev;
+};
+
+static struct mem_list free_area_list[NR_MEM_LISTS];
+static unsigned char * free_area_map[NR_MEM_LISTS];
+unsigned char * page_age = NULL;
 
-/* ַaddrӵҳ
+static inline void add_mem_queue(struct mem_list * head, struct mem_list * entry)
+{
+	entry->prev = head;
+	(entry->next = head->next)->prev = entry;
+	head->next = entry;
+}
+
+static inline void remove_mem_queue(struct mem_list * entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+}
+
+/*
+ * Called by mem_init() before any page is freed: empty lists, and the
+ * bitmaps and page_age[] are carved out of start_mem.
  */
-static inline void add_mem_queue(unsigned long addr, unsigned long * queue)
+unsigned long free_area_init(unsigned long start_mem, unsigned long end_mem)
 {
-	addr &= PAGE_MASK;
-	*(unsigned long *) addr = *queue;
-	*queue = addr;
+	int i;
+	unsigned long size;
+
+	for (i = 0 ; i < NR_MEM_LISTS ; i++) {
+		free_area_list[i].next = free_area_list[i].prev = free_area_list+i;
+		size = ((end_mem >> (PAGE_SHIFT + i + 1)) + 8) >> 3;
+		free_area_map[i] = (unsigned char *) start_mem;
+		memset((void *) start_mem, 0, size);
+		start_mem += size;
+	}
+	page_age = (unsigned char *) start_mem;
+	memset(page_age, 0, MAP_NR(end_mem));
+	return start_mem + MAP_NR(end_mem);
+}
+
+/* 2^orderҳĿŻػܺϲĻһֱϺϲ */
+static inline void free_pages_ok(unsigned long addr, unsigned long order)
+{
+	unsigned long index = MAP_NR(addr) >> (1 + order);
+	unsigned long mask = PAGE_MASK << order;
+
+	addr &= mask;
+	nr_free_pages += 1 << order;
+	while (order < NR_MEM_LISTS-1) {
+		if (!change_bit(index, free_area_map[order]))
+			break;		/* the buddy is in use */
+		remove_mem_queue((struct mem_list *) (addr ^ (1+~mask)));
+		order++;
+		index >>= 1;
+		mask <<= 1;
+		addr &= mask;
+	}
+	add_mem_queue(free_area_list+order, (struct mem_list *) addr);
 }
 
 /*
- * Free_page() adds the page to the free lists. This is optimized for
- * fast normal cases (no error jumps taken normally).
+ * Free_pages() puts the block back on the free lists. This is optimized
+ * for fast normal cases (no error jumps taken normally).
  *
  * The way to optimize jumps for gcc-2.2.2 is to:
  *  - select the "normal" case and put it inside the if () { XXX }
@@ -584,11 +1073,14 @@ static inline void add_mem_queue(unsigned long addr, unsigned long * queue)
  *
  * With the above two rules, you get a straight-line execution path
  * for the normal case, giving better asm-code.
+ *
+ * Only the first page of a block carries the reference count; the
+ * others are just marked in use while the block is allocated.
  */
 
 /* ͷڴҳmem_mapü1Ľü1
  **/
-void free_page(unsigned long addr)
+void free_pages(unsigned long addr, unsigned long order)
 {
 	if (addr < high_memory) {
 		unsigned short * map = mem_map + MAP_NR(addr);
@@ -596,32 +1088,20 @@ void free_page(unsigned long addr)
 		if (*map) {
 			/*Ǳҳͷ*/
 			if (!(*map & MAP_PAGE_RESERVED)) {
-				unsigned long flag;
-				/* ֳҲǱԭCPSRֵ
-				 * ȻٽֹжϣҪжʱֱrestore_flagsɣ
-				 * ȥжϵĹ
-				 */
+				unsigned long flag, entry = 0;
+				int i;
+
 				save_flags(flag);
 				cli();
-				/* ҳü0,ͷţֻͷŵʱŻС
-				 * ڴҳü
-				 */
 				if (!--*map) {
-					/* ϵͳҪһڴ棬ͷڴʱ
-					 * nr_secondary_pagesСMAX_SECONDARY_PAGES
-					 * 򽫿ҳӵsecondary_page_list
-					 */
-					if (nr_secondary_pages < MAX_SECONDARY_PAGES) {
-						add_mem_queue(addr,&secondary_page_list);
-						nr_secondary_pages++;
-						restore_flags(flag);
-						return;
-					}
-					/*ӵ*/
-					add_mem_queue(addr,&free_page_list);
-					nr_free_pages++;
+					for (i = 1 ; i < (1 << order) ; i++)
+						map[i] = 0;
+					if (swap_cache)
+						entry = unhash_swap_page(addr);
+					free_pages_ok(addr, order);
 				}
 				restore_flags(flag);
+				swap_free(entry);
 			}
 			return;
 		}
@@ -632,70 +1112,66 @@ void free_page(unsigned long addr)
 }
 
 /*
- * This is one ugly macro, but it simplifies checking, and makes
- * this speed-critical place reasonably fast, especially as we have
- * to do things with the interrupt flag etc.
- *
- * Note that this #define is heavily optimized to give fast code
- * for the normal case - the if-statements are ordered so that gcc-2.2.2
- * will make *no* jumps for the normal code. Don't touch unless you
- * know what you are doing.
+ * Take the first free block of at least 2^order pages, hand the unused
+ * upper halves back to the lower lists, and mark the pages in use.
+ * Called with interrupts off.
  */
+static unsigned long rmqueue(unsigned long order)
+{
+	struct mem_list * queue = free_area_list + order;
+	unsigned long new_order = order;
+	unsigned long addr, size;
 
-/* queueףnrп
- */
-#define REMOVE_FROM_MEM_QUEUE(queue,nr) \
-	cli(); \
-	/* ײΪNULL򽫵һҳ */
-	if ((result = queue) != 0) { \
-		/* ҳĵַһҪҳģҲܳϵͳǰڴ */
-		if (!(result & ~PAGE_MASK) && result < high_memory) { \
-			/* ƶײ */
-			queue = *(unsigned long *) result; \
-			/* Ҫжϸҳûбõ */
-			if (!mem_map[MAP_NR(result)]) { \
-				/* ÿҳüͬʱСҳ */
-				mem_map[MAP_NR(result)] = 1; \
-				nr--; \
-				/* ˴¼󱻷䵽ȥڴ棬ܹ¼32飬
-				 * ¼ԭǵϵͳڴԽʱὫһڴȥ
-				 * Ҫȥڴ󱻷ȥ32鵱У򲻻ᱻ
-				 * ȥȡڴĵȲԣΪձȥ
-				 * ҪȥȻǺܲģtry_to_swap_out
-				 */
-				last_free_pages[index = (index + 1) & (NR_LAST_FREE_PAGES - 1)] = result; \
-				restore_flags(flag); \
-				return result; \
-			} \
-			printk("Free page %08lx has mem_map = %d\n", \
-				result,mem_map[MAP_NR(result)]); \
-		} else \
-			printk("Result = 0x%08lx - memory map destroyed\n", result); \
-		queue = 0; \
-		nr = 0; \
-	} else if (nr) { \
-		printk(#nr " is %d, but " #queue " is empty\n",nr); \
-		nr = 0; \
-	} \
-	restore_flags(flag)
+	for ( ; new_order < NR_MEM_LISTS ; new_order++, queue++) {
+		if (queue->next == queue)
+			continue;
+		addr = (unsigned long) queue->next;
+		if (mem_map[MAP_NR(addr)]) {
+			printk("Free page %08lx has mem_map = %d\n",
+				addr,mem_map[MAP_NR(addr)]);
+			return 0;
+		}
+		remove_mem_queue(queue->next);
+		change_bit(MAP_NR(addr) >> (1 + new_order), free_area_map[new_order]);
+		nr_free_pages -= 1 << order;
+		size = PAGE_SIZE << new_order;
+		while (new_order > order) {
+			new_order--;
+			size >>= 1;
+			add_mem_queue(free_area_list+new_order, (struct mem_list *) (addr+size));
+			change_bit(MAP_NR(addr+size) >> (1 + new_order), free_area_map[new_order]);
+		}
+		for (size = 0 ; size < (1 << order) ; size++) {
+			mem_map[MAP_NR(addr) + size] = 1;
+			page_age[MAP_NR(addr) + size] = PAGE_AGE_INITIAL;
+		}
+		return addr;
+	}
+	return 0;
+}
 
 /*
- * Get physical address of first (actually last :-) free page, and mark it
- * used. If no free pages left, return 0.
+ * Get physical address of 2^order free pages, and mark them used. If
+ * there is no such block, return 0.
  *
  * Note that this is one of the most heavily called functions in the kernel,
  * so it's a bit timing-critical (especially as we have to disable interrupts
- * in it). See the above macro which does most of the work, and which is
- * optimized for a fast normal path of execution.
+ * in it).
+ *
+ * The last MAX_SECONDARY_PAGES free pages are a reserve for allocations
+ * that cannot wait (or that waited and still failed), like the separate
+ * secondary list used to be. Freeing pages one at a time won't always
+ * produce a large enough block, so multi-page requests only try a
+ * bounded number of times.
  */
 /* עúصҳеݲû0
   * עget_free_page
   */
-unsigned long __get_free_page(int priority)
+unsigned long __get_free_pages(int priority, unsigned long order)
 {
 	extern unsigned long intr_count;
 	unsigned long result, flag;
-	static unsigned long index = 0;
+	int tries = 8 << order;
 
 	/* this routine can be called at interrupt time via
 	   malloc.  We want to make sure that the critical
@@ -707,20 +1183,30 @@ unsigned long __get_free_page(int priority)
 			((unsigned long *)&priority)[-1]);
 		priority = GFP_ATOMIC;
 	}
+	if (order >= NR_MEM_LISTS)
+		return 0;
 	save_flags(flag);
 repeat:
-	REMOVE_FROM_MEM_QUEUE(free_page_list,nr_free_pages);
+	cli();
+	if (nr_free_pages >= MAX_SECONDARY_PAGES + (1 << order) &&
+	    (result = rmqueue(order)) != 0) {
+		restore_flags(flag);
+		return result;
+	}
+	restore_flags(flag);
 	if (priority == GFP_BUFFER)
 		return 0;
 	/* ԭǲܱģ紦жϺٽʱ,
-	 * û㹻Ŀҳֱӷʧ
+	 * û㹻Ŀҳֱʹñҳ
 	 */
-	if (priority != GFP_ATOMIC)
+	if (priority != GFP_ATOMIC && (!order || tries-- > 0))
 		/*ܲͷһЩ棬ͷųɹ*/
 		if (try_to_free_page())
 			goto repeat;
-	REMOVE_FROM_MEM_QUEUE(secondary_page_list,nr_secondary_pages);
-	return 0;
+	cli();
+	result = rmqueue(order);
+	restore_flags(flag);
+	return result;
 }
 
 /*
@@ -741,7 +1227,7 @@ static int try_to_unuse(unsigned int type)
  * task we stopped in. That at least rids us of all races.
  */
 repeat:
-	for (; nr < NR_TASKS ; nr++) {
+	for (; nr < nr_task_slots ; nr++) {
 		p = task[nr];
 		if (!p)
 			continue;
@@ -759,8 +1245,14 @@ repeat:
 				page = *ppage;
 				if (!page)
 					continue;
-				if (page & PAGE_PRESENT)
+				if (page & PAGE_PRESENT) {
+					/* swapped in and clean: the slot goes below */
+					if (page < high_memory &&
+					    swap_cache[MAP_NR(page)] &&
+					    SWP_TYPE(swap_cache[MAP_NR(page)]) == type)
+						*ppage |= PAGE_DIRTY;
 					continue;
+				}
 				if (SWP_TYPE(page) != type)
 					continue;
 				if (!tmp) {
@@ -780,6 +1272,12 @@ repeat:
 		}
 	}
 	free_page(tmp);
+	/* the pages are dirty now, the cache can let go of their slots */
+	for (nr = MAP_NR(high_memory) ; nr-- > 0 ; ) {
+		page = swap_cache[nr];
+		if (page && !(page & SWAP_CACHE_UNMAPPED) && SWP_TYPE(page) == type)
+			swap_cache_dirty(nr << PAGE_SHIFT);
+	}
 	return 0;
 }
 
@@ -865,6 +1363,8 @@ asmlinkage int sys_swapon(const char * specialfile)
 	p->swap_lockmap = NULL;
 	p->lowest_bit = 0;
 	p->highest_bit = 0;
+	p->cluster_next = 0;
+	p->cluster_nr = 0;
 	/* ˴1ڶȡʱȡ0*/
 	p->max = 1;
 	/* ȡ·Ӧļinode */
@@ -115,19 +115,45 @@ static struct {
 #define	ARP_MAX_TYPE	(sizeof(arp_types) / sizeof(arp_types[0]))
 
 
-struct arp_table *arp_tables[ARP_TABLE_SIZE] = {
+/*
+ * The cache starts as ARP_TABLE_SIZE buckets and doubles (up to
+ * ARP_TABLE_MAX) whenever it holds twice as many entries as buckets.
+ * All entries are also on a circular LRU list, least recently used
+ * first; past ARP_MAX_ENTRIES the oldest one that isn't permanent is
+ * recycled.
+ *
+ * An entry without ATF_COM is waiting for a reply. The packets that
+ * need the address wait on the entry itself and go out as soon as
+ * arp_rcv() fills it in; arp_timer only resends requests for such
+ * entries, and gives up on them after ARP_MAX_TRIES.
+ */
+static struct arp_table *arp_table_init[ARP_TABLE_SIZE] = {
   NULL,
 };
+static struct arp_table **arp_tables = arp_table_init;
+static int arp_hash_size = ARP_TABLE_SIZE;
+static int arp_count = 0;			/* еı */
+static struct arp_table *arp_lru = NULL;	/* ûʹõı */
+
+#define arp_hashfn(paddr)	(htonl(paddr) & (arp_hash_size - 1))
+
+/* Statistics, for /proc/net/arp_stat. */
+static unsigned long arp_hits = 0;		/* arp_find()ֱҵ˵ַ */
+static unsigned long arp_misses = 0;
+static unsigned long arp_requests = 0;		/*  */
+static unsigned long arp_resolved = 0;		/* ȴıյӦ */
+static unsigned long arp_failed = 0;		/* ARP_MAX_TRIESκ */
+static unsigned long arp_evicted = 0;		/* Ϊ±λ */
+static unsigned long arp_queued = 0;		/* ȴַݰ */
+static unsigned long arp_q_drops = 0;
 
 static int arp_proxies=0;	/* So we can avoid the proxy arp 
 				   overhead with the usual case of
 				   no proxy arps */
 
-/* յarp */
-struct sk_buff * volatile arp_q = NULL;
-
 static struct arp_table *arp_lookup(unsigned long addr);
 static struct arp_table *arp_lookup_proxy(unsigned long addr);
+void arp_send(unsigned long paddr, struct device *dev, unsigned long saddr);
 
 /* Dump the ADDRESS bytes of an unknown hardware type. */
 static char *
@@ -200,80 +226,154 @@ arp_print(struct arphdr *arp)
 }
 
 
-/* This will try to retransmit everything on the queue. */
+/* The least recently used entry is arp_lru, the most recent arp_lru->lru_prev. */
+static inline void arp_lru_remove(struct arp_table *apt)
+{
+  apt->lru_next->lru_prev = apt->lru_prev;
+  apt->lru_prev->lru_next = apt->lru_next;
+  if (arp_lru == apt)
+	arp_lru = apt->lru_next;
+  if (arp_lru == apt)
+	arp_lru = NULL;
+}
+
+static inline void arp_lru_add(struct arp_table *apt)
+{
+  if (!arp_lru) {
+	arp_lru = apt->lru_next = apt->lru_prev = apt;
+	return;
+  }
+  apt->lru_next = arp_lru;
+  apt->lru_prev = arp_lru->lru_prev;
+  arp_lru->lru_prev->lru_next = apt;
+  arp_lru->lru_prev = apt;
+}
+
+/* ʹˣƵLRUβʱжѹر */
+static inline void arp_touch(struct arp_table *apt)
+{
+  apt->last_used = jiffies;
+  arp_lru_remove(apt);
+  arp_lru_add(apt);
+}
+
+
+/*
+ * Give up on a packet waiting for an address. If free was 0, magic is
+ * now 0, next is 0 and the write queue will notice and kill.
+ */
+static void arp_drop_skb(struct sk_buff *skb)
+{
+  skb->magic = 0;
+  skb->next = NULL;
+  skb->prev = NULL;
+  skb->sk = NULL;
+  if(skb->free)
+	kfree_skb(skb, FREE_WRITE);
+  arp_q_drops++;
+}
+
+
+/* The address of apt is known now: send everything waiting on it. */
 static void
-arp_send_q(void)
+arp_send_q(struct arp_table *apt)
 {
   struct sk_buff *skb;
-  struct sk_buff *volatile work_q;
-  cli();
-  work_q = arp_q;
-  /* headΪarp_q */
-  skb_new_list_head(&work_q);
-  arp_q = NULL;
-  sti();
-  while((skb=skb_dequeue(&work_q))!=NULL)
+
+  while((skb=skb_dequeue(&apt->queue))!=NULL)
   {
   	IS_SKB(skb);
 	skb->magic = 0;
 	skb->next = NULL;
 	skb->prev = NULL;
+	apt->qlen--;
 
-	/* Decrement the 'tries' counter. */
-	cli();
-	skb->tries--;
-	if (skb->tries == 0) {
-		/*
-		 * Grmpf.
-		 * We have tried ARP_MAX_TRIES to resolve the IP address
-		 * from this datagram.  This means that the machine does
-		 * not listen to our ARP requests.  Perhaps someone tur-
-		 * ned off the thing?
-		 * In any case, trying further is useless.  So, we kill
-		 * this packet from the queue.  (grinnik) -FvK
-		 */
-		skb->sk = NULL;
-		if(skb->free)
-			kfree_skb(skb, FREE_WRITE);
-			/* If free was 0, magic is now 0, next is 0 and 
-			   the write queue will notice and kill */
-		sti();
-		continue;
-	}
-
-	/* Can we now complete this packet? */
-	sti();
 	if (skb->arp || !skb->dev->rebuild_header(skb->data, skb->dev)) {
 		skb->arp  = 1;
 		skb->dev->queue_xmit(skb, skb->dev, 0);
-	} else {
-		/* Alas.  Re-queue it... */
-		skb->magic = ARP_QUEUE_MAGIC;      
-		skb_queue_head(&arp_q,skb);
-	}
+	} else
+		arp_drop_skb(skb);
   }
 }
 
 
+/* Unhash, unqueue and free *lapt. Called with interrupts off. */
+static void arp_free_entry(struct arp_table **lapt)
+{
+  struct arp_table *apt = *lapt;
+  struct sk_buff *skb;
+
+  *lapt = apt->next;
+  arp_lru_remove(apt);
+  arp_count--;
+  if(apt->flags&ATF_PUBL)
+	arp_proxies--;
+  while((skb=skb_dequeue(&apt->queue))!=NULL)
+	arp_drop_skb(skb);
+  kfree_s(apt, sizeof(struct arp_table));
+}
+
+
 static struct timer_list arp_timer;
+static int arp_timer_armed = 0;
 
 static void arp_queue_ticker(unsigned long data);
 
-/* ʱӣʱӵĻصΪarp_queue_ticker */
+/*
+ * ʱӣʱӵĻصΪarp_queue_tickerѾߵʱӲƳ٣
+ * 򲻶µδַʱȵȵЩԶòط
+ */
 static void arp_queue_kick(void)
 {
-	arp_timer.expires = 500;	/* 5 seconds */
-	arp_timer.data = 0;
-	arp_timer.function = arp_queue_ticker;
-	del_timer(&arp_timer);
-	add_timer(&arp_timer);
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	if (!arp_timer_armed) {
+		arp_timer_armed = 1;
+		arp_timer.expires = 500;	/* 5 seconds */
+		arp_timer.data = 0;
+		arp_timer.function = arp_queue_ticker;
+		add_timer(&arp_timer);
+	}
+	restore_flags(flags);
 }
 
+/*
+ * Ask again for every address we are still waiting for, and drop the
+ * ones that have had ARP_MAX_TRIES requests and no answer: the machine
+ * doesn't listen to our ARP requests, perhaps someone turned off the
+ * thing, and trying further is useless.
+ */
 static void arp_queue_ticker(unsigned long data/*UNUSED*/)
 {
-	arp_send_q();
-	if (skb_peek(&arp_q))
+	struct arp_table *apt, **lapt;
+	unsigned long flags;
+	int i, waiting = 0;
+
+	save_flags(flags);
+	cli();
+	arp_timer_armed = 0;
+	for (i = 0; i < arp_hash_size; i++) {
+		lapt = &arp_tables[i];
+		while ((apt = *lapt) != NULL) {
+			if (apt->flags & ATF_COM) {
+				lapt = &apt->next;
+				continue;
+			}
+			if (--apt->tries == 0 || apt->dev == NULL) {
+				arp_failed++;
+				arp_free_entry(lapt);
+				continue;
+			}
+			arp_send(apt->ip, apt->dev, apt->dev->pa_addr);
+			waiting = 1;
+			lapt = &apt->next;
+		}
+	}
+	if (waiting)
 		arp_queue_kick();
+	restore_flags(flags);
 }
 
 
@@ -364,7 +464,7 @@ static struct arp_table *
 arp_lookup(unsigned long paddr)
 {
   struct arp_table *apt;
-  unsigned long hash;
+  unsigned long hash, flags;
 
   DPRINTF((DBG_ARP, "ARP: lookup(%s)\n", in_ntoa(paddr)));
 
@@ -375,18 +475,17 @@ arp_lookup(unsigned long paddr)
   }
 
   /* Loop through the table for the desired address. */
-  hash = htonl(paddr) & (ARP_TABLE_SIZE - 1);
+  save_flags(flags);
   cli();
+  hash = arp_hashfn(paddr);
   apt = arp_tables[hash];
   while(apt != NULL) {
-	if (apt->ip == paddr) {
-		sti();
-		return(apt);
-	}
+	if (apt->ip == paddr)
+		break;
 	apt = apt->next;
   }
-  sti();
-  return(NULL);
+  restore_flags(flags);
+  return(apt);
 }
 
 
@@ -394,23 +493,22 @@ arp_lookup(unsigned long paddr)
 static struct arp_table *arp_lookup_proxy(unsigned long paddr)
 {
   struct arp_table *apt;
-  unsigned long hash;
+  unsigned long hash, flags;
 
   DPRINTF((DBG_ARP, "ARP: lookup proxy(%s)\n", in_ntoa(paddr)));
 
   /* Loop through the table for the desired address. */
-  hash = htonl(paddr) & (ARP_TABLE_SIZE - 1);
+  save_flags(flags);
   cli();
+  hash = arp_hashfn(paddr);
   apt = arp_tables[hash];
   while(apt != NULL) {
-	if (apt->ip == paddr && (apt->flags & ATF_PUBL) ) {
-		sti();
-		return(apt);
-	}
+	if (apt->ip == paddr && (apt->flags & ATF_PUBL) )
+		break;
 	apt = apt->next;
   }
-  sti();
-  return(NULL);
+  restore_flags(flags);
+  return(apt);
 }
 
 
@@ -420,7 +518,7 @@ arp_destructor(unsigned long paddr, int force)
 {
   struct arp_table *apt;
   struct arp_table **lapt;
-  unsigned long hash;
+  unsigned long flags;
 
   DPRINTF((DBG_ARP, "ARP: destroy(%s)\n", in_ntoa(paddr)));
 
@@ -430,24 +528,19 @@ arp_destructor(unsigned long paddr, int force)
 							in_ntoa(paddr)));
 	return;
   }
-  hash = htonl(paddr) & (ARP_TABLE_SIZE - 1);
 
+  save_flags(flags);
   cli();
-  lapt = &arp_tables[hash];
+  lapt = &arp_tables[arp_hashfn(paddr)];
   while ((apt = *lapt) != NULL) {
 	if (apt->ip == paddr) {
-		if((apt->flags&ATF_PERM) && !force)
-			return;
-		*lapt = apt->next;
-		if(apt->flags&ATF_PUBL)
-			arp_proxies--;			
-		kfree_s(apt, sizeof(struct arp_table));
-		sti();
-		return;
+		if(!(apt->flags&ATF_PERM) || force)
+			arp_free_entry(lapt);
+		break;
 	}
 	lapt = &apt->next;
   }
-  sti();
+  restore_flags(flags);
 }
 
 /*
@@ -468,17 +561,69 @@ void arp_destroy_maybe(unsigned long paddr)
 	arp_destructor(paddr,0);
 }
 
-/* Create an ARP entry.  The caller should check for duplicates! */
+/* Double the hash table. Called with interrupts off. */
+static void arp_grow(void)
+{
+  struct arp_table **table, *apt, *next;
+  int i, old_size = arp_hash_size;
+
+  table = (struct arp_table **) kmalloc(2 * old_size * sizeof(struct arp_table *),
+					GFP_ATOMIC);
+  if (table == NULL)
+	return;
+  memset(table, 0, 2 * old_size * sizeof(struct arp_table *));
+  arp_hash_size = 2 * old_size;
+  for (i = 0; i < old_size; i++) {
+	for (apt = arp_tables[i]; apt != NULL; apt = next) {
+		next = apt->next;
+		apt->next = table[arp_hashfn(apt->ip)];
+		table[arp_hashfn(apt->ip)] = apt;
+	}
+  }
+  if (arp_tables != arp_table_init)
+	kfree_s(arp_tables, old_size * sizeof(struct arp_table *));
+  arp_tables = table;
+}
+
+/* Make room by dropping the least recently used entry we may drop. */
+static void arp_evict(void)
+{
+  struct arp_table *apt, **lapt;
+
+  if ((apt = arp_lru) == NULL)
+	return;
+  while (apt->flags & (ATF_PERM | ATF_PUBL)) {
+	apt = apt->lru_next;
+	if (apt == arp_lru)
+		return;
+  }
+  for (lapt = &arp_tables[arp_hashfn(apt->ip)]; *lapt != apt; lapt = &(*lapt)->next)
+	;
+  arp_free_entry(lapt);
+  arp_evicted++;
+}
+
+/*
+ * Create an ARP entry.  The caller should check for duplicates!
+ * addr == NULL makes an entry that is still waiting for its reply.
+ */
 static struct arp_table *
-arp_create(unsigned long paddr, unsigned char *addr, int hlen, int htype)
+arp_create(unsigned long paddr, unsigned char *addr, int hlen, int htype,
+	   struct device *dev)
 {
   struct arp_table *apt;
-  unsigned long hash;
+  unsigned long hash, flags;
 
   DPRINTF((DBG_ARP, "ARP: create(%s, ", in_ntoa(paddr)));
-  DPRINTF((DBG_ARP, "%s, ", eth_print(addr)));
+  DPRINTF((DBG_ARP, "%s, ", addr ? eth_print(addr) : "?"));
   DPRINTF((DBG_ARP, "%d, %d)\n", hlen, htype));
 
+  save_flags(flags);
+  cli();
+  if (arp_count >= ARP_MAX_ENTRIES)
+	arp_evict();
+  restore_flags(flags);
+
   apt = (struct arp_table *) kmalloc(sizeof(struct arp_table), GFP_ATOMIC);
   if (apt == NULL) {
 	printk("ARP: no memory available for new ARP entry!\n");
@@ -486,21 +631,56 @@ arp_create(unsigned long paddr, unsigned char *addr, int hlen, int htype)
   }
 
   /* Fill in the allocated ARP cache entry. */
-  hash = htonl(paddr) & (ARP_TABLE_SIZE - 1);
   apt->ip = paddr;
-  apt->hlen = hlen;
   apt->htype = htype;
-  apt->flags = (ATF_INUSE | ATF_COM);		/* USED and COMPLETED entry */
-  memcpy(apt->ha, addr, hlen);
+  apt->dev = dev;
+  apt->queue = NULL;
+  apt->qlen = 0;
+  apt->tries = ARP_MAX_TRIES;
+  if (addr != NULL) {
+	apt->hlen = hlen;
+	apt->flags = (ATF_INUSE | ATF_COM);	/* USED and COMPLETED entry */
+	memcpy(apt->ha, addr, hlen);
+  } else {
+	apt->hlen = 0;
+	apt->flags = ATF_INUSE;
+	memset(apt->ha, 0, MAX_ADDR_LEN);
+  }
   apt->last_used = jiffies;
   cli();
+  if (arp_count >= 2 * arp_hash_size && arp_hash_size < ARP_TABLE_MAX)
+	arp_grow();
+  hash = arp_hashfn(paddr);
   apt->next = arp_tables[hash];
   arp_tables[hash] = apt;
-  sti();
+  arp_lru_add(apt);
+  arp_count++;
+  restore_flags(flags);
   return(apt);
 }
 
 
+/* A reply (or an update) gave us the hardware address for apt. */
+static void arp_complete(struct arp_table *apt, unsigned char *ha, int hlen)
+{
+  unsigned long flags;
+
+  save_flags(flags);
+  cli();
+  memcpy(apt->ha, ha, hlen);
+  apt->hlen = hlen;
+  arp_touch(apt);
+  if (apt->flags & ATF_COM) {
+	restore_flags(flags);
+	return;
+  }
+  apt->flags |= ATF_COM;
+  arp_resolved++;
+  restore_flags(flags);
+  arp_send_q(apt);
+}
+
+
 /*
  * An ARP REQUEST packet has arrived.
  * We try to be smart here, and fetch the data of the sender of the
@@ -551,17 +731,15 @@ arp_rcv(struct sk_buff *skb, struct device *dev, struct packet_type *pt)
   tbl = arp_lookup(src);
   if (tbl != NULL) {
 	DPRINTF((DBG_ARP, "ARP: udating entry for %s\n", in_ntoa(src)));
-	memcpy(tbl->ha, ptr, arp->ar_hln);
-	tbl->hlen = arp->ar_hln;
-	tbl->flags |= ATF_COM;
-	tbl->last_used = jiffies;
+	/* ݰڵַھͷȥ */
+	arp_complete(tbl, ptr, arp->ar_hln);
   } else {
 	memcpy(&dst, ptr + (arp->ar_hln * 2) + arp->ar_pln, arp->ar_pln);
 	if (chk_addr(dst) != IS_MYADDR && arp_proxies == 0) {
 		kfree_skb(skb, FREE_READ);
 		return(0);
 	} else {
-		tbl = arp_create(src, ptr, arp->ar_hln, arp->ar_hrd);
+		tbl = arp_create(src, ptr, arp->ar_hln, arp->ar_hrd, dev);
 		if (tbl == NULL) {
 			kfree_skb(skb, FREE_READ);
 			return(0);
@@ -569,13 +747,6 @@ arp_rcv(struct sk_buff *skb, struct device *dev, struct packet_type *pt)
 	}
   }
 
-  /*
-   * Since we updated the ARP cache, we might have enough
-   * information to send out some previously queued IP
-   * datagrams....
-   */
-  arp_send_q();
-
   /*
    * OK, we used that part of the info.  Now check if the
    * request was an ARP REQUEST for one of our own addresses..
@@ -671,6 +842,7 @@ arp_send(unsigned long paddr, struct device *dev, unsigned long saddr)
 
   DPRINTF((DBG_ARP, ">>\n"));
   arp_print(arp);
+  arp_requests++;
   dev->queue_xmit(skb, dev, 0);
 }
 
@@ -681,6 +853,7 @@ arp_find(unsigned char *haddr, unsigned long paddr, struct device *dev,
 	   unsigned long saddr)
 {
   struct arp_table *apt;
+  unsigned long flags;
 
   DPRINTF((DBG_ARP, "ARP: find(haddr=%s, ", eth_print(haddr)));
   DPRINTF((DBG_ARP, "paddr=%s, ", in_ntoa(paddr)));
@@ -695,6 +868,8 @@ arp_find(unsigned char *haddr, unsigned long paddr, struct device *dev,
 		return(0);
   }
 		
+  save_flags(flags);
+  cli();
   apt = arp_lookup(paddr);
   if (apt != NULL) {
 	/*
@@ -704,14 +879,17 @@ arp_find(unsigned char *haddr, unsigned long paddr, struct device *dev,
 	 */
         if ((apt->flags & ATF_PERM) ||
 	    (apt->last_used < jiffies+ARP_TIMEOUT && apt->hlen != 0)) {
-		apt->last_used = jiffies;
+		arp_touch(apt);
 		memcpy(haddr, apt->ha, dev->addr_len);
+		arp_hits++;
+		restore_flags(flags);
 		return(0);
 	} else {
 		DPRINTF((DBG_ARP, "ARP: find: found expired entry for %s\n",
 							in_ntoa(apt->ip)));
 	}
   }
+  arp_misses++;
 
   /*
    * This assume haddr are at least 4 bytes.
@@ -720,7 +898,18 @@ arp_find(unsigned char *haddr, unsigned long paddr, struct device *dev,
    */
   *(unsigned long *)haddr = paddr;
 
-  /* If we didn't find an entry, we will try to send an ARP packet. */
+  /*
+   * If a request is already out, the packet just waits on the entry
+   * (arp_queue()) and arp_timer does the asking again. Otherwise make
+   * an entry for it to wait on and send an ARP packet.
+   */
+  if (apt != NULL && !(apt->flags & ATF_COM)) {
+	restore_flags(flags);
+	return(1);
+  }
+  if (apt == NULL && arp_create(paddr, NULL, 0, dev->type, dev) != NULL)
+	arp_queue_kick();
+  restore_flags(flags);
   arp_send(paddr, dev, saddr);
 
   return(1);
@@ -747,11 +936,10 @@ arp_add(unsigned long addr, unsigned char *haddr, struct device *dev)
   apt = arp_lookup(addr);
   if (apt != NULL) {
 	DPRINTF((DBG_ARP, "ARP: updating entry for %s\n", in_ntoa(addr)));
-	apt->last_used = jiffies;
-	memcpy(apt->ha, haddr , dev->addr_len);
+	arp_complete(apt, haddr, dev->addr_len);
 	return;
   }
-  arp_create(addr, haddr, dev->addr_len, dev->type);
+  arp_create(addr, haddr, dev->addr_len, dev->type, dev);
 }
 
 
@@ -769,23 +957,41 @@ arp_add_broad(unsigned long addr, struct device *dev)
 }
 
 
-/* Queue an IP packet, while waiting for the ARP reply packet. */
+/*
+ * Queue an IP packet, while waiting for the ARP reply packet. It waits
+ * on the entry arp_find() made for its next hop (skb->raddr, set by
+ * ip_send()).
+ */
 void
 arp_queue(struct sk_buff *skb)
 {
-  cli();
-  skb->tries = ARP_MAX_TRIES;
+  struct arp_table *apt;
+  unsigned long flags;
 
+  save_flags(flags);
+  cli();
   if (skb->next != NULL) {
-	sti();
+	restore_flags(flags);
 	printk("ARP: arp_queue skb already on queue magic=%X.\n", skb->magic);
 	return;
   }
-  if(arp_q==NULL)
-  	arp_queue_kick();
-  skb_queue_tail(&arp_q,skb);
+  apt = skb->raddr ? arp_lookup(skb->raddr) : NULL;
+  if (apt == NULL || apt->qlen >= ARP_MAX_QUEUE) {
+	arp_drop_skb(skb);
+	restore_flags(flags);
+	return;
+  }
+  skb_queue_tail(&apt->queue,skb);
   skb->magic = ARP_QUEUE_MAGIC;
-  sti();
+  apt->qlen++;
+  arp_queued++;
+  /* The reply may have come in since rebuild_header() failed. */
+  if (!(apt->flags & ATF_COM)) {
+	restore_flags(flags);
+	return;
+  }
+  restore_flags(flags);
+  arp_send_q(apt);
 }
 
 
@@ -815,7 +1021,7 @@ arp_get_info(char *buffer)
   /* Loop over the ARP table and copy structures to the buffer. */
   pos = buffer;
   i = 0;
-  for (i = 0; i < ARP_TABLE_SIZE; i++) {
+  for (i = 0; i < arp_hash_size; i++) {
 	cli();
 	apt = arp_tables[i];
 	sti();
@@ -840,6 +1046,20 @@ arp_get_info(char *buffer)
 }
 
 
+/* /proc/net/arp is an array of struct arpreq, so the counters get their own file. */
+int
+arp_stat_get_info(char *buffer)
+{
+  return sprintf(buffer,
+	"entries %d buckets %d\n"
+	"hits %lu misses %lu requests %lu resolved %lu failed %lu evicted %lu\n"
+	"queued %lu dropped %lu\n",
+	arp_count, arp_hash_size,
+	arp_hits, arp_misses, arp_requests, arp_resolved, arp_failed, arp_evicted,
+	arp_queued, arp_q_drops);
+}
+
+
 /* Set (create) an ARP cache entry. */
 static int
 arp_req_set(struct arpreq *req)
@@ -882,14 +1102,13 @@ arp_req_set(struct arpreq *req)
   apt = arp_lookup(si->sin_addr.s_addr);
   if (apt == NULL) {
 	apt = arp_create(si->sin_addr.s_addr,
-		(unsigned char *) r.arp_ha.sa_data, hlen, htype);
+		(unsigned char *) r.arp_ha.sa_data, hlen, htype, NULL);
 	if (apt == NULL) return(-ENOMEM);
   }
 
   /* We now have a pointer to an ARP entry.  Update it! */
-  memcpy((char *) &apt->ha, (char *) &r.arp_ha.sa_data, hlen);
-  apt->last_used = jiffies;
-  apt->flags = r.arp_flags;
+  arp_complete(apt, (unsigned char *) r.arp_ha.sa_data, hlen);
+  apt->flags = r.arp_flags | ATF_COM;
   if(apt->flags&ATF_PUBL)
   	arp_proxies++;		/* Count proxy arps so we know if to use it */
 
@@ -18,7 +18,10 @@
 #ifndef _ARP_H
 #define _ARP_H
 
-#define ARP_TABLE_SIZE	16		/* size of ARP table		*/
+#define ARP_TABLE_SIZE	16		/* initial size of ARP table	*/
+#define ARP_TABLE_MAX	512		/* largest size of ARP table	*/
+#define ARP_MAX_ENTRIES	1024		/* recycle LRU entries past this */
+#define ARP_MAX_QUEUE	8		/* packets waiting per address	*/
 #define ARP_TIMEOUT	30000		/* five minutes			*/
 #define ARP_RES_TIME	250		/* 2.5 seconds			*/
 
@@ -31,6 +34,7 @@
 /* arpҲarp */
 struct arp_table {
   struct arp_table		*next;
+  struct arp_table		*lru_next, *lru_prev;
   /* ¼ϴαʹõʱ */
   volatile unsigned long	last_used;
   unsigned int			flags;
@@ -44,13 +48,14 @@ struct arp_table {
   unsigned char			ha[MAX_ADDR_LEN];  /* Ӳַ */
   unsigned char			hlen;              /* Ӳַ */
   unsigned char			htype;             /* Ӳ */
+  /* ûATF_COM־ıڵȴӦ */
+  unsigned char			tries;             /* ٷ */
+  unsigned char			qlen;
+  struct device			*dev;              /* ĸ豸 */
+  struct sk_buff * volatile	queue;             /* ȴַݰ */
 };
 
 
-/* This is also used in "sock.c" and "tcp.c" - YUCK! - FvK */
-extern struct sk_buff *arp_q;
-
-
 extern void	arp_destroy(unsigned long paddr);
 extern int	arp_rcv(struct sk_buff *skb, struct device *dev,
 			struct packet_type *pt);
@@ -61,6 +66,7 @@ extern void	arp_add(unsigned long addr, unsigned char *haddr,
 extern void	arp_add_broad(unsigned long addr, struct device *dev);
 extern void	arp_queue(struct sk_buff *skb);
 extern int	arp_get_info(char *buffer);
+extern int	arp_stat_get_info(char *buffer);
 extern int	arp_ioctl(unsigned int cmd, void *arg);
 extern void	arp_destroy_maybe(unsigned long paddr);
 
@@ -137,8 +137,15 @@ static struct packet_type ip_packet_type = {
 /* */
 struct packet_type *ptype_base = &ip_packet_type;
 
-/* ȫݰУһоstruct sockеback_log  */
-static struct sk_buff *volatile backlog = NULL;
+/*
+ * Received frames wait on their device's rx_queue. backlog is how many
+ * there are over all devices; past NET_RX_BACKLOG we drop everything
+ * (rx_throttle) until inet_bh() has caught up completely.
+ */
+static volatile int backlog = 0;
+static int rx_throttle = 0;
+/* ѯģʽ豸 */
+static struct device *poll_list = NULL;
 static unsigned long ip_bcast = 0;
 
 
@@ -492,26 +499,82 @@ dev_queue_xmit(struct sk_buff *skb, struct device *dev, int pri)
 
 /*
  * Receive a packet from a device driver and queue it for the upper
- * (protocol) levels.  It always succeeds.
+ * (protocol) levels.  If the backlog is too long the packet is
+ * dropped, and counted in the device's rx_dropped.
  */
 
-/*  netif_rx յݰڸö
+/*  netif_rx յݰ豸rx_queue
   */
 void
 netif_rx(struct sk_buff *skb)
 {
+  struct device *dev = skb->dev;
+  unsigned long flags;
+
   /* Set any necessary flags. */
   skb->sk = NULL;
   skb->free = 1;
-  
-  /* and add it to the "backlog" queue. */
   IS_SKB(skb);
-  skb_queue_tail(&backlog,skb);
-   
+
+  save_flags(flags);
+  cli();
+  if (!rx_throttle && backlog >= NET_RX_BACKLOG) {
+	rx_throttle = 1;
+	printk("INET: receive backlog full, dropping packets.\n");
+  }
+  if (rx_throttle) {
+	dev->rx_dropped++;
+	restore_flags(flags);
+	kfree_skb(skb, FREE_READ);
+	return;
+  }
+
+  /* and add it to the device's queue. */
+  skb_queue_tail(&dev->rx_queue,skb);
+  dev->rx_qlen++;
+  backlog++;
+  restore_flags(flags);
+
   /* If any packet arrived, mark it for processing. */
-  if (backlog != NULL) mark_bh(INET_BH);
+  mark_bh(INET_BH);
+}
 
-  return;
+
+/* Switch dev to polling, see struct device. */
+void
+netif_rx_schedule(struct device *dev)
+{
+  unsigned long flags;
+
+  save_flags(flags);
+  cli();
+  if (!dev->rx_polling) {
+	dev->rx_polling = 1;
+	dev->poll_next = poll_list;
+	poll_list = dev;
+  }
+  restore_flags(flags);
+  mark_bh(INET_BH);
+}
+
+
+/* The driver's ring is empty: back to interrupts. */
+void
+netif_rx_complete(struct device *dev)
+{
+  struct device **dp;
+  unsigned long flags;
+
+  save_flags(flags);
+  cli();
+  for (dp = &poll_list; *dp != NULL; dp = &(*dp)->poll_next) {
+	if (*dp == dev) {
+		*dp = dev->poll_next;
+		dev->rx_polling = 0;
+		break;
+	}
+  }
+  restore_flags(flags);
 }
 
 
@@ -528,7 +591,6 @@ netif_rx(struct sk_buff *skb)
 int
 dev_rint(unsigned char *buff, long len, int flags, struct device *dev)
 {
-  static int dropping = 0;
   struct sk_buff *skb = NULL;
   unsigned char *to;
   int amount, left;
@@ -538,18 +600,20 @@ dev_rint(unsigned char *buff, long len, int flags, struct device *dev)
   if (flags & IN_SKBUFF) {
 	skb = (struct sk_buff *) buff;
   } else {
-	if (dropping) {
-	  if (backlog != NULL)
-	      return(1);
-	  printk("INET: dev_rint: no longer dropping packets.\n");
-	  dropping = 0;
+	/* Don't copy a frame that netif_rx() would only throw away. */
+	if (rx_throttle) {
+		dev->rx_dropped++;
+		return(1);
 	}
 
 	skb = alloc_skb(sizeof(*skb) + len, GFP_ATOMIC);
 	if (skb == NULL) {
 		printk("dev_rint: packet dropped on %s (no memory) !\n",
 		       dev->name);
-		dropping = 1;
+		dev->rx_dropped++;
+		rx_throttle = 1;
+		/* only inet_bh() lifts the throttle, even with nothing queued */
+		mark_bh(INET_BH);
 		return(1);
 	}
 	skb->mem_len = sizeof(*skb) + len;
@@ -610,39 +674,24 @@ int in_inet_bh()	/* Used by timer.c */
  *
  */
 
-/* 豸°벿֣ͨ豸жеط */
-void
-inet_bh(void *tmp)
+/* Hand one received frame to every protocol that wants it. */
+static void
+net_rx_deliver(struct sk_buff *skb)
 {
-  struct sk_buff *skb;
   struct packet_type *ptype;
   unsigned short type;
   unsigned char flag = 0;
   int nitcount;
 
-  /* Atomically check and mark our BUSY state. */
-
-  /* ԭλΪ1ԭλΪ1ֱӷ */
-  if (set_bit(1, (void*)&in_bh))
-      return;
-
-  /* Can we send anything now? */
-  dev_transmit();
-  
-  /* Any data left to process? */
-  while((skb=skb_dequeue(&backlog))!=NULL)
-  {
-  	nitcount=dev_nit;
-	flag=0;
-	sti();
-       /*
-	* Bump the pointer to the next structure.
-	* This assumes that the basic 'skb' pointer points to
-	* the MAC header, if any (as indicated by its "length"
-	* field).  Take care now!
-	*/
-       skb->h.raw = skb->data + skb->dev->hard_header_len;
-       skb->len -= skb->dev->hard_header_len;
+  nitcount=dev_nit;
+  /*
+   * Bump the pointer to the next structure.
+   * This assumes that the basic 'skb' pointer points to
+   * the MAC header, if any (as indicated by its "length"
+   * field).  Take care now!
+   */
+  skb->h.raw = skb->data + skb->dev->hard_header_len;
+  skb->len -= skb->dev->hard_header_len;
 
        /*
 	* Fetch the packet protocol ID.  This is also quite ugly, as
@@ -709,11 +758,81 @@ inet_bh(void *tmp)
 		skb->sk = NULL;
 		kfree_skb(skb, FREE_WRITE);
 	}
+}
 
-	/* Again, see if we can transmit anything now. */
-	dev_transmit();
-	cli();
+/* 豸°벿֣ͨ豸жеط */
+/*
+ * Process at most NET_RX_BUDGET frames, NET_RX_QUOTA at a time from
+ * each device in turn, so that one busy interface can neither starve
+ * the others nor keep us here forever. Whatever is left waits for the
+ * next run: we mark ourselves again and let processes have the CPU.
+ * Frames a poll() hands us are charged when it returns them, and are
+ * not charged again when they come off the queue.
+ */
+void
+inet_bh(void *tmp)
+{
+  struct sk_buff *skb;
+  struct device *dev, *next;
+  int budget = NET_RX_BUDGET;
+  int quota, work, n, paid = 0;
+
+  /* Atomically check and mark our BUSY state. */
+
+  /* ԭλΪ1ԭλΪ1ֱӷ */
+  if (set_bit(1, (void*)&in_bh))
+      return;
+
+  /* Can we send anything now? */
+  dev_transmit();
+
+  do {
+	work = 0;
+	/* Let the devices in polling mode fill their queues. */
+	for (dev = poll_list; dev != NULL && budget > 0; dev = next) {
+		next = dev->poll_next;
+		n = NET_RX_QUOTA - dev->rx_qlen;
+		if (n > budget)
+			n = budget;
+		if (n > 0) {
+			n = dev->poll(dev, n);
+			budget -= n;
+			paid += n;
+			work += n;
+		}
+	}
+
+	/* Any data left to process? */
+	for (dev = dev_base; dev != NULL && budget + paid > 0; dev = dev->next) {
+		for (quota = NET_RX_QUOTA; quota > 0 && budget + paid > 0; quota--) {
+			cli();
+			if ((skb = skb_dequeue(&dev->rx_queue)) == NULL) {
+				sti();
+				break;
+			}
+			dev->rx_qlen--;
+			backlog--;
+			sti();
+			net_rx_deliver(skb);
+			if (paid)
+				paid--;
+			else
+				budget--;
+			work++;
+
+			/* Again, see if we can transmit anything now. */
+			dev_transmit();
+		}
+	}
+  } while (work && budget > 0);
+
+  cli();
+  if (rx_throttle && backlog == 0) {
+	rx_throttle = 0;
+	printk("INET: no longer dropping packets.\n");
   }
+  if (backlog || poll_list)
+	mark_bh(INET_BH);
   in_bh = 0;
   sti();
   dev_transmit();
@@ -793,10 +912,10 @@ char *sprintf_stats(char *buffer, struct device *dev)
   struct enet_statistics *stats = (dev->get_stats ? dev->get_stats(dev): NULL);
 
   if (stats)
-    pos += sprintf(pos, "%6s:%7d %4d %4d %4d %4d %8d %4d %4d %4d %5d %4d\n",
+    pos += sprintf(pos, "%6s:%7d %4d %4lu %4d %4d %8d %4d %4d %4d %5d %4d\n",
 		   dev->name,
 		   stats->rx_packets, stats->rx_errors,
-		   stats->rx_dropped + stats->rx_missed_errors,
+		   stats->rx_dropped + stats->rx_missed_errors + dev->rx_dropped,
 		   stats->rx_fifo_errors,
 		   stats->rx_length_errors + stats->rx_over_errors
 		   + stats->rx_crc_errors + stats->rx_frame_errors,
@@ -900,6 +1019,7 @@ dev_ifsioc(void *arg, unsigned int getset)
 		dev->family = ifr.ifr_addr.sa_family;
 		dev->pa_mask = get_mask(dev->pa_addr);
 		dev->pa_brdaddr = dev->pa_addr | ~dev->pa_mask;
+		rt_cache_flush();	/* 㲥ַ */
 		ret = 0;
 		break;
 	case SIOCGIFBRDADDR:
@@ -915,6 +1035,7 @@ dev_ifsioc(void *arg, unsigned int getset)
 	case SIOCSIFBRDADDR:
 		dev->pa_brdaddr = (*(struct sockaddr_in *)
 				    &ifr.ifr_broadaddr).sin_addr.s_addr;
+		rt_cache_flush();
 		ret = 0;
 		break;
 	case SIOCGIFDSTADDR:
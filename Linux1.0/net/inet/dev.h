@@ -152,6 +152,24 @@ struct device {
   					 int num_addrs, void *addrs);
 #define HAVE_SET_MAC_ADDR  		 
   int			  (*set_mac_address)(struct device *dev, void *addr);
+
+  /* Receive side: frames from netif_rx() wait here for inet_bh(). */
+  struct sk_buff	  *volatile rx_queue;
+  unsigned int		  rx_qlen;
+  unsigned long		  rx_dropped;	/* backlog̫ʱİ */
+
+  /*
+   * Interrupt mitigation. A driver that is swamped can turn its receive
+   * interrupt off and call netif_rx_schedule(): from then on inet_bh()
+   * calls poll() with a budget, and poll() hands at most that many
+   * frames to netif_rx() and returns how many it did. When the ring is
+   * empty the driver calls netif_rx_complete() and turns its interrupt
+   * back on.
+   */
+#define HAVE_NETIF_POLL
+  int			  (*poll)(struct device *dev, int budget);
+  struct device		  *poll_next;
+  unsigned char		  rx_polling;	/* poll_list */
 };
 
 
@@ -174,6 +192,10 @@ struct packet_type {
 
 /* Used by dev_rint */
 #define IN_SKBUFF	1
+
+#define NET_RX_BACKLOG	300	/* rx_queueеİͿʼ */
+#define NET_RX_BUDGET	64	/* inet_bh()ÿദİ */
+#define NET_RX_QUOTA	16	/* ÿһÿ豸ദİ */
 #define DEV_QUEUE_MAGIC	0x17432895
 
 
@@ -195,6 +217,8 @@ extern void		dev_queue_xmit(struct sk_buff *skb, struct device *dev,
 				       int pri);
 #define HAVE_NETIF_RX 1
 extern void		netif_rx(struct sk_buff *skb);
+extern void		netif_rx_schedule(struct device *dev);
+extern void		netif_rx_complete(struct device *dev);
 /* The old interface to netif_rx(). */
 extern int		dev_rint(unsigned char *buff, long len, int flags,
 				 struct device * dev);
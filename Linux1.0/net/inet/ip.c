@@ -196,6 +196,7 @@ ip_send(struct sk_buff *skb, unsigned long daddr, int len, struct device *dev,
   mac = 0;
   /* ʾmacݰѳɹ */
   skb->arp = 1;
+  skb->raddr = daddr;
   if (dev->hard_header) {
 	mac = dev->hard_header(ptr, dev, ETH_P_IP, daddr, saddr, len);
   }
@@ -547,6 +548,18 @@ ip_send_check(struct iphdr *iph)
  */
 
 static struct ipq *ipqueue = NULL;		/* IP fragment queue	*/
+static struct kmem_cache *ipq_cachep = NULL;
+static struct kmem_cache *ipfrag_cachep = NULL;
+
+/* Called from inet_proto_init(), before any packet can arrive. */
+void ip_init(void)
+{
+	ipq_cachep = kmem_cache_create("ipq", sizeof(struct ipq), 0, 0, NULL);
+	ipfrag_cachep = kmem_cache_create("ipfrag", sizeof(struct ipfrag), 0, 0, NULL);
+	if (!ipq_cachep || !ipfrag_cachep)
+		panic("IP: cannot create the fragment caches");
+}
+
  /* Create a new fragment entry. */
  
 /* ip_frag_createڴһµipfragṹڱʾ½յķƬݰ
@@ -557,7 +570,7 @@ static struct ipfrag *ip_frag_create(int offset, int end, struct sk_buff *skb, u
 {
    	struct ipfrag *fp;
  
-   	fp = (struct ipfrag *) kmalloc(sizeof(struct ipfrag), GFP_ATOMIC);
+   	fp = (struct ipfrag *) kmem_cache_alloc(ipfrag_cachep, GFP_ATOMIC);
    	if (fp == NULL) 
    	{
 	 	printk("IP: frag_create: no memory left !\n");
@@ -655,7 +668,7 @@ static void ip_free(struct ipq *qp)
  		xp = fp->next;
  		IS_SKB(fp->skb);
  		kfree_skb(fp->skb,FREE_READ);
- 		kfree_s(fp, sizeof(struct ipfrag));
+ 		kmem_cache_free(ipfrag_cachep, fp);
  		fp = xp;
    	}
    	
@@ -668,7 +681,7 @@ static void ip_free(struct ipq *qp)
    	kfree_s(qp->iph, qp->ihlen + 8);
  
    	/* Finally, release the queue descriptor itself. */
-   	kfree_s(qp, sizeof(struct ipq));
+   	kmem_cache_free(ipq_cachep, qp);
 /*   	printk("ip_free:done\n");*/
    	sti();
  }
@@ -731,7 +744,7 @@ static struct ipq *ip_create(struct sk_buff *skb, struct iphdr *iph, struct devi
   	int maclen;
   	int ihlen;
 
-  	qp = (struct ipq *) kmalloc(sizeof(struct ipq), GFP_ATOMIC);
+  	qp = (struct ipq *) kmem_cache_alloc(ipq_cachep, GFP_ATOMIC);
   	if (qp == NULL) 
   	{
 		printk("IP: create: no memory left !\n");
@@ -747,7 +760,7 @@ static struct ipq *ip_create(struct sk_buff *skb, struct iphdr *iph, struct devi
   	if (qp->mac == NULL) 
   	{
 		printk("IP: create: no memory left !\n");
-		kfree_s(qp, sizeof(struct ipq));
+		kmem_cache_free(ipq_cachep, qp);
 		return(NULL);
   	}
 
@@ -758,7 +771,7 @@ static struct ipq *ip_create(struct sk_buff *skb, struct iphdr *iph, struct devi
   	{
 		printk("IP: create: no memory left !\n");
 		kfree_s(qp->mac, maclen);
-		kfree_s(qp, sizeof(struct ipq));
+		kmem_cache_free(ipq_cachep, qp);
 		return(NULL);
   	}
 
@@ -774,6 +787,7 @@ static struct ipq *ip_create(struct sk_buff *skb, struct iphdr *iph, struct devi
 	
   	/* Start a timer for this entry. */
     /* öеʱ */
+  	init_timer(&qp->timer);
   	qp->timer.expires = IP_FRAG_TIME;		/* about 30 seconds	*/
   	qp->timer.data = (unsigned long) qp;		/* pointer to queue	*/
   	qp->timer.function = ip_expire;			/* expire function	*/
@@ -1000,7 +1014,7 @@ static struct sk_buff *ip_defrag(struct iphdr *iph, struct sk_buff *skb, struct
  			if (tfp->next != NULL) 
  				next->next->prev = next->prev;
  			
- 			kfree_s(next, sizeof(struct ipfrag));
+ 			kmem_cache_free(ipfrag_cachep, next);
  		}
  		DPRINTF((DBG_IP, "IP: defrag: fixed high overlap %d bytes\n", i));
    	}
@@ -1130,6 +1144,7 @@ static struct sk_buff *ip_defrag(struct iphdr *iph, struct sk_buff *skb, struct
  			return;
  		}
  		skb2->arp = skb->arp;
+		skb2->raddr = skb->raddr;
  		skb2->free = skb->free;
  		skb2->len = len + hlen;
  		skb2->h.raw=(char *) skb2->data;
@@ -62,6 +62,7 @@ struct ipq	 {
 
 extern int		backoff(int n);
 
+extern void		ip_init(void);
 extern void		ip_print(struct iphdr *ip);
 extern int		ip_ioctl(struct sock *sk, int cmd,
 				 unsigned long arg);
@@ -43,9 +43,35 @@
 #include "arp.h"
 #include "icmp.h"
 
+/*
+ * The routes are kept twice: on rt_base, most specific mask first, for
+ * /proc, get_gw_dev() and the odd broadcast lookup, and in a binary
+ * trie on the destination bits, where a route with an n bit mask hangs
+ * off the node n levels down. rt_route() walks the trie for the longest
+ * match, and remembers the answer in a small cache hashed on the
+ * destination. Anything that changes the table empties the cache.
+ */
+struct rt_node {
+  struct rt_node	*rt_child[2];
+  struct rtable		*rt_route;	/* ǰ׺ڵ· */
+};
+
+#define RT_CACHE_SIZE	256		/* 2 */
+#define rt_hashfn(daddr) \
+  (((daddr) ^ ((daddr) >> 8) ^ ((daddr) >> 16) ^ ((daddr) >> 24)) & (RT_CACHE_SIZE - 1))
+
+struct rt_cache_entry {
+  unsigned long		rc_dst;
+  struct rtable		*rc_rt;		/* NULLʾ */
+};
+
 /* ·ɱ */
 static struct rtable *rt_base = NULL;
 static struct rtable *rt_loopback = NULL;
+static struct rt_node *rt_trie = NULL;
+static struct rt_cache_entry rt_cache[RT_CACHE_SIZE];
+static unsigned long rt_cache_hits = 0;
+static unsigned long rt_cache_misses = 0;
 
 /* Dump the contents of a routing table entry. */
 static void
@@ -63,6 +89,105 @@ rt_print(struct rtable *rt)
 }
 
 
+/* иλ1ĸ */
+static inline int rt_prefixlen(unsigned long mask)
+{
+	int len = 0;
+
+	mask = ntohl(mask);
+	while (len < 32 && (mask & 0x80000000)) {
+		mask <<= 1;
+		len++;
+	}
+	return len;
+}
+
+#define rt_bit(key,depth)	(((key) >> (31 - (depth))) & 1)
+
+/* Throw away the cache. Called with interrupts off, or from a place
+ * that doesn't care about a lookup racing with it. */
+void rt_cache_flush(void)
+{
+	memset(rt_cache, 0, sizeof(rt_cache));
+}
+
+/* Ľڵ㿪ʼͷû·ҲûӽڵĽڵ */
+static void rt_trie_prune(struct rt_node ***path, int depth)
+{
+	struct rt_node *n;
+
+	for ( ; depth >= 0 ; depth--) {
+		n = *path[depth];
+		if (n->rt_route || n->rt_child[0] || n->rt_child[1])
+			break;
+		*path[depth] = NULL;
+		kfree_s(n, sizeof(struct rt_node));
+	}
+}
+
+/* rtҵtrieϣʱжѹر */
+static int rt_trie_insert(struct rtable *rt)
+{
+	struct rt_node **path[33];
+	struct rt_node **np, *n;
+	unsigned long key;
+	int len, depth;
+
+	key = ntohl(rt->rt_dst);
+	len = rt_prefixlen(rt->rt_mask);
+	np = &rt_trie;
+	for (depth = 0 ; ; depth++) {
+		path[depth] = np;
+		if ((n = *np) == NULL) {
+			n = (struct rt_node *) kmalloc(sizeof(struct rt_node), GFP_ATOMIC);
+			if (n == NULL) {
+				rt_trie_prune(path, depth - 1);
+				return -ENOMEM;
+			}
+			memset(n, 0, sizeof(struct rt_node));
+			*np = n;
+		}
+		if (depth == len)
+			break;
+		np = &n->rt_child[rt_bit(key, depth)];
+	}
+	n->rt_route = rt;
+	return 0;
+}
+
+static void rt_trie_remove(struct rtable *rt)
+{
+	struct rt_node **path[33];
+	struct rt_node **np;
+	unsigned long key;
+	int len, depth;
+
+	key = ntohl(rt->rt_dst);
+	len = rt_prefixlen(rt->rt_mask);
+	np = &rt_trie;
+	for (depth = 0 ; *np != NULL ; depth++) {
+		path[depth] = np;
+		if (depth == len) {
+			if ((*np)->rt_route == rt) {
+				(*np)->rt_route = NULL;
+				rt_trie_prune(path, depth);
+			}
+			return;
+		}
+		np = &(*np)->rt_child[rt_bit(key, depth)];
+	}
+}
+
+/* rժ֮ãʱжѹر */
+static void rt_free(struct rtable *r)
+{
+	rt_trie_remove(r);
+	if (rt_loopback == r)
+		rt_loopback = NULL;
+	kfree_s(r, sizeof(struct rtable));
+	rt_cache_flush();
+}
+
 /*
  * Remove a routing table entry.
  */
@@ -81,9 +206,7 @@ static void rt_del(unsigned long dst)
 			continue;
 		}
 		*rp = r->rt_next;
-		if (rt_loopback == r)
-			rt_loopback = NULL;
-		kfree_s(r, sizeof(struct rtable));
+		rt_free(r);
 	} 
 	restore_flags(flags);
 }
@@ -110,9 +233,7 @@ void rt_flush(struct device *dev)
 			continue;
 		}
 		*rp = r->rt_next;
-		if (rt_loopback == r)
-			rt_loopback = NULL;
-		kfree_s(r, sizeof(struct rtable));
+		rt_free(r);
 	} 
 	restore_flags(flags);
 }
@@ -235,10 +356,15 @@ void rt_add(short flags, unsigned long dst, unsigned long mask,
 			continue;
 		}
 		*rp = r->rt_next;
-		if (rt_loopback == r)
-			rt_loopback = NULL;
-		kfree_s(r, sizeof(struct rtable));
+		rt_free(r);
+	}
+	if (rt_trie_insert(rt)) {
+		restore_flags(cpuflags);
+		kfree_s(rt, sizeof(struct rtable));
+		DPRINTF((DBG_RT, "RT: no memory for new route!\n"));
+		return;
 	}
+	rt_cache_flush();
 	/* add the new route */
 	rp = &rt_base;
 	while ((r = *rp) != NULL) {
@@ -368,7 +494,8 @@ rt_get_info(char *buffer)
 		 "Iface\tDestination\tGateway \tFlags\tRefCnt\tUse\tMetric\tMask\n");
   
   /* This isn't quite right -- r->rt_dst is a struct! */
-  for (r = rt_base; r != NULL; r = r->rt_next) {
+  /* ֻһҳ */
+  for (r = rt_base; r != NULL && pos - buffer < PAGE_SIZE - 128; r = r->rt_next) {
         pos += sprintf(pos, "%s\t%08lX\t%08lX\t%02X\t%d\t%lu\t%d\t%08lX\n",
 		r->rt_dev->name, r->rt_dst, r->rt_gateway,
 		r->rt_flags, r->rt_refcnt, r->rt_use, r->rt_metric,
@@ -377,13 +504,25 @@ rt_get_info(char *buffer)
   return(pos - buffer);
 }
 
+
+/*
+ * The destination cache counters. They are not in /proc/net/route,
+ * which route and netstat parse line by line.
+ */
+int
+rt_stat_get_info(char *buffer)
+{
+  return sprintf(buffer, "hits %lu misses %lu\n",
+		 rt_cache_hits, rt_cache_misses);
+}
+
 /*
  * This is hackish, but results in better code. Use "-S" to see why.
  */
 #define early_out ({ goto no_route; 1; })
 
-/* ݵַҵһʵ·ɱ */
-struct rtable * rt_route(unsigned long daddr, struct options *opt)
+/* rt_base˳ңֻĿĵַĳӿڵĹ㲥ַ */
+static struct rtable * rt_list_lookup(unsigned long daddr)
 {
 	struct rtable *rt;
 
@@ -395,13 +534,64 @@ struct rtable * rt_route(unsigned long daddr, struct options *opt)
 		     rt->rt_dev->pa_brdaddr == daddr)
 			break;
 	}
+	return rt;
+no_route:
+	return NULL;
+}
+
+/* trieƥǰ׺ */
+static struct rtable * rt_lookup(unsigned long daddr)
+{
+	struct device *dev;
+	struct rt_node *n;
+	struct rtable *best;
+	unsigned long key;
+	int depth;
+
+	for (dev = dev_base; dev != NULL; dev = dev->next) {
+		if ((dev->flags & IFF_BROADCAST) && dev->pa_brdaddr == daddr)
+			return rt_list_lookup(daddr);
+	}
+	best = NULL;
+	key = ntohl(daddr);
+	for (n = rt_trie, depth = 0; n != NULL; n = n->rt_child[rt_bit(key, depth)], depth++) {
+		if (n->rt_route && !((n->rt_route->rt_dst ^ daddr) & n->rt_route->rt_mask))
+			best = n->rt_route;
+		if (depth == 32)
+			break;
+	}
+	return best;
+}
+
+/* ݵַҵһʵ·ɱ */
+struct rtable * rt_route(unsigned long daddr, struct options *opt)
+{
+	struct rt_cache_entry *rc;
+	struct rtable *rt;
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	rc = rt_cache + rt_hashfn(daddr);
+	if (rc->rc_rt != NULL && rc->rc_dst == daddr) {
+		rt_cache_hits++;
+		rt = rc->rc_rt;
+	} else {
+		rt_cache_misses++;
+		if ((rt = rt_lookup(daddr)) == NULL)
+			goto no_route;
+		rc->rc_dst = daddr;
+		rc->rc_rt = rt;
+	}
 	if (daddr == rt->rt_dev->pa_addr) {
 		if ((rt = rt_loopback) == NULL)
 			goto no_route;
 	}
 	rt->rt_use++;
+	restore_flags(flags);
 	return rt;
 no_route:
+	restore_flags(flags);
 	return NULL;
 }
 
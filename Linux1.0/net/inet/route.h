@@ -38,10 +38,12 @@ struct rtable {
 
 
 extern void		rt_flush(struct device *dev);
+extern void		rt_cache_flush(void);
 extern void		rt_add(short flags, unsigned long addr, unsigned long mask,
 			       unsigned long gw, struct device *dev);
 extern struct rtable	*rt_route(unsigned long daddr, struct options *opt);
 extern int		rt_get_info(char * buffer);
+extern int		rt_stat_get_info(char * buffer);
 extern int		rt_ioctl(unsigned int cmd, void *arg);
 
 #endif	/* _ROUTE_H */
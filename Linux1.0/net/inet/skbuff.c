@@ -33,6 +33,7 @@
 #include "udp.h"
 #include "skbuff.h"
 #include "sock.h"
+#include "eth.h"
 
 
 /* Socket buffer operations. Ideally much of this list swap stuff ought to be using
@@ -52,6 +53,24 @@ volatile unsigned long net_memory=0;
  */
 volatile unsigned long net_skbcount=0;
 
+/*
+ *	Control segments (SYN, FIN, ACK, RST) and full ethernet frames
+ *	make up most of the traffic, so those two sizes come from object
+ *	caches. kfree_s() sends cache objects back where they came from,
+ *	so kfree_skbmem() doesn't need to know.
+ */
+#define SKB_SMALL	(MAX_SYN_SIZE)
+#define SKB_LARGE	(sizeof(struct sk_buff) + ETH_FRAME_LEN)
+
+static struct kmem_cache *skb_small_cachep = NULL;
+static struct kmem_cache *skb_large_cachep = NULL;
+
+void skb_init(void)
+{
+	skb_small_cachep = kmem_cache_create("skbuff_small", SKB_SMALL, 0, 0, NULL);
+	skb_large_cachep = kmem_cache_create("skbuff_large", SKB_LARGE, 0, 0, NULL);
+}
+
 /*
  *	Debugging paranoia. Can go later when this crud stack works
  */
@@ -461,7 +480,13 @@ struct sk_buff *alloc_skb(unsigned int size,int priority)
 			((unsigned long *)&size)[-1]);
 		priority = GFP_ATOMIC;
 	}
-	skb=(struct sk_buff *)kmalloc(size,priority);
+	/* Drivers may receive before skb_init() has run */
+	if (size <= SKB_SMALL && skb_small_cachep)
+		skb=(struct sk_buff *)kmem_cache_alloc(skb_small_cachep,priority);
+	else if (size <= SKB_LARGE && skb_large_cachep)
+		skb=(struct sk_buff *)kmem_cache_alloc(skb_large_cachep,priority);
+	else
+		skb=(struct sk_buff *)kmalloc(size,priority);
 	if(skb==NULL)
 		return NULL;
 	skb->free= 2;	/* Invalid so we pick up forgetful users */
@@ -471,6 +496,7 @@ struct sk_buff *alloc_skb(unsigned int size,int priority)
 	skb->mem_len=size;
 	skb->mem_addr=skb;
 	skb->fraglist=NULL;
+	skb->raddr=0;
 	net_memory+=size;
 	net_skbcount++;
 	skb->magic_debug_cookie=SK_GOOD_SKB;
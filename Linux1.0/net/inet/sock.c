@@ -80,6 +80,7 @@
 
 #include <asm/segment.h>
 #include <asm/system.h>
+#include <asm/bitops.h>
 
 #include "inet.h"
 #include "dev.h"
@@ -171,66 +172,168 @@ static int sk_inuse(struct proto *prot, int num)
   return(0);
 }
 
-/* ȡһµĿж˿ں 
- * protʾʹõЭ飬
- * baseʾСʼ˿ں
- * ڶӦstruct protoжһSOCK_ARRAY,оSOCK_ARRAY_SIZE=64Ԫ
- * ÿԪضӦһڻȡЭһµĶ˿ںʱѰг̵Ǹ
- * ȻӸлȡһ˿ں
+/* mapfromto-1֮һΪ0λû򷵻-1 */
+static int find_free_port(unsigned long *map, int from, int to)
+{
+  unsigned long word;
+
+  while (from < to) {
+	word = ~map[from >> 5] & (~0UL << (from & 31));
+	if (word != 0) {
+		__asm__("bsfl %1,%0":"=r" (word):"r" (word));
+		from = (from & ~31) + word;
+		return(from < to ? from : -1);
+	}
+	from = (from | 31) + 1;
+  }
+  return(-1);
+}
+
+/*
+ * Pick a free local port for prot. Ports below PORT_MAP_SIZE in use by
+ * any socket of the protocol have their bit set in prot->port_map, so
+ * this is a scan of the bitmap from port_rover, which moves past each
+ * port handed out. The rover starts at a random place (and goes back
+ * to one when it wraps) so the ports of a rebooted host don't line up
+ * with connections the other end may still remember.
+ *
+ * Only if the whole bitmap range is busy do we look above it, the slow
+ * way.
  */
 unsigned short get_new_socknum(struct proto *prot, unsigned short base)
 {
-  static int start=0;
-
-  /*
-   * Used to cycle through the port numbers so the
-   * chances of a confused connection drop.
-   */
-  int i, j;
-  int best = 0;
-  /* sock󳤶 */
-  int size = 32767; /* a big num. */
-  struct sock *sk;
+  int low, num;
 
   /* 1024֮µĶ˿ںű߱ʹȨʹ */
-  if (base == 0) base = PROT_SOCK+1+(start % 1024);
-  if (base <= PROT_SOCK) {
-	base += PROT_SOCK+(start % 1024);
-  }
-
-  /* Now look through the entire array and try to find an empty ptr. */
-  /* ׽еhashв */
-  for(i=0; i < SOCK_ARRAY_SIZE; i++) {
-	j = 0;
-	sk = prot->sock_array[(i+base+1) &(SOCK_ARRAY_SIZE -1)];
-	while(sk != NULL) {
-		sk = sk->next;
-		j++;
-	}
-	/* ö˿ڶӦδʹãֱӷض˿ں */
-	if (j == 0) {
-		start =(i+1+start )%1024;
-		DPRINTF((DBG_INET, "get_new_socknum returning %d, start = %d\n",
-							i + base + 1, start));
-		return(i+base+1);
+  low = PROT_SOCK + 1;
+  if (base > PROT_SOCK && base < PORT_MAP_SIZE)
+	low = base;
+
+  if (prot->port_rover < low || prot->port_rover >= PORT_MAP_SIZE)
+	prot->port_rover = low + jiffies % (PORT_MAP_SIZE - low);
+  num = find_free_port(prot->port_map, prot->port_rover, PORT_MAP_SIZE);
+  if (num < 0) {
+	prot->port_rover = low + jiffies % (PORT_MAP_SIZE - low);
+	num = find_free_port(prot->port_map, low, PORT_MAP_SIZE);
+  }
+  if (num >= 0) {
+	prot->port_rover = num + 1;
+	DPRINTF((DBG_INET, "get_new_socknum returning %d\n", num));
+	return(num);
+  }
+
+  for(num = PORT_MAP_SIZE; num < 65536 && sk_inuse(prot, num); num++)
+	;
+  DPRINTF((DBG_INET, "get_new_socknum returning %d\n", num));
+  return(num < 65536 ? num : 0);
+}
+
+
+#define conn_hashfn(prot,raddr,rport,lport) \
+  (((raddr) ^ ((raddr) >> 16) ^ ((rport) << 4) ^ (lport)) & ((prot)->conn_hash_size - 1))
+
+static int conn_hash_order(int size)
+{
+  int order = 0;
+
+  while ((PAGE_SIZE << order) < size * sizeof(struct sock *))
+	order++;
+  return(order);
+}
+
+static inline void link_sock(struct sock **head, struct sock *sk)
+{
+  if ((sk->hash_next = *head) != NULL)
+	sk->hash_next->hash_pprev = &sk->hash_next;
+  *head = sk;
+  sk->hash_pprev = head;
+}
+
+/*
+ * Double conn_hash. This can run from the bottom half (a connection
+ * accepted in tcp_rcv()), so it must not sleep: if there are no pages
+ * the chains just get longer. Called with interrupts off.
+ */
+static void conn_hash_grow(struct proto *prot)
+{
+  struct sock **table, **old;
+  struct sock *sk, *next;
+  int size, old_size, order, i;
+
+  old_size = prot->conn_hash_size;
+  size = old_size ? old_size << 1 : CONN_HASH_MIN;
+  order = conn_hash_order(size);
+  if (order > CONN_HASH_MAX_ORDER)
+	return;
+  table = (struct sock **) __get_free_pages(GFP_ATOMIC, order);
+  if (table == NULL)
+	return;
+  memset(table, 0, PAGE_SIZE << order);
+  old = prot->conn_hash;
+  prot->conn_hash = table;
+  prot->conn_hash_size = size;
+  for(i = 0; i < old_size; i++) {
+	for(sk = old[i]; sk != NULL; sk = next) {
+		next = sk->hash_next;
+		link_sock(&table[conn_hashfn(prot, sk->daddr, sk->dummy_th.dest, sk->num)], sk);
 	}
-	/* ȡСjֵı
-	 * ˴jǶ˿ںŶӦĳȣ
-	 * ҲҳhashжӦ̵Ǹ
-	 */
-	if (j < size) {
-		best = i;
-		size = j;
+  }
+  if (old)
+	free_pages((unsigned long) old, conn_hash_order(old_size));
+}
+
+/* skconn_hashlisten_hashʱжѹر */
+static void hash_sock(struct sock *sk)
+{
+  struct proto *prot = sk->prot;
+  struct sock **head;
+
+  if (sk->daddr && sk->dummy_th.dest) {
+	if (prot->conn_count >= prot->conn_hash_size << 1)
+		conn_hash_grow(prot);
+	if (prot->conn_hash_size) {
+		link_sock(&prot->conn_hash[conn_hashfn(prot, sk->daddr,
+				sk->dummy_th.dest, sk->num)], sk);
+		sk->conn_hashed = 1;
+		prot->conn_count++;
+		return;
 	}
   }
+  /* ˾ַķǰ棬ַͨıҵ */
+  head = &prot->listen_hash[sk->num & (SOCK_ARRAY_SIZE - 1)];
+  if (!sk->saddr) {
+	while (*head != NULL)
+		head = &(*head)->hash_next;
+  }
+  link_sock(head, sk);
+}
 
-  /* Now make sure the one we want is not in use. */
-  while(sk_inuse(prot, base +best+1)) {
-	best += SOCK_ARRAY_SIZE;
+static void unhash_sock(struct sock *sk)
+{
+  if (sk->hash_pprev == NULL)
+	return;
+  if (sk->hash_next)
+	sk->hash_next->hash_pprev = sk->hash_pprev;
+  *sk->hash_pprev = sk->hash_next;
+  sk->hash_pprev = NULL;
+  if (sk->conn_hashed) {
+	sk->conn_hashed = 0;
+	sk->prot->conn_count--;
   }
-  DPRINTF((DBG_INET, "get_new_socknum returning %d, start = %d\n",
-						best + base + 1, start));
-  return(best+base+1);
+}
+
+/* connect()Զ˵ַͶ˿֮ */
+void rehash_sock(struct sock *sk)
+{
+  unsigned long flags;
+
+  save_flags(flags);
+  cli();
+  if (sk->hash_pprev != NULL) {
+	unhash_sock(sk);
+	hash_sock(sk);
+  }
+  restore_flags(flags);
 }
 
 
@@ -249,11 +352,17 @@ void put_sock(unsigned short num, struct sock *sk)
   DPRINTF((DBG_INET, "put_sock(num = %d, sk = %X\n", num, sk));
   sk->num = num;
   sk->next = NULL;
+  if (num < PORT_MAP_SIZE)
+	set_bit(num, sk->prot->port_map);
   /* ȡhashе */
   num = num &(SOCK_ARRAY_SIZE -1);
 
   /* We can't have an interupt re-enter here. */
   cli();
+  /* accept()sockǴӼsockģhash_pprev */
+  sk->hash_pprev = NULL;
+  sk->conn_hashed = 0;
+  hash_sock(sk);
   /* hashײΪNULLֱӸֵ */
   if (sk->prot->sock_array[num] == NULL) {
 	sk->prot->sock_array[num] = sk;
@@ -305,6 +414,13 @@ void put_sock(unsigned short num, struct sock *sk)
   sti();
 }
 
+/* skѾsock_arrayɾ˿ûб׽ãport_mapеλ */
+static inline void release_port(struct sock *sk)
+{
+  if (sk->num < PORT_MAP_SIZE && !sk_inuse(sk->prot, sk->num))
+	clear_bit(sk->num, sk->prot->port_map);
+}
+
 /* Ƴһָsockṹ,struct socksockĶɾ  */
 static void remove_sock(struct sock *sk1)
 {
@@ -323,6 +439,7 @@ static void remove_sock(struct sock *sk1)
 
   /* We can't have this changing out from under us. */
   cli();
+  unhash_sock(sk1);
   /* ʹsockĶ˿ںhashsocksock_arrayеλã
    * ȡhash
    */
@@ -330,6 +447,7 @@ static void remove_sock(struct sock *sk1)
   /* ҵˣsk1ײɾһsockΪײ */
   if (sk2 == sk1) {
 	sk1->prot->sock_array[sk1->num &(SOCK_ARRAY_SIZE -1)] = sk1->next;
+	release_port(sk1);
 	sti();
 	return;
   }
@@ -341,6 +459,7 @@ static void remove_sock(struct sock *sk1)
   /* ҵˣϵҲǽsk1ӵɾ */	
   if (sk2) {
 	sk2->next = sk1->next;
+	release_port(sk1);
 	sti();
 	return;
   }
@@ -976,12 +1095,16 @@ static int inet_create(struct socket *sock, int protocol)
   sk->saddr = my_addr();  /* ȡĵַΪ127.0.0.1 */
   sk->err = 0;
   sk->next = NULL;
+  sk->hash_pprev = NULL;
+  sk->conn_hashed = 0;
   sk->pair = NULL;
   sk->send_tail = NULL;
   sk->send_head = NULL;
   sk->timeout = 0;
   sk->broadcast = 0;
   /* struct socktimerݺӦ */
+  init_timer(&sk->timer);
+  init_timer(&sk->partial_timer);
   sk->timer.data = (unsigned long)sk;
   sk->timer.function = &net_timer;
   sk->back_log = NULL;
@@ -1183,17 +1306,17 @@ outside_loop:
   sti();
 
   remove_sock(sk);
-  /* sockͶ˿ڰ󶨣ӵЭ */
-  put_sock(snum, sk);
-  /* ñض˿ںźԶ˶˿ں */
-  sk->dummy_th.source = ntohs(sk->num);
   /* ע׽ֵԶ˵ַΪ0acceptʱӰ׽½struct sock
     * Ȼ˿ںͰ׽ֵĶ˿ͬ׽ֵԶ˵ַͬע⺯put_sock
     * get_sockĲget_sockǸݱ׽ֺԶ׽ȡġput_sock
-    * Ǳ׽
+    * Ǳ׽֡put_sockԶ˵ַĸhashҪ
     */
   sk->daddr = 0;
   sk->dummy_th.dest = 0;
+  /* sockͶ˿ڰ󶨣ӵЭ */
+  put_sock(snum, sk);
+  /* ñض˿ںźԶ˶˿ں */
+  sk->dummy_th.source = ntohs(sk->num);
   return(0);
 }
 
@@ -1831,6 +1954,20 @@ struct sock *get_sock(struct proto *prot, unsigned short num,
   DPRINTF((DBG_INET, "get_sock(prot=%X, num=%d, raddr=%X, rnum=%d, laddr=%X)\n",
 	  prot, num, raddr, rnum, laddr));
 
+  /* ȰԪӵ׽ */
+  if (prot->conn_hash_size) {
+	for(s = prot->conn_hash[conn_hashfn(prot, raddr, rnum, hnum)];
+	    s != NULL; s = s->hash_next) {
+		if (s->num != hnum || s->daddr != raddr || s->dummy_th.dest != rnum)
+			continue;
+		if(s->dead && (s->state == TCP_CLOSE))
+			continue;
+		if(ip_addr_match(s->saddr,laddr) == 0)
+			continue;
+		return(s);
+	}
+  }
+
   /*
    * SOCK_ARRAY_SIZE must be a power of two.  This will work better
    * than a prime unless 3 or more sockets end up using the same
@@ -1839,8 +1976,8 @@ struct sock *get_sock(struct proto *prot, unsigned short num,
    * the other ones, we can just be careful about picking our
    * socket number when we choose an arbitrary one.
    */
-  for(s = prot->sock_array[hnum & (SOCK_ARRAY_SIZE - 1)];
-      s != NULL; s = s->next) 
+  for(s = prot->listen_hash[hnum & (SOCK_ARRAY_SIZE - 1)];
+      s != NULL; s = s->hash_next) 
   {
     /* жϱض˿ */
 	if (s->num != hnum) 
@@ -1860,9 +1997,111 @@ struct sock *get_sock(struct proto *prot, unsigned short num,
 		continue;
 	return(s);
   }
+
+  /* ǰһUDPûб׽ʱҲӵ𴦵׽ */
+  if (prot == &udp_prot) {
+	for(s = prot->sock_array[hnum & (SOCK_ARRAY_SIZE - 1)];
+	    s != NULL; s = s->next) {
+		if (s->num == hnum && !(s->dead && s->state == TCP_CLOSE))
+			return(s);
+	}
+  }
+  return(NULL);
+}
+
+
+#ifdef CONFIG_SOCK_BENCH
+/*
+ * Boot-time benchmark of get_sock(). SOCK_BENCH_CONNS connections from
+ * 127.0.0.1 to a listener on 127.0.0.1 port 80 are put into a private
+ * struct proto, and we count how many lookups of them get through in a
+ * second. For comparison the same connections are looked for by walking
+ * the port's sock_array chain, which is what the old get_sock() did.
+ */
+#define SOCK_BENCH_CONNS	2048
+
+static struct proto bench_prot;
+static struct sock *bench_sk[SOCK_BENCH_CONNS + 1];
+
+static struct sock *bench_chain_lookup(unsigned short num, unsigned long raddr,
+				unsigned short rnum, unsigned long laddr)
+{
+  struct sock *s;
+  unsigned short hnum = ntohs(num);
+
+  for(s = bench_prot.sock_array[hnum & (SOCK_ARRAY_SIZE - 1)];
+      s != NULL; s = s->next) {
+	if (s->num != hnum || s->daddr != raddr || s->dummy_th.dest != rnum)
+		continue;
+	if(ip_addr_match(s->saddr,laddr) == 0)
+		continue;
+	return(s);
+  }
   return(NULL);
 }
 
+void sock_bench(void)
+{
+  static char *pass_name[2] = { "hashed", "port chain" };
+  struct sock *sk, *s;
+  unsigned long laddr = htonl(0x7f000001L);
+  unsigned short port = htons(80);
+  unsigned long n, found, start;
+  int i, nr, pass;
+
+  /* bench_sk[0] is the listener */
+  for(nr = 0; nr <= SOCK_BENCH_CONNS; nr++) {
+	sk = (struct sock *) kmalloc(sizeof(*sk), GFP_KERNEL);
+	if (sk == NULL)
+		break;
+	memset(sk, 0, sizeof(*sk));
+	sk->prot = &bench_prot;
+	sk->saddr = laddr;
+	sk->state = TCP_LISTEN;
+	if (nr) {
+		sk->daddr = laddr;
+		sk->dummy_th.dest = htons(1023 + nr);
+		sk->state = TCP_ESTABLISHED;
+	}
+	put_sock(80, sk);
+	bench_sk[nr] = sk;
+  }
+  printk("Socket lookup: %d connections to one port\n", nr > 0 ? nr - 1 : 0);
+  for(pass = 0; pass < 2 && nr > 1; pass++) {
+	start = jiffies;
+	while (jiffies == start)
+		/* nothing */;
+	start = jiffies;
+	n = found = 0;
+	i = 1;
+	do {
+		i += 97;
+		while (i >= nr)
+			i -= nr - 1;
+		sk = bench_sk[i];
+		if (pass)
+			s = bench_chain_lookup(port, laddr, sk->dummy_th.dest, laddr);
+		else
+			s = get_sock(&bench_prot, port, laddr, sk->dummy_th.dest, laddr);
+		if (s == sk)
+			found++;
+		n++;
+	} while (jiffies - start < HZ);
+	printk("  %s: %lu lookups a second, %luns each, %lu found\n",
+		pass_name[pass], n, 1000000000 / n, found);
+  }
+  while (nr-- > 0) {
+	remove_sock(bench_sk[nr]);
+	kfree_s(bench_sk[nr], sizeof(struct sock));
+  }
+  if (bench_prot.conn_hash)
+	free_pages((unsigned long) bench_prot.conn_hash,
+		   conn_hash_order(bench_prot.conn_hash_size));
+  bench_prot.conn_hash = NULL;
+  bench_prot.conn_hash_size = 0;
+}
+#endif /* CONFIG_SOCK_BENCH */
+
 
 void release_sock(struct sock *sk)
 {
@@ -2036,6 +2275,10 @@ void inet_proto_init(struct ddi_proto *pro)
 
   seq_offset = CURRENT_TIME*250;
 
+  /* Object caches for socket buffers and IP fragment queues. */
+  skb_init();
+  ip_init();
+
   /* Add all the protocols. */
   /* Э׽ÿգҲЭ׽Ϊ */
   for(i = 0; i < SOCK_ARRAY_SIZE; i++) {
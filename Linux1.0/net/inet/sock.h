@@ -121,6 +121,10 @@ struct sock {
   unsigned long		        lingertime;/*ʾȴرղʱ䣬ֻе linger ־λΪ 1 ʱֶβ塣*/
   int				proc;/*  sock ṹ׽֣Ľ̵Ľ̺š*/
   struct sock			*next;   /* γstruct sockһ */
+  /* Эconn_hashlisten_hashеhash_pprevΪNULLʾڱ */
+  struct sock			*hash_next;
+  struct sock			**hash_pprev;
+  unsigned char			conn_hashed;	/* conn_hash */
   /* RAW׽ִ͹رյʱ¼struct inet_protocolָ
     * PACKET׽ִ͹رʱ¼struct packet_typeָ 
     */
@@ -248,6 +252,8 @@ struct sock {
   
 };
 
+#define PORT_MAP_SIZE	8192	/* ʱ˿PROT_SOCK+1PORT_MAP_SIZE-1֮ */
+
 /* ЭĲ,ʾ㺯Ĳһṹ
  * ڲͬЭʹͬĶ˿ںTCPUDPͬʱʹ1000˿
  */
@@ -310,8 +316,24 @@ struct proto {
   /* ͨ˿ںźSOCK_ARRAY_SIZEȡõ */
   struct sock *		sock_array[SOCK_ARRAY_SIZE];
   char			name[80];   /* ЭTCP,UDPȵ */
+  /*
+   * sock_array has every socket by local port, for bind() and
+   * /proc. get_sock() looks in these instead: connected sockets are
+   * hashed on remote address, remote port and local port, the rest
+   * (listeners, unconnected UDP) on the local port alone.
+   */
+  struct sock **	conn_hash;
+  int			conn_hash_size;		/* 2ݣ0ʾûз */
+  int			conn_count;
+  struct sock *		listen_hash[SOCK_ARRAY_SIZE];
+  /* ˿ںСPORT_MAP_SIZE׽õģӦλ1 */
+  unsigned long		port_map[PORT_MAP_SIZE / 32];
+  int			port_rover;		/* һδ￪ʼҿж˿ */
 };
 
+#define CONN_HASH_MIN		(PAGE_SIZE / sizeof(struct sock *))
+#define CONN_HASH_MAX_ORDER	4	/* 16ҳ16384Ͱ */
+
 #define TIME_WRITE	1  /* ʱش */
 #define TIME_CLOSE	2   /* ȴر */
 #define TIME_KEEPOPEN	3  /*  */
@@ -330,6 +352,7 @@ struct proto {
 extern void			destroy_sock(struct sock *sk);
 extern unsigned short		get_new_socknum(struct proto *, unsigned short);
 extern void			put_sock(unsigned short, struct sock *); 
+extern void			rehash_sock(struct sock *sk);
 extern void			release_sock(struct sock *sk);
 extern struct sock		*get_sock(struct proto *, unsigned short,
 					  unsigned long, unsigned short,
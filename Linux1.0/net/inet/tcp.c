@@ -1913,6 +1913,8 @@ tcp_conn_request(struct sock *sk, struct sk_buff *skb,
   DPRINTF((DBG_TCP, "newsk = %X\n", newsk));
   /* ׽ֽп */
   memcpy((void *)newsk,(void *)sk, sizeof(*newsk));
+  newsk->hash_pprev = NULL;
+  newsk->conn_hashed = 0;
   newsk->wback = NULL;
   newsk->wfront = NULL;
   newsk->rqueue = NULL;
@@ -1954,6 +1956,8 @@ tcp_conn_request(struct sock *sk, struct sk_buff *skb,
   newsk->urg_data = 0;
   newsk->retransmits = 0;
   newsk->destroy = 0;
+  init_timer(&newsk->timer);	/* the copy isn't on the timer lists */
+  init_timer(&newsk->partial_timer);
   newsk->timer.data = (unsigned long)newsk;
   newsk->timer.function = &net_timer;
   newsk->dummy_th.source = skb->h.th->dest;
@@ -3198,6 +3202,7 @@ static int tcp_connect(struct sock *sk, struct sockaddr_in *usin, int addr_len)
   sk->rcv_ack_seq = sk->write_seq -1;
   sk->err = 0;
   sk->dummy_th.dest = sin.sin_port;
+  rehash_sock(sk);
   release_sock(sk);
 
   /* һµӵsk_buff */
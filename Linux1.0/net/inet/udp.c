@@ -547,6 +547,7 @@ udp_connect(struct sock *sk, struct sockaddr_in *usin, int addr_len)
   	
   sk->daddr = sin.sin_addr.s_addr;
   sk->dummy_th.dest = sin.sin_port;
+  rehash_sock(sk);
   sk->state = TCP_ESTABLISHED;
   return(0);
 }
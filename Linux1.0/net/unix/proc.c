@@ -38,25 +38,26 @@
 int unix_get_info(char *buffer)
 {
   char *pos;
+  struct unix_proto_data *upd;
   int i;
 
   pos = buffer;
   pos += sprintf(pos, "Num RefCount Protocol Flags    Type St Path\n");
 
-  for(i = 0; i < NSOCKETS; i++) {
-	if (unix_datas[i].refcnt>0) {
+  for(i = 0, upd = unix_datas; upd; i++, upd = upd->next) {
+	if (upd->refcnt>0) {
 		pos += sprintf(pos, "%2d: %08X %08X %08lX %04X %02X", i,
-			unix_datas[i].refcnt,
-			unix_datas[i].protocol,
-			unix_datas[i].socket->flags,
-			unix_datas[i].socket->type,
-			unix_datas[i].socket->state
+			upd->refcnt,
+			upd->protocol,
+			upd->socket->flags,
+			upd->socket->type,
+			upd->socket->state
 		);
 
 		/* If socket is bound to a filename, we'll print it. */
-		if(unix_datas[i].sockaddr_len>0) {
+		if(upd->sockaddr_len>0) {
 			pos += sprintf(pos, " %s\n",
-				unix_datas[i].sockaddr_un.sun_path);
+				upd->sockaddr_un.sun_path);
 		} else { /* just add a newline */
 			*pos='\n';
 			pos++;
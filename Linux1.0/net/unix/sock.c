@@ -52,8 +52,9 @@
 
 #include "unix.h"
 
-/* UNIXЭݵ */
-struct unix_proto_data unix_datas[NSOCKETS];
+/* UNIXЭݵЭݴӶ󻺴з */
+struct unix_proto_data *unix_datas = NULL;
+static struct kmem_cache *unix_data_cachep = NULL;
 static int unix_debug = 0;
 
 
@@ -241,7 +242,7 @@ unix_data_lookup(struct sockaddr_un *sockun, int sockaddr_len,
 {
   struct unix_proto_data *upd;
 
-  for(upd = unix_datas; upd <= last_unix_data; ++upd) {
+  for(upd = unix_datas; upd; upd = upd->next) {
 	if (upd->refcnt > 0 && upd->socket &&
 	    upd->socket->state == SS_UNCONNECTED &&
 	    upd->sockaddr_un.sun_family == sockun->sun_family &&
@@ -257,24 +258,43 @@ static struct unix_proto_data *unix_data_alloc(void)
 {
   struct unix_proto_data *upd;
 
+  upd = (struct unix_proto_data *) kmem_cache_alloc(unix_data_cachep, GFP_KERNEL);
+  if (!upd) return(NULL);
+  upd->refcnt = -1;	/* unix domain socket not yet initialised - bgm */
+  upd->socket = NULL;
+  upd->sockaddr_len = 0;
+  upd->sockaddr_un.sun_family = 0;
+  upd->buf = NULL;
+  upd->bp_head = upd->bp_tail = 0;
+  upd->inode = NULL;
+  upd->peerupd = NULL;
   cli();
-  /* ɨ */
-  for(upd = unix_datas; upd <= last_unix_data; ++upd) {
-	if (!upd->refcnt) {
-		upd->refcnt = -1;	/* unix domain socket not yet initialised - bgm */
-		sti();
-		upd->socket = NULL;
-		upd->sockaddr_len = 0;
-		upd->sockaddr_un.sun_family = 0;
-		upd->buf = NULL;
-		upd->bp_head = upd->bp_tail = 0;
-		upd->inode = NULL;
-		upd->peerupd = NULL;
-		return(upd);
-	}
-  }
+  upd->prev = NULL;
+  if ((upd->next = unix_datas) != NULL) upd->next->prev = upd;
+  unix_datas = upd;
   sti();
-  return(NULL);
+  return(upd);
+}
+
+/* The last reference is gone: unlink the data and give it back. */
+static void unix_data_free(struct unix_proto_data *upd)
+{
+  cli();
+  if (upd->next) upd->next->prev = upd->prev;
+  if (upd->prev) upd->prev->next = upd->next;
+  else unix_datas = upd->next;
+  sti();
+  upd->refcnt = 0;
+  kmem_cache_free(unix_data_cachep, upd);
+}
+
+/*
+ * A released entry keeps wait == NULL and lock_flag == 0, so the
+ * constructor only has to set those up for fresh ones.
+ */
+static void unix_data_ctor(void *obj)
+{
+  memset(obj, 0, sizeof(struct unix_proto_data));
 }
 
 /* updü */
@@ -297,14 +317,16 @@ static void unix_data_deref(struct unix_proto_data *upd)
     return;
   }
 
-  /* üΪ1ͷupdbuf */
-  if (upd->refcnt == 1) {
+  /* üΪ1(ߴʧʱ-1)ͷupdbufԼupd */
+  if (upd->refcnt == 1 || upd->refcnt == -1) {
 	dprintf(1, "UNIX: data_deref: releasing data 0x%x\n", upd);
 	if (upd->buf) {
 		free_page((unsigned long)upd->buf);
 		upd->buf = NULL;
 		upd->bp_head = upd->bp_tail = 0;
 	}
+	unix_data_free(upd);
+	return;
   }
   --upd->refcnt;
 }
@@ -988,8 +1010,6 @@ static struct proto_ops unix_proto_ops = {
   */
 void unix_proto_init(struct ddi_proto *pro)
 {
-  struct unix_proto_data *upd;
-
   dprintf(1, "%s: init: initializing...\n", pro->name);
   if (register_chrdev(AF_UNIX_MAJOR, "af_unix", &unix_fops) < 0) {
 	printk("%s: cannot register major device %d!\n",
@@ -1000,7 +1020,8 @@ void unix_proto_init(struct ddi_proto *pro)
   /* Tell SOCKET that we are alive... */
   (void) sock_register(unix_proto_ops.family, &unix_proto_ops);
 
-  for(upd = unix_datas; upd <= last_unix_data; ++upd) {
-	upd->refcnt = 0;
-  }
+  unix_data_cachep = kmem_cache_create("unix_proto_data",
+		sizeof(struct unix_proto_data), 0, 0, unix_data_ctor);
+  if (!unix_data_cachep)
+	panic("UNIX: cannot create the protocol data cache");
 }
@@ -46,12 +46,10 @@ struct unix_proto_data {
 	struct unix_proto_data	*peerupd;  /* ӳɹöԵȵЭ */
 	struct wait_queue *wait;	/* Lock across page faults (FvK) */
 	int		lock_flag;            /* Ƿס */
+	struct unix_proto_data	*next, *prev;	/* on unix_datas */
 };
 
-extern struct unix_proto_data unix_datas[NSOCKETS];
-
-
-#define last_unix_data		(unix_datas + NSOCKETS - 1)
+extern struct unix_proto_data *unix_datas;
 
 
 #define UN_DATA(SOCK) 		((struct unix_proto_data *)(SOCK)->data)